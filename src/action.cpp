@@ -32,6 +32,10 @@ bool isEnabled(action_code code, const game &g)
         return getStatus(g) == RUNNING;
     case SIZE:
         return getStatus(g) != RUNNING;
+    case STATS:
+        return true;
+    case HINTS:
+        return true;
     case NONE:
         return true;
     default:
@@ -64,15 +68,21 @@ void processUserAction(action a, game &g, configuration &c)
             changeSelection(g, a.param);
             break;
         case SIZE:
-            c.boardDim += a.param;
-            if (c.boardDim > MAX_DIM)
-            {
-                c.boardDim = MIN_DIM;
-            }
-            if (c.boardDim < MIN_DIM)
-            {
-                c.boardDim = MAX_DIM;
-            }
+        {
+            // every dimension, then every dimension with gravity, then the same with more players
+            int dims = MAX_DIM - MIN_DIM + 1, boards = 2 * dims * (MAX_PLAYERS - NUM_PLAYERS + 1);
+            int board = ((int(c.players) - NUM_PLAYERS) * 2 + c.gravity) * dims + int(c.boardDim) - MIN_DIM + a.param;
+            board = (board + boards) % boards;
+            c.players = NUM_PLAYERS + board / (2 * dims);
+            c.gravity = board / dims % 2 == 1;
+            c.boardDim = MIN_DIM + board % dims;
+            break;
+        }
+        case STATS:
+            toggleStatistics(g);
+            break;
+        case HINTS:
+            toggleHints(g);
             break;
         case NONE:
             break;
@@ -88,4 +98,4 @@ void processUserAction(action a, game &g, configuration &c)
     }
 }
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
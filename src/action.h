@@ -28,6 +28,8 @@ enum action_code
     TRY,        ///< make a guess (with guess as parameter)
     MOVE,       ///< move selection (with amount as parameter)
     SIZE,       ///< resize board (with amount as parameter)
+    STATS,      ///< show/hide latency statistics
+    HINTS,      ///< show/hide the value of the moves
     NUM_ACTIONS ///< fake code: total number of actions (including NONE)
 };
 
@@ -56,4 +58,4 @@ bool isEnabled(action_code, const game &);
  */
 void processUserAction(action, game &, configuration &);
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
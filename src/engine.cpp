@@ -0,0 +1,820 @@
+#ifndef ENGINE_CPP
+#define ENGINE_CPP
+
+#include "engine.h"
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define WEAK_BLUNDER_PERCENT 25 ///< weak engine: moves chosen at random (percent)
+#define MCTS_EXPLORATION 1.4    ///< UCT exploration constant
+#define MCTS_CLOCK_CHECK 64     ///< MCTS iterations between clock checks
+#define MCTS_RESERVE (1 << 16)  ///< MCTS nodes allocated at once
+#define ALPHABETA_WIN 100000        ///< alpha-beta: value of a win (less the moves to it)
+#define ALPHABETA_CLOCK_CHECK 1024  ///< alpha-beta nodes between clock checks
+
+/**
+ * @brief a move chooser
+ *
+ */
+struct engine
+{
+    virtual ~engine() = default;
+
+    /**
+     * @brief choose a move of the player to move (thread safe)
+     *
+     * @return square the chosen cell
+     */
+    virtual square chooseMove(const game &) = 0;
+
+    /**
+     * @brief the memory used by the engine
+     *
+     * @return size_t bytes (the peak, for memory allocated per move)
+     */
+    virtual size_t memory() const
+    {
+        return 0;
+    }
+};
+
+/**
+ * @brief the random numbers of the calling thread
+ *
+ */
+mt19937 &engineRandom()
+{
+    thread_local mt19937 rng(random_device{}());
+    return rng;
+}
+
+/**
+ * @brief choose an empty cell at random
+ *
+ * @param empty the empty cells (not none)
+ * @return int the cell
+ */
+int randomCell(moves empty, mt19937 &rng)
+{
+    for (int skip = rng() % __builtin_popcount(empty); skip > 0; skip--)
+    {
+        empty &= empty - 1;
+    }
+    return __builtin_ctz(empty);
+}
+
+/**
+ * @brief the exact solver (tables, book, search)
+ *
+ */
+struct solver_engine : engine
+{
+    solver_engine(const engine_settings &) {}
+
+    square chooseMove(const game &g) override
+    {
+        return getMove(g);
+    }
+
+    size_t memory() const override
+    {
+        return getSolverMemory();
+    }
+};
+
+/**
+ * @brief any empty cell
+ *
+ */
+struct random_engine : engine
+{
+    random_engine(const engine_settings &) {}
+
+    square chooseMove(const game &g) override
+    {
+        return g.r->minCell + randomCell(legalMoves(g), engineRandom());
+    }
+};
+
+/**
+ * @brief the solver, but some moves are random
+ *
+ */
+struct weak_engine : engine
+{
+    weak_engine(const engine_settings &) {}
+
+    square chooseMove(const game &g) override
+    {
+        if (engineRandom()() % 100 < WEAK_BLUNDER_PERCENT)
+        {
+            return g.r->minCell + randomCell(legalMoves(g), engineRandom());
+        }
+        return getMove(g);
+    }
+
+    size_t memory() const override
+    {
+        return getSolverMemory(); // the tables of the solver
+    }
+};
+
+// Monte Carlo tree search =====================================================
+
+/**
+ * @brief a node of the search tree
+ *
+ */
+struct mcts_node
+{
+    config cfg;      ///< the position (player to move in the low half)
+    moves untried;   ///< moves not expanded yet
+    int parent;      ///< parent node (-1 for the root)
+    int firstChild;  ///< first expanded move (-1 if none)
+    int nextSibling; ///< next move of the parent (-1 if none)
+    int cell;        ///< the move leading here
+    bool over;       ///< the game ended with that move
+    unsigned visits; ///< playouts through the node
+    double score;    ///< for the player who moved here (win 1, draw 0.5)
+};
+
+/**
+ * @brief play at random until the end
+ *
+ * @param cfg       the position (player to move in the low half)
+ * @param gravity   whether the pieces drop (see dropMoves)
+ * @return double the result for the player to move (win 1, draw 0.5, loss 0)
+ */
+double mctsPlayout(const rules &r, config cfg, bool gravity, mt19937 &rng)
+{
+    moves mine = cfg & r.full, other = cfg >> r.numCells;
+    for (double result = 1;; result = 1 - result)
+    {
+        moves empty = dropMoves(r, mine | other, gravity);
+        if (empty == 0)
+        {
+            return 0.5;
+        }
+        mine |= 1u << randomCell(empty, rng);
+        if (isWinning(r, mine))
+        {
+            return result;
+        }
+        swap(mine, other);
+    }
+}
+
+/**
+ * @brief the child to explore (UCT)
+ *
+ */
+int mctsSelect(const vector<mcts_node> &nodes, int n)
+{
+    double logVisits = log(nodes[n].visits);
+    int best = nodes[n].firstChild;
+    double bestValue = -1;
+    for (int c = nodes[n].firstChild; c >= 0; c = nodes[c].nextSibling)
+    {
+        double value = nodes[c].score / nodes[c].visits + MCTS_EXPLORATION * sqrt(logVisits / nodes[c].visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = c;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief grow a search tree until the deadline
+ *
+ * @param cfg       the position (player to move in the low half)
+ * @param gravity   whether the pieces drop (see dropMoves)
+ * @param capacity  max nodes
+ * @param visits    by cell: playouts of the root moves (added)
+ * @param used      the nodes of the tree (set)
+ */
+void mctsSearch(const rules &r, config cfg, bool gravity, TimePoint deadline, size_t capacity, unsigned visits[], size_t &used)
+{
+    mt19937 &rng = engineRandom();
+    vector<mcts_node> nodes;
+    nodes.reserve(min(capacity, size_t(MCTS_RESERVE)));
+    nodes.push_back({cfg, dropMoves(r, (cfg | cfg >> r.numCells) & r.full, gravity), -1, -1, -1, -1, false, 0, 0});
+    for (unsigned long long i = 0; i % MCTS_CLOCK_CHECK != 0 || theClock.now() < deadline; i++)
+    {
+        // selection
+        int n = 0;
+        while (nodes[n].untried == 0 && nodes[n].firstChild >= 0)
+        {
+            n = mctsSelect(nodes, n);
+        }
+        // expansion
+        if (nodes[n].untried != 0 && nodes.size() < capacity)
+        {
+            int cell = randomCell(nodes[n].untried, rng);
+            moves value = 1u << cell, mine = (nodes[n].cfg & r.full) | value, other = nodes[n].cfg >> r.numCells;
+            bool over = isWinning(r, mine) || (mine | other) == r.full;
+            nodes[n].untried &= ~value;
+            mcts_node child{other | mine << r.numCells, over ? 0 : dropMoves(r, mine | other, gravity), n, -1, nodes[n].firstChild,
+                            cell, over, 0, 0};
+            nodes[n].firstChild = nodes.size();
+            nodes.push_back(child);
+            n = nodes.size() - 1;
+        }
+        // simulation, then the result goes up (alternating players)
+        double result = !nodes[n].over ? mctsPlayout(r, nodes[n].cfg, gravity, rng) : isWinning(r, nodes[n].cfg >> r.numCells) ? 0 : 0.5;
+        for (double score = 1 - result; n >= 0; n = nodes[n].parent, score = 1 - score)
+        {
+            nodes[n].visits++;
+            nodes[n].score += score;
+        }
+    }
+    for (int c = nodes[0].firstChild; c >= 0; c = nodes[c].nextSibling)
+    {
+        visits[nodes[c].cell] += nodes[c].visits;
+    }
+    used = nodes.capacity();
+}
+
+/**
+ * @brief Monte Carlo tree search, one tree per thread (root parallel)
+ *
+ */
+struct mcts_engine : engine
+{
+    engine_settings settings; ///< threads, memory (for all the trees), think time
+    size_t capacity;          ///< nodes per tree
+    atomic<size_t> peak{0};   ///< max bytes of the trees of a move
+
+    mcts_engine(const engine_settings &s)
+        : settings(s), capacity(max(size_t(1), (s.megabytes << 20) / sizeof(mcts_node) / max(1, s.threads)))
+    {
+    }
+
+    size_t memory() const override
+    {
+        return peak;
+    }
+
+    square chooseMove(const game &g) override
+    {
+        const rules &r = *g.r;
+        config cfg = g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << r.numCells);
+        TimePoint deadline = theClock.now() + chrono::duration_cast<Clock::duration>(Duration(settings.seconds));
+        vector<array<unsigned, MAX_DIM * MAX_DIM>> visits(max(1, settings.threads));
+        vector<size_t> used(visits.size());
+        vector<thread> workers;
+        for (size_t t = 0; t < visits.size(); t++)
+        {
+            visits[t].fill(0);
+            if (t > 0)
+            {
+                workers.emplace_back(mctsSearch, cref(r), cfg, g.gravity, deadline, capacity, visits[t].data(), ref(used[t]));
+            }
+        }
+        mctsSearch(r, cfg, g.gravity, deadline, capacity, visits[0].data(), used[0]);
+        for (thread &w : workers)
+        {
+            w.join();
+        }
+        size_t bytes = 0, known = peak;
+        for (size_t u : used)
+        {
+            bytes += u * sizeof(mcts_node);
+        }
+        while (bytes > known && !peak.compare_exchange_weak(known, bytes))
+        {
+        }
+        // the most visited move
+        moves empty = legalMoves(g);
+        int best = __builtin_ctz(empty);
+        unsigned bestVisits = 0;
+        for (int cell = 0; cell < int(r.numCells); cell++)
+        {
+            unsigned total = 0;
+            for (const auto &v : visits)
+            {
+                total += v[cell];
+            }
+            if ((empty >> cell & 1) && total > bestVisits)
+            {
+                bestVisits = total;
+                best = cell;
+            }
+        }
+        return r.minCell + best;
+    }
+};
+
+// Depth-limited alpha-beta ====================================================
+
+/**
+ * @brief a depth-limited search of a move
+ *
+ */
+struct alphabeta_search
+{
+    const rules &r;           ///< the board
+    bool gravity;             ///< whether the pieces drop (see dropMoves)
+    TimePoint deadline;       ///< when to stop (the running iteration is discarded)
+    bool stopped;             ///< the deadline passed
+    unsigned long long nodes; ///< positions searched
+    unsigned long long evals; ///< static evaluations
+};
+
+/**
+ * @brief the allowed cells completing a line of a player
+ *
+ */
+moves alphaBetaWins(const rules &r, moves mine, moves legal)
+{
+    moves result = 0;
+    for (size_t i = 0; i < r.numWinnings; i++)
+    {
+        moves missing = r.winnings[i] & ~mine;
+        if (__builtin_popcount(missing) == 1)
+        {
+            result |= missing & legal;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief order the moves: the known best one, then by the static value after the move
+ *
+ * @param first the known best cell (-1 if none)
+ * @return int the number of moves
+ */
+int alphaBetaOrder(alphabeta_search &s, moves mine, moves other, moves legal, int first, int order[])
+{
+    int values[MAX_DIM * MAX_DIM], count = 0;
+    for (moves m = legal; m != 0; m &= m - 1)
+    {
+        int cell = __builtin_ctz(m), value = INT_MAX;
+        if (cell != first)
+        {
+            value = -evaluateConfig(s.r, other | (mine | 1u << cell) << s.r.numCells);
+            s.evals++;
+        }
+        int i = count++;
+        for (; i > 0 && values[i - 1] < value; i--)
+        {
+            values[i] = values[i - 1];
+            order[i] = order[i - 1];
+        }
+        values[i] = value;
+        order[i] = cell;
+    }
+    return count;
+}
+
+/**
+ * @brief the line evaluation at the leaves (see evaluateConfig)
+ *
+ */
+struct line_leaf
+{
+    const rules &r; ///< the board
+
+    void play(int, int) {}
+
+    int evaluate(moves mine, moves other, int)
+    {
+        return evaluateConfig(r, mine | other << r.numCells);
+    }
+};
+
+/**
+ * @brief the network at the leaves, its accumulators updated move by move
+ *
+ */
+struct network_leaf
+{
+    const nnue_network &net;                       ///< the weights
+    nnue_accumulator stack[MAX_DIM * MAX_DIM + 1]; ///< by ply (0 = the player to move at the root)
+
+    network_leaf(const nnue_network &n, moves mine, moves other) : net(n)
+    {
+        moves done[2]{mine, other};
+        nnueRefresh(net, done, stack[0]);
+    }
+
+    void play(int ply, int cell)
+    {
+        nnueAddPiece(net, stack[ply], stack[ply + 1], ply & 1, cell);
+    }
+
+    int evaluate(moves, moves, int ply)
+    {
+        return nnueEvaluate(net, stack[ply], ply & 1);
+    }
+};
+
+/**
+ * @brief negamax search with alpha-beta cuts, the static evaluation at the leaves
+ *
+ * The leaf evaluation follows the moves: play(ply, cell) before searching a
+ * move made at a ply, evaluate(mine, other, ply) at the leaves.
+ *
+ * @param mine  the cells of the player to move
+ * @param other the cells of the other player (who has not won)
+ * @param depth moves searched before the static evaluation
+ * @param ply   moves from the root
+ * @return int the value for the player to move (ALPHABETA_WIN less the moves to a win)
+ */
+template <class leaf>
+int alphaBeta(alphabeta_search &s, leaf &e, moves mine, moves other, int depth, int ply, int alpha, int beta)
+{
+    if (++s.nodes % ALPHABETA_CLOCK_CHECK == 0 && theClock.now() >= s.deadline)
+    {
+        s.stopped = true;
+    }
+    if (s.stopped)
+    {
+        return 0;
+    }
+    moves legal = dropMoves(s.r, mine | other, s.gravity);
+    if (legal == 0)
+    {
+        return 0; // draw
+    }
+    if (alphaBetaWins(s.r, mine, legal) != 0)
+    {
+        return ALPHABETA_WIN - ply - 1;
+    }
+    if (depth == 0)
+    {
+        s.evals++;
+        return e.evaluate(mine, other, ply);
+    }
+    moves threats = alphaBetaWins(s.r, other, legal);
+    if (threats != 0)
+    {
+        legal = threats; // forced blocks (two of them lose anyway)
+    }
+    int order[MAX_DIM * MAX_DIM], count = 0;
+    if (depth > 1)
+    {
+        count = alphaBetaOrder(s, mine, other, legal, -1, order);
+    }
+    else
+    {
+        for (moves m = legal; m != 0; m &= m - 1)
+        {
+            order[count++] = __builtin_ctz(m); // the children are evaluated anyway
+        }
+    }
+    int best = -ALPHABETA_WIN;
+    for (int i = 0; i < count && alpha < beta; i++)
+    {
+        e.play(ply, order[i]);
+        int value = -alphaBeta(s, e, other, mine | 1u << order[i], depth - 1, ply + 1, -beta, -alpha);
+        best = max(best, value);
+        alpha = max(alpha, value);
+    }
+    return best;
+}
+
+/**
+ * @brief search deeper and deeper until the deadline (or the end of every line of play)
+ *
+ * @param depth set: moves searched by the last completed iteration (0 if none)
+ * @param value set: the value of the best move (for the player to move)
+ * @return int the best cell
+ */
+template <class leaf>
+int alphaBetaRoot(alphabeta_search &s, leaf &e, moves mine, moves other, int &depth, int &value)
+{
+    moves legal = dropMoves(s.r, mine | other, s.gravity), wins = alphaBetaWins(s.r, mine, legal);
+    depth = 0;
+    value = 0;
+    if (wins != 0)
+    {
+        value = ALPHABETA_WIN - 1;
+        return __builtin_ctz(wins);
+    }
+    moves threats = alphaBetaWins(s.r, other, legal);
+    if (threats != 0)
+    {
+        legal = threats;
+    }
+    int order[MAX_DIM * MAX_DIM], count = alphaBetaOrder(s, mine, other, legal, -1, order);
+    int best = order[0], empty = __builtin_popcount(s.r.full & ~(mine | other));
+    for (int d = 1; d <= empty && abs(value) < ALPHABETA_WIN - empty; d++)
+    {
+        int alpha = -ALPHABETA_WIN - 1, bestIndex = 0;
+        for (int i = 0; i < count && !s.stopped; i++)
+        {
+            e.play(0, order[i]);
+            int v = -alphaBeta(s, e, other, mine | 1u << order[i], d - 1, 1, -ALPHABETA_WIN - 1, -alpha);
+            if (v > alpha && !s.stopped)
+            {
+                alpha = v;
+                bestIndex = i;
+            }
+        }
+        if (s.stopped)
+        {
+            break;
+        }
+        best = order[bestIndex];
+        rotate(order, order + bestIndex, order + bestIndex + 1); // searched first next time
+        depth = d;
+        value = alpha;
+    }
+    return best;
+}
+
+/**
+ * @brief alpha-beta to increasing depths within the think time
+ *
+ */
+struct alphabeta_engine : engine
+{
+    engine_settings settings; ///< think time
+
+    alphabeta_engine(const engine_settings &s) : settings(s) {}
+
+    square chooseMove(const game &g) override
+    {
+        const rules &r = *g.r;
+        alphabeta_search s{r, g.gravity, theClock.now() + chrono::duration_cast<Clock::duration>(Duration(settings.seconds)),
+                           false, 0, 0};
+        int depth, value;
+        line_leaf e{r};
+        return r.minCell + alphaBetaRoot(s, e, g.done[getTurn(g)], g.done[1 - getTurn(g)], depth, value);
+    }
+};
+
+/**
+ * @brief alpha-beta with the network of the board as the evaluation (the lines if none)
+ *
+ */
+struct nnue_engine : engine
+{
+    engine_settings settings; ///< think time
+
+    nnue_engine(const engine_settings &s) : settings(s) {}
+
+    square chooseMove(const game &g) override
+    {
+        const rules &r = *g.r;
+        alphabeta_search s{r, g.gravity, theClock.now() + chrono::duration_cast<Clock::duration>(Duration(settings.seconds)),
+                           false, 0, 0};
+        moves mine = g.done[getTurn(g)], other = g.done[1 - getTurn(g)];
+        const nnue_network *net = getNetwork(r.dim);
+        int depth, value;
+        if (net == nullptr)
+        {
+            line_leaf e{r};
+            return r.minCell + alphaBetaRoot(s, e, mine, other, depth, value);
+        }
+        network_leaf e(*net, mine, other);
+        return r.minCell + alphaBetaRoot(s, e, mine, other, depth, value);
+    }
+};
+
+volatile int evalBenchSink; ///< keeps the benchmark results alive
+
+/**
+ * @brief static evaluation cell by cell (the reference of the benchmark)
+ *
+ */
+int cellEvaluate(const rules &r, config cfg)
+{
+    int value = 0;
+    for (size_t i = 0; i < r.numWinnings; i++)
+    {
+        int mine = 0, other = 0;
+        for (size_t cell = 0; cell < r.numCells; cell++)
+        {
+            if (r.winnings[i] >> cell & 1)
+            {
+                mine += cfg >> cell & 1;
+                other += cfg >> (cell + r.numCells) & 1;
+            }
+        }
+        value += r.lineScores[mine][other];
+    }
+    return value;
+}
+
+/**
+ * @brief time a static evaluation of many positions
+ *
+ * @return double millions of evaluations per second
+ */
+template <typename F>
+double benchEvaluations(const vector<config> &configs, double seconds, F evaluate)
+{
+    unsigned long long done = 0;
+    int sum = 0;
+    TimePoint start = theClock.now();
+    double elapsed;
+    do
+    {
+        for (config c : configs)
+        {
+            sum += evaluate(c);
+        }
+        done += configs.size();
+        elapsed = Duration(theClock.now() - start).count();
+    } while (elapsed < seconds);
+    evalBenchSink = sum;
+    return done / elapsed / 1e6;
+}
+
+/**
+ * @brief Benchmark the static evaluation (cell loop, line counts, pext patterns) and the alpha-beta search
+ *
+ * @param seconds   duration of each run
+ * @return int the exit code (not 0 if the evaluations disagree)
+ */
+int runEvalBench(double seconds)
+{
+    mt19937 rng(1);
+    int errors = 0;
+    cout << "Static evaluation (million positions/s), BMI2 "
+         << (__builtin_cpu_supports("bmi2") ? "available" : "not available") << '\n';
+    cout << "dim   cell loop   line counts   pext patterns\n";
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        const rules &r = getRules(dim);
+        // random positions: disjoint cells for the two players
+        vector<config> configs(1 << 16);
+        for (config &c : configs)
+        {
+            moves mine = rng() & r.full, other = rng() & r.full & ~mine;
+            c = mine | other << r.numCells;
+        }
+        for (config c : configs)
+        {
+            int expected = cellEvaluate(r, c);
+            errors += countEvaluate(r, c) != expected || (r.symmetries.bmi2 && pextEvaluate(r, c) != expected);
+        }
+        double rates[3] = {};
+        rates[0] = benchEvaluations(configs, seconds, [&r](config c) { return cellEvaluate(r, c); });
+        rates[1] = benchEvaluations(configs, seconds, [&r](config c) { return countEvaluate(r, c); });
+        if (r.symmetries.bmi2)
+        {
+            rates[2] = benchEvaluations(configs, seconds, [&r](config c) { return pextEvaluate(r, c); });
+        }
+        cout << fixed << setprecision(1) << setw(3) << dim << setw(12) << rates[0] << setw(14) << rates[1]
+             << setw(16) << rates[2] << defaultfloat << '\n'; // 0 = not available
+    }
+    // the search from the empty board, with and without gravity
+    cout << "Alpha-beta from the empty board (" << seconds << " s)\n";
+    cout << "dim   gravity   depth   value   knodes/s   kevals/s\n";
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        for (bool gravity : {false, true})
+        {
+            alphabeta_search s{getRules(dim), gravity,
+                               theClock.now() + chrono::duration_cast<Clock::duration>(Duration(seconds)), false, 0, 0};
+            TimePoint start = theClock.now();
+            int depth, value;
+            line_leaf e{s.r};
+            alphaBetaRoot(s, e, 0, 0, depth, value);
+            double elapsed = Duration(theClock.now() - start).count();
+            cout << setw(3) << dim << setw(10) << (gravity ? "yes" : "no") << setw(8) << depth << setw(8) << value
+                 << fixed << setprecision(0) << setw(11) << s.nodes / elapsed / 1e3 << setw(11)
+                 << s.evals / elapsed / 1e3 << defaultfloat << '\n';
+        }
+    }
+    cout << (errors == 0 ? "All evaluations agree" : "Evaluations DISAGREE") << endl;
+    return errors == 0 ? 0 : 1;
+}
+
+// The registry ================================================================
+
+/**
+ * @brief create an engine
+ *
+ */
+template <class kind>
+engine *newEngine(const engine_settings &s)
+{
+    return new kind(s);
+}
+
+/**
+ * @brief a registered engine kind
+ *
+ */
+struct engine_entry
+{
+    const char *name;                           ///< name (in config.ini and in the records)
+    engine *(*create)(const engine_settings &); ///< nullptr if the computer does not choose the moves
+    engine_settings settings{};                 ///< resources
+    once_flag created{};                        ///< the instance has been created
+    engine *instance{nullptr};                  ///< created on first use
+};
+
+engine_entry engineRegistry[NUM_ENGINE_KINDS] = {
+    {"human", nullptr},
+    {"solver", newEngine<solver_engine>},
+    {"remote", nullptr},
+    {"random", newEngine<random_engine>},
+    {"weak", newEngine<weak_engine>},
+    {"mcts", newEngine<mcts_engine>},
+    {"alphabeta", newEngine<alphabeta_engine>},
+    {"nnue", newEngine<nnue_engine>}};
+
+/**
+ * @brief Get the name of an engine kind
+ *
+ * @return const char* the name
+ */
+const char *engineName(engine_kind e)
+{
+    return e < NUM_ENGINE_KINDS ? engineRegistry[e].name : "?";
+}
+
+/**
+ * @brief Find an engine kind by name
+ *
+ * @return engine_kind the kind (NUM_ENGINE_KINDS if unknown)
+ */
+engine_kind engineKind(const char name[])
+{
+    int e = 0;
+    while (e < NUM_ENGINE_KINDS && strcmp(engineRegistry[e].name, name) != 0)
+    {
+        e++;
+    }
+    return engine_kind(e);
+}
+
+/**
+ * @brief Check whether the computer plays with an engine kind
+ *
+ * @return true if the engine chooses moves by itself (not human nor remote)
+ */
+bool isComputerEngine(engine_kind e)
+{
+    return e < NUM_ENGINE_KINDS && engineRegistry[e].create != nullptr;
+}
+
+/**
+ * @brief Set the resources of an engine (before its first use)
+ *
+ */
+void setEngineSettings(engine_kind e, const engine_settings &s)
+{
+    if (e < NUM_ENGINE_KINDS)
+    {
+        engineRegistry[e].settings = s;
+    }
+}
+
+/**
+ * @brief Get the resources of an engine
+ *
+ * @return engine_settings the settings (the defaults if never set)
+ */
+engine_settings getEngineSettings(engine_kind e)
+{
+    return e < NUM_ENGINE_KINDS ? engineRegistry[e].settings : engine_settings{};
+}
+
+/**
+ * @brief Get the memory used by an engine
+ *
+ * @return size_t bytes (0 if not created yet)
+ */
+size_t engineMemory(engine_kind e)
+{
+    engine *instance = e < NUM_ENGINE_KINDS ? engineRegistry[e].instance : nullptr;
+    return instance != nullptr ? instance->memory() : 0;
+}
+
+/**
+ * @brief Get a move from the engine of the player to move
+ *
+ * Thread safe, as getMove; human and remote players get the solver move.
+ *
+ * @return square the chosen cell
+ */
+square getEngineMove(const game &g)
+{
+    TimePoint start = theClock.now();
+    engine_kind kind = g.engines[getTurn(g)];
+    if ((kind == ENGINE_MCTS || kind == ENGINE_ALPHABETA || kind == ENGINE_NNUE) && g.numPlayers > NUM_PLAYERS)
+    {
+        kind = ENGINE_SOLVER; // the playouts and the evaluation score two players
+    }
+    engine_entry &e = engineRegistry[isComputerEngine(kind) ? kind : ENGINE_SOLVER];
+    call_once(e.created, [&e] { e.instance = e.create(e.settings); });
+    square move = e.instance->chooseMove(g);
+    recordLatency(LAT_GET_MOVE, g.DIM, getMoveNumber(g), Duration(theClock.now() - start).count());
+    return move;
+}
+
+#endif
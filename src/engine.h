@@ -0,0 +1,92 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+// The engines =================================================================
+/**
+ * I motori che scelgono le mosse del computer: ognuno è registrato con un
+ * nome (usato in config.ini) ed è creato solo al primo uso, con le proprie
+ * risorse (thread, memoria, tempo per mossa). Ogni giocatore "computer"
+ * usa il motore indicato nella configurazione.
+ * Il tipo di motore è anche registrato con ogni partita giocata.
+ */
+
+#include <cstddef>
+
+/**
+ * @brief who chooses the moves of a player
+ *
+ */
+enum engine_kind
+{
+    ENGINE_HUMAN,     ///< the console user
+    ENGINE_SOLVER,    ///< the exact solver (getMove)
+    ENGINE_REMOTE,    ///< a server client
+    ENGINE_RANDOM,    ///< any empty cell
+    ENGINE_WEAK,      ///< the solver, with random blunders
+    ENGINE_MCTS,      ///< Monte Carlo tree search (random playouts)
+    ENGINE_ALPHABETA, ///< depth-limited alpha-beta (static evaluation of the lines)
+    ENGINE_NNUE,      ///< alpha-beta, a trained network as the evaluation
+    NUM_ENGINE_KINDS  ///< fake code: total number of kinds
+};
+
+/**
+ * @brief the resources of an engine
+ *
+ */
+struct engine_settings
+{
+    int threads{1};        ///< search threads per move
+    size_t megabytes{64};  ///< memory (the solver uses the configured table size)
+    double seconds{0.1};   ///< think time per move (searching engines)
+};
+
+/**
+ * @brief Get the name of an engine kind
+ *
+ * @return const char* the name
+ */
+const char *engineName(engine_kind);
+
+/**
+ * @brief Find an engine kind by name
+ *
+ * @return engine_kind the kind (NUM_ENGINE_KINDS if unknown)
+ */
+engine_kind engineKind(const char name[]);
+
+/**
+ * @brief Check whether the computer plays with an engine kind
+ *
+ * @return true if the engine chooses moves by itself (not human nor remote)
+ */
+bool isComputerEngine(engine_kind);
+
+/**
+ * @brief Set the resources of an engine (before its first use)
+ *
+ */
+void setEngineSettings(engine_kind, const engine_settings &);
+
+/**
+ * @brief Get the resources of an engine
+ *
+ * @return engine_settings the settings (the defaults if never set)
+ */
+engine_settings getEngineSettings(engine_kind);
+
+/**
+ * @brief Get the memory used by an engine
+ *
+ * @return size_t bytes (0 if not created yet)
+ */
+size_t engineMemory(engine_kind);
+
+/**
+ * @brief Benchmark the static evaluation (cell loop, line counts, pext patterns) and the alpha-beta search
+ *
+ * @param seconds   duration of each run
+ * @return int the exit code (not 0 if the evaluations disagree)
+ */
+int runEvalBench(double seconds);
+
+#endif
@@ -2,7 +2,21 @@
 #define GAME_CPP
 
 #include "game.h"
+#include "perfect3.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 using namespace std;
 
@@ -13,28 +27,288 @@ using Duration = std::chrono::duration<double>;
 const Clock theClock;
 
 #define MIN_DIM 3                 ///< min board dimension
-#define NUM_PLAYERS 2             ///< number of players
-#define PLAYER_NONE (NUM_PLAYERS) ///< none of current players
+#define NUM_PLAYERS 2             ///< number of players (of the standard game)
+#define MAX_PLAYERS 3             ///< max number of players (more than NUM_PLAYERS: see multiplayer.h)
+#define PLAYER_NONE (MAX_PLAYERS) ///< none of current players
+#define SOLVER_MEGABYTES 256      ///< default solved positions table size (4x4 AI)
+#define SOLVER_VERSION 1          ///< change when stored values change meaning
+#define DISTANCE_KEY (1ull << 32) ///< solved positions: key bit of the distances to the end (not outcomes)
+#define BOOK_MAGIC "TTTBOOK"        ///< opening book file signature
+#define BOOK_VERSION 1              ///< opening book file format version
+#define SOLVER_SHARED_NAME "/tictactoe-solved" ///< shared solved positions prefix (dimension appended)
+#define EVAL_LINE_WEIGHT 8          ///< static evaluation: value ratio of a line with one more piece
 
 using moves = unsigned int; ///< bitmap for moves
-// computed at every new game ...
-moves ALL_MOVES, WINNINGS[MAX_DIM + MAX_DIM + 2];
-size_t NUM_WINNINGS, NUM_CELLS;
-square MIN_CELL, MAX_CELL;
 
 // representation of the game configuration
 using config = unsigned int;
-// (NUM_CELLS + NUM_CELLS LSBits) = player moves
-enum outcome
+// (numCells + numCells LSBits) = player moves
+
+/**
+ * @brief rules and solver data for a board dimension
+ *
+ * Computed once per dimension and shared by all its games, on any thread:
+ * the board data never changes after initialization, the solved positions
+ * are kept in a lock-free table.
+ */
+struct rules
 {
-    WINNING, ///< turn player wins
-    LOSING,  ///< turn player loses
-    DRAW     ///< nobody wins/loses
+    int dim;                               ///< board dimension
+    size_t numCells;                       ///< number of cells
+    square minCell, maxCell;               ///< first and last cell
+    moves full;                            ///< all the cells
+    moves bottom;                          ///< the bottom row (where the pieces stop, with gravity)
+    moves winnings[MAX_DIM + MAX_DIM + 2]; ///< winning lines
+    size_t numWinnings;                    ///< number of winning lines
+    config lineMasks[MAX_DIM + MAX_DIM + 2];     ///< winning lines of both players (see evaluateConfig)
+    int lineScores[MAX_DIM + 1][MAX_DIM + 1];    ///< line value by the pieces of the player to move and of the other
+    int linePatterns[1 << (MAX_DIM + MAX_DIM)];  ///< line value by pext of lineMasks (the player to move first)
+    symmetry_tables symmetries;            ///< board transforms
+    mutable atomic<transposition_table *> results; ///< solved positions (4x4 solver, see solverTable)
+    mutable once_flag resultsCreated;              ///< results created (by the first search)
 };
 
-// AI map for 4x4 board
-#include <map>
-map<config, outcome> results;
+// solved positions table settings (used when the rules are first needed)
+size_t solverMegabytes = SOLVER_MEGABYTES;
+bool solverHugePages = true;
+bool solverShared = false; ///< whether the table is shared by the processes of the host
+string snapshotPrefix; ///< snapshot files prefix (empty = no snapshots)
+
+/**
+ * @brief identify rules and the meaning of solved values (for saved data)
+ *
+ */
+uint64_t rulesId(const rules &r)
+{
+    return (uint64_t(SOLVER_VERSION) << 32) | (r.dim << 16) | r.numWinnings;
+}
+
+/**
+ * @brief compute the board data for a dimension
+ *
+ * @param r     the rules to initialize
+ * @param dim   the board dimension
+ */
+void initRules(rules &r, int dim)
+{
+    // compute dimensions and moves
+    r.dim = dim;
+    r.numCells = dim * dim;
+    r.minCell = 0;
+    r.maxCell = r.minCell + r.numCells - 1;
+    r.full = (1 << r.numCells) - 1;
+    r.bottom = ((1 << dim) - 1) << (dim * (dim - 1));
+    moves firstCol = 0, mainDiagonal = 0, coDiagonal = 0;
+    for (int i = 0; i < dim; i++)
+    {
+        firstCol |= 1 << (i * dim);
+        mainDiagonal |= 1 << (i * (dim + 1));
+        coDiagonal |= 1 << ((i + 1) * (dim - 1));
+        r.winnings[i] = ((1 << dim) - 1) << (i * dim);
+    }
+    for (int i = 0; i < dim; i++)
+    {
+        r.winnings[i + dim] = firstCol << i;
+    }
+    r.winnings[dim + dim] = mainDiagonal;
+    r.winnings[dim + dim + 1] = coDiagonal;
+    r.numWinnings = dim + dim + 2;
+    // line values: lines with pieces of both players are dead
+    for (int mine = 0; mine <= dim; mine++)
+    {
+        for (int other = 0; other <= dim; other++)
+        {
+            int pieces = max(mine, other), value = pieces > 0 ? 1 : 0;
+            for (int k = 1; k < pieces; k++)
+            {
+                value *= EVAL_LINE_WEIGHT;
+            }
+            r.lineScores[mine][other] = mine > 0 && other > 0 ? 0 : other > 0 ? -value : value;
+        }
+    }
+    for (size_t i = 0; i < r.numWinnings; i++)
+    {
+        r.lineMasks[i] = r.winnings[i] | r.winnings[i] << r.numCells;
+    }
+    for (int pattern = 0; pattern < 1 << (dim + dim); pattern++)
+    {
+        r.linePatterns[pattern] = r.lineScores[__builtin_popcount(pattern & ((1 << dim) - 1))][__builtin_popcount(pattern >> dim)];
+    }
+    initSymmetries(r.symmetries, dim);
+    r.results = nullptr;
+}
+
+/**
+ * @brief create the solved positions table of the rules
+ *
+ */
+void createSolverTable(const rules &r)
+{
+    uint64_t id = rulesId(r);
+    bool created = true;
+    transposition_table *table = nullptr;
+    if (solverShared)
+    {
+        string name = SOLVER_SHARED_NAME + to_string(r.dim) + "x" + to_string(r.dim);
+        table = newSharedTable(name.c_str(), solverMegabytes << 20, solverHugePages, id, created);
+    }
+    if (table == nullptr)
+    {
+        table = newTable(solverMegabytes << 20, solverHugePages); // private (or shared not usable)
+    }
+    if (created && !snapshotPrefix.empty())
+    {
+        // a shared table is loaded and saved by the process creating it
+        string path = snapshotPrefix + to_string(r.dim) + "x" + to_string(r.dim) + ".tt";
+        attachSnapshot(*table, path.c_str(), id);
+    }
+    r.results = table;
+}
+
+/**
+ * @brief Get the solved positions table of the rules
+ *
+ * Created by the first search: games played by other engines need no memory.
+ *
+ * @return transposition_table& the table
+ */
+transposition_table &solverTable(const rules &r)
+{
+    call_once(r.resultsCreated, createSolverTable, cref(r));
+    return *r.results;
+}
+
+/**
+ * @brief Get the rules for a board dimension (initialized on first use)
+ *
+ * @param dim   the board dimension
+ * @return rules& the shared rules
+ */
+rules allRules[MAX_DIM + 1];
+once_flag rulesInitialized[MAX_DIM + 1];
+rules &getRules(int dim)
+{
+    call_once(rulesInitialized[dim], initRules, ref(allRules[dim]), dim);
+    return allRules[dim];
+}
+
+/**
+ * @brief Set the memory for solved positions
+ *
+ * @param megabytes the table size (fixed, whatever the board dimension)
+ * @param hugePages whether to use transparent huge pages
+ * @param shared    whether to share the table with the other processes
+ */
+void setSolverMemory(size_t megabytes, bool hugePages, bool shared)
+{
+    solverMegabytes = megabytes;
+    solverHugePages = hugePages;
+    solverShared = shared;
+}
+
+// background snapshot writer
+thread snapshotWriter;
+mutex snapshotLock;
+condition_variable snapshotWake;
+bool snapshotStop = false;
+
+/**
+ * @brief Write the positions solved since the last save to the snapshots
+ *
+ */
+void saveSolverSnapshots()
+{
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        if (allRules[dim].results != nullptr)
+        {
+            flushSnapshot(*allRules[dim].results, false);
+        }
+    }
+}
+
+/**
+ * @brief Keep solved positions in snapshot files (before the first game)
+ *
+ * Snapshots are loaded when a board dimension is first used, then saved in
+ * the background every interval seconds.
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ * @param interval  seconds between background saves
+ */
+void startSolverSnapshots(const char prefix[], double interval)
+{
+    snapshotPrefix = prefix;
+    snapshotStop = false;
+    snapshotWriter = thread([interval] {
+        unique_lock<mutex> lock(snapshotLock);
+        while (!snapshotWake.wait_for(lock, Duration(interval), [] { return snapshotStop; }))
+        {
+            saveSolverSnapshots();
+        }
+    });
+}
+
+/**
+ * @brief Stop the background saves and write the snapshots
+ *
+ * No game may be played meanwhile.
+ */
+void stopSolverSnapshots()
+{
+    if (snapshotWriter.joinable())
+    {
+        {
+            lock_guard<mutex> lock(snapshotLock);
+            snapshotStop = true;
+        }
+        snapshotWake.notify_all();
+        snapshotWriter.join();
+    }
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        if (allRules[dim].results != nullptr)
+        {
+            detachSnapshot(*allRules[dim].results);
+        }
+    }
+}
+
+/**
+ * @brief Print the usage of the solved positions tables
+ *
+ */
+void printSolverReport(ostream &out)
+{
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        if (allRules[dim].results != nullptr)
+        {
+            out << "Solved positions " << dim << "x" << dim << ": ";
+            printTableStats(out, getTableStats(*allRules[dim].results));
+        }
+    }
+    out.flush();
+}
+
+/**
+ * @brief Get the memory of the solved positions tables created so far
+ *
+ * @return size_t bytes
+ */
+size_t getSolverMemory()
+{
+    size_t bytes = 0;
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        transposition_table *table = allRules[dim].results;
+        if (table != nullptr)
+        {
+            bytes += getTableStats(*table).bytes;
+        }
+    }
+    return bytes;
+}
 
 /**
  * @brief game representation
@@ -43,38 +317,26 @@ map<config, outcome> results;
 struct game
 {
     int DIM{BOARD_DIM};                    ///< dimensione del gioco
-    moves done[NUM_PLAYERS]{0, 0};         ///< mosse effettuate
+    int numPlayers{NUM_PLAYERS};           ///< giocatori
+    moves done[MAX_PLAYERS]{};             ///< mosse effettuate
     player turn{rand() % NUM_PLAYERS};     ///< random turn
-    player winner{NUM_PLAYERS};            ///< winner
+    player winner{PLAYER_NONE};            ///< winner
     status state;                          ///< stato del gioco
     double timeAllowed{TIME_ALLOWED};      ///< tempo concesso per le mosse
     TimePoint startTime{theClock.now()};   ///< istante inizio
-    Duration elapsed[NUM_PLAYERS]{0s, 0s}; ///< elapsed time
+    Duration elapsed[MAX_PLAYERS]{};       ///< elapsed time
+    bool notify{true};                     ///< whether to notify the UI
+    rules *r{nullptr};                     ///< rules and solver data
+    unsigned seed{0};                      ///< random choices of the game
+    player first{0};                       ///< player making the first move
+    engine_kind engines[MAX_PLAYERS]{};    ///< who chooses the moves of each player
+    uint64_t created{0};                   ///< start (milliseconds since the epoch)
+    square history[MAX_DIM * MAX_DIM];     ///< moves, in order
+    uint32_t millis[MAX_DIM * MAX_DIM];    ///< time of each move (milliseconds)
+    double turnClock{0};                   ///< elapsed time of the player to move at the start of the turn
+    bool gravity{false};                   ///< pieces drop to the lowest empty cell of the column
 };
 
-void initData(const game &g)
-{
-    // compute dimensions and moves
-    NUM_CELLS = g.DIM * g.DIM;
-    MIN_CELL = 0;
-    MAX_CELL = MIN_CELL + NUM_CELLS - 1;
-    ALL_MOVES = (1 << NUM_CELLS) - 1;
-    moves firstCol = 0, mainDiagonal = 0, coDiagonal = 0;
-    for (size_t i = 0; i < g.DIM; i++)
-    {
-        firstCol |= 1 << (i * g.DIM);
-        mainDiagonal |= 1 << (i * (g.DIM + 1));
-        coDiagonal |= 1 << ((i + 1) * (g.DIM - 1));
-        WINNINGS[i] = ((1 << g.DIM) - 1) << (i * g.DIM);
-    }
-    for (size_t i = 0; i < g.DIM; i++)
-    {
-        WINNINGS[i + g.DIM] = firstCol << i;
-    }
-    WINNINGS[g.DIM + g.DIM] = mainDiagonal;
-    WINNINGS[g.DIM + g.DIM + 1] = coDiagonal;
-    NUM_WINNINGS = g.DIM + g.DIM + 2;
-}
 /**
  * @brief Get a new game based on configuration
  * 
@@ -86,10 +348,22 @@ game newGame(const configuration &c)
     game g;
     g.timeAllowed = c.timeAllowed;
     g.DIM = c.boardDim;
-    initData(g);
-    // results.clear();
+    g.r = &getRules(g.DIM);
+    g.gravity = c.gravity;
+    g.numPlayers = max(NUM_PLAYERS, min(MAX_PLAYERS, int(c.players)));
+    g.notify = c.interactive;
     g.state = RUNNING;
-    gameStarted(g); // notify UI
+    g.seed = rand();
+    g.turn = g.first = g.seed % g.numPlayers;
+    g.created = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    if (g.notify)
+    {
+        for (int p = 0; p < g.numPlayers; p++)
+        {
+            g.engines[p] = !isComputerPlayer(p) ? ENGINE_HUMAN : p < NUM_PLAYERS ? c.engines[p] : ENGINE_SOLVER;
+        }
+        gameStarted(g); // notify UI
+    }
     return g;
 }
 
@@ -123,6 +397,26 @@ player getWinner(const game &g)
     return g.winner;
 }
 
+/**
+ * @brief Get the player who ran out of time
+ *
+ * @return player the player (PLAYER_NONE if none)
+ */
+player getTimedOut(const game &g)
+{
+    return getStatus(g) == TIMEOUT ? g.turn : PLAYER_NONE;
+}
+
+/**
+ * @brief Get the number of players
+ *
+ * @return int the players (NUM_PLAYERS .. MAX_PLAYERS)
+ */
+int getNumPlayers(const game &g)
+{
+    return g.numPlayers;
+}
+
 /**
  * @brief Get the player of a cell
  * 
@@ -130,10 +424,10 @@ player getWinner(const game &g)
  */
 player getCellPlayer(const game &g, square c)
 {
-    if (MIN_CELL <= c && c <= MAX_CELL)
+    if (g.r->minCell <= c && c <= g.r->maxCell)
     {
-        moves move = 1 << (c - MIN_CELL);
-        for (int p = 0; p < NUM_PLAYERS; p++)
+        moves move = 1 << (c - g.r->minCell);
+        for (int p = 0; p < g.numPlayers; p++)
         {
             if ((move & g.done[p]) != 0)
             {
@@ -141,7 +435,37 @@ player getCellPlayer(const game &g, square c)
             }
         }
     }
-    return NUM_PLAYERS;
+    return PLAYER_NONE;
+}
+
+/**
+ * @brief Get the first cell of the board
+ *
+ * @return square the first cell
+ */
+square getMinCell(const game &g)
+{
+    return g.r->minCell;
+}
+
+/**
+ * @brief Get the last cell of the board
+ *
+ * @return square the last cell
+ */
+square getMaxCell(const game &g)
+{
+    return g.r->maxCell;
+}
+
+/**
+ * @brief Get the number of cells of the board
+ *
+ * @return int the number of cells
+ */
+int getNumCells(const game &g)
+{
+    return g.r->numCells;
 }
 
 /**
@@ -160,7 +484,7 @@ double getElapsed(const game &g, player p)
             return elapsed.count() > g.timeAllowed ? g.timeAllowed : elapsed.count();
         }
     }
-    if (p < NUM_PLAYERS)
+    if (int(p) < g.numPlayers)
     {
         return g.elapsed[p].count();
     }
@@ -170,15 +494,16 @@ double getElapsed(const game &g, player p)
 /**
  * @brief check whether the moves are winning
  * 
+ * @param r the rules
  * @param m the moves
  * @return true if winning
  * @return false otherwise
  */
-bool isWinning(moves m)
+bool isWinning(const rules &r, moves m)
 {
-    for (size_t i = 0; i < NUM_WINNINGS; i++)
+    for (size_t i = 0; i < r.numWinnings; i++)
     {
-        if ((m & WINNINGS[i]) == WINNINGS[i])
+        if ((m & r.winnings[i]) == r.winnings[i])
         {
             return true;
         }
@@ -186,6 +511,52 @@ bool isWinning(moves m)
     return false;
 }
 
+/**
+ * @brief static evaluation by line piece counts (any processor)
+ *
+ * @param cfg   the position (player to move in the low half)
+ * @return int the value for the player to move
+ */
+int countEvaluate(const rules &r, config cfg)
+{
+    int value = 0;
+    for (size_t i = 0; i < r.numWinnings; i++)
+    {
+        value += r.lineScores[__builtin_popcount(cfg & r.winnings[i])][__builtin_popcount(cfg >> r.numCells & r.winnings[i])];
+    }
+    return value;
+}
+
+/**
+ * @brief static evaluation by line patterns (only if the processor has BMI2)
+ *
+ * @param cfg   the position (player to move in the low half)
+ * @return int the value for the player to move
+ */
+__attribute__((target("bmi2"))) int pextEvaluate(const rules &r, config cfg)
+{
+    int value = 0;
+    for (size_t i = 0; i < r.numWinnings; i++)
+    {
+        value += r.linePatterns[_pext_u32(cfg, r.lineMasks[i])];
+    }
+    return value;
+}
+
+/**
+ * @brief static evaluation of a position not over, for depth-limited searches
+ *
+ * Sum of the values of the lines: open lines (pieces of one player only) are
+ * worth EVAL_LINE_WEIGHT times more for each piece, dead lines nothing.
+ *
+ * @param cfg   the position (player to move in the low half)
+ * @return int the value for the player to move (positive if better)
+ */
+int evaluateConfig(const rules &r, config cfg)
+{
+    return r.symmetries.bmi2 ? pextEvaluate(r, cfg) : countEvaluate(r, cfg);
+}
+
 /**
  * @brief return all moves made so far
  * 
@@ -195,108 +566,101 @@ bool isWinning(moves m)
 moves allMoves(const game &g)
 {
     moves result = 0;
-    for (player p = 0; p < NUM_PLAYERS; p++)
+    for (int p = 0; p < g.numPlayers; p++)
     {
         result |= g.done[p];
     }
     return result;
 }
 
-// Reverse row tranform assuming DIM = 4
-// IN:  3333222211110000 3333222211110000
-// OUT: 0000111122223333 0000111122223333
-inline config RR4(config c)
-{
-#define RR4_LOW8_MASK ((config)0x00FF00FF)
-#define RR4_HIGH8_MASK ((config)0xFF00FF00)
-#define RR4_LOW4_MASK ((config)0x0F0F0F0F)
-#define RR4_HIGH4_MASK ((config)0xF0F0F0F0)
-    // h:  1111000033332222 1111000033332222
-    config h = ((c & RR4_LOW8_MASK) << 8) | ((c & RR4_HIGH8_MASK) >> 8);
-    // return:  0000111122223333 0000111122223333
-    return ((h & RR4_LOW4_MASK) << 4) | ((h & RR4_HIGH4_MASK) >> 4);
-}
-
-// Reverse column tranform assuming DIM = 4
-// IN:  3210321032103210 3210321032103210
-// OUT: 0123012301230123 0123012301230123
-inline config RC4(config c)
-{
-#define RC4_LOW8_MASK ((config)0x33333333)
-#define RC4_HIGH8_MASK ((config)0xCCCCCCCC)
-#define RC4_HIGH4_MASK ((config)0xAAAAAAAA)
-#define RC4_LOW4_MASK ((config)0x55555555)
-    // h:  1032103210321032 1032103210321032
-    config h = ((c & RC4_LOW8_MASK) << 2) | ((c & RC4_HIGH8_MASK) >> 2);
-    // return:  0123012301230123 0123012301230123
-    return ((h & RC4_LOW4_MASK) << 1) | ((h & RC4_HIGH4_MASK) >> 1);
-}
-
-// Exchange row/column tranform assuming DIM = 4
-// IN:  FEDCBA9876543210 FEDCBA9876543210
-// OUT: FB73EA62D951C840 FB73EA62D951C840
-inline config X4(config c)
-{
-#define X4_NO_SHIFT ((config)0x84218421)
-#define X4_SHIFT_P3 ((config)0x08420842)
-#define X4_SHIFT_P6 ((config)0x00840084)
-#define X4_SHIFT_P9 ((config)0x00080008)
-#define X4_SHIFT_M3 ((config)0x42104210)
-#define X4_SHIFT_M6 ((config)0x21002100)
-#define X4_SHIFT_M9 ((config)0x10001000)
-    config r = (c & X4_NO_SHIFT) |
-               ((c & X4_SHIFT_P3) << 3) |
-               ((c & X4_SHIFT_M3) >> 3) |
-               ((c & X4_SHIFT_P6) << 6) |
-               ((c & X4_SHIFT_M6) >> 6) |
-               ((c & X4_SHIFT_P9) << 9) |
-               ((c & X4_SHIFT_M9) >> 9);
-    return r;
-}
-
-void setConfigResult(config c0, outcome o)
-{
-    results[c0] = o;
-    config c1 = X4(c0);
-    results[c1] = o;
-    config c2 = RR4(c0);
-    results[c2] = o;
-    config c3 = RR4(c1);
-    results[c3] = o;
-    config c4 = RC4(c0);
-    results[c4] = o;
-    config c5 = RC4(c1);
-    results[c5] = o;
-    config c6 = RC4(c2);
-    results[c6] = o;
-    config c7 = RC4(c3);
-    results[c7] = o;
-}
-outcome checkConfig4(config cfg, moves all)
+/**
+ * @brief the empty cells a move can be made on
+ *
+ * @param all       the occupied cells
+ * @param gravity   whether only the lowest empty cell of each column is allowed
+ */
+moves dropMoves(const rules &r, moves all, bool gravity)
+{
+    moves empty = r.full & ~all;
+    return gravity ? empty & ((all >> r.dim) | r.bottom) : empty; // the cell below occupied
+}
+
+/**
+ * @brief the empty cells a move can be made on
+ *
+ */
+moves legalMoves(const game &g)
+{
+    return dropMoves(*g.r, allMoves(g), g.gravity);
+}
+
+/**
+ * @brief Get the cell a move lands on
+ *
+ * @return square the lowest empty cell of its column with gravity (the cell itself if none)
+ */
+square getDropCell(const game &g, square c)
+{
+    if (g.gravity && g.r->minCell <= c && c <= g.r->maxCell)
+    {
+        moves all = allMoves(g);
+        for (int i = (g.DIM - 1) * g.DIM + (c - g.r->minCell) % g.DIM; i >= 0; i -= g.DIM)
+        {
+            if ((all & (1 << i)) == 0)
+            {
+                return g.r->minCell + i;
+            }
+        }
+    }
+    return c;
+}
+
+/**
+ * @brief Get the number of moves made so far
+ *
+ * @return int the number of moves
+ */
+int getMoveNumber(const game &g)
+{
+    return __builtin_popcount(allMoves(g));
+}
+
+// the searches below use r.results, created by their callers (solverTable)
+// depth = number of empty cells (size of the solved subtree)
+void setConfigResult(rules &r, config c0, outcome o, unsigned depth)
+{
+    config images[NUM_SYMMETRIES];
+    symmetricImages(r.symmetries, c0, images);
+    for (config c : images)
+    {
+        storeTable(*r.results, positionKey(c), o, depth);
+    }
+}
+outcome checkConfig4(rules &r, config cfg, moves all)
 {
     // cfg = minConfig(cfg);
-    auto chk = results.find(cfg);
-    if (chk != results.end())
+    unsigned cached;
+    if (probeTable(*r.results, positionKey(cfg), cached))
     {
-        return chk->second;
+        return outcome(cached);
     }
     outcome result = WINNING;
-    if (!isWinning(cfg))
+    if (!isWinning(r, cfg))
     {
-        if (all == ALL_MOVES)
+        if (all == r.full)
         {
             result = DRAW;
         }
         else
         {
             // check other player's moves
-            config other = ((cfg & ALL_MOVES) << NUM_CELLS) | (cfg >> NUM_CELLS);
-            moves value = 1;
-            while (value < ALL_MOVES && result != LOSING)
+            config other = ((cfg & r.full) << r.numCells) | (cfg >> r.numCells);
+            moves candidates = distinctCells(r.symmetries, cfg, r.full & ~all), value = 1;
+            while (value < r.full && result != LOSING)
             {
-                if ((value & all) == 0)
+                if ((value & candidates) != 0)
                 {
-                    outcome chk = checkConfig4(other | value, all | value);
+                    outcome chk = checkConfig4(r, other | value, all | value);
                     if (chk == WINNING)
                     {
                         result = LOSING;
@@ -310,99 +674,710 @@ outcome checkConfig4(config cfg, moves all)
             }
         }
     }
-    setConfigResult(cfg, result);
+    setConfigResult(r, cfg, result, r.numCells - __builtin_popcount(all));
     return result;
 }
-outcome checkConfig(config cfg, moves all)
+/**
+ * @brief search the best move of a position (4x4)
+ *
+ * @param cfg   the position (player to move in the low half)
+ * @param all   the occupied cells
+ * @param o     the outcome for the player to move
+ * @return square the first winning move, else the last drawing one, else the first empty one
+ */
+square bestConfigMove(rules &r, config cfg, moves all, outcome &o)
 {
-    outcome result = WINNING;
-    if (!isWinning(cfg))
+    solverTable(r);
+    moves candidates = distinctCells(r.symmetries, cfg, r.full & ~all), value = 1; // symmetric moves are equivalent
+    square result = r.minCell + __builtin_ctz(candidates), current = r.minCell;
+    o = LOSING;
+    while (current <= r.maxCell)
     {
-        if (all == ALL_MOVES)
-        {
-            result = DRAW;
-        }
-        else
+        if ((value & candidates) != 0)
         {
-            // check other player's moves
-            cfg = ((cfg & ALL_MOVES) << NUM_CELLS) | (cfg >> NUM_CELLS);
-            moves value = 1;
-            while (value < ALL_MOVES && result != LOSING)
+            outcome chk = checkConfig4(r, cfg | value, all | value);
+            if (chk == WINNING)
             {
-                if ((value & all) == 0)
-                {
-                    outcome chk = checkConfig(cfg | value, all | value);
-                    if (chk == WINNING)
-                    {
-                        result = LOSING;
-                    }
-                    else if (chk == DRAW)
-                    {
-                        result = DRAW;
-                    }
-                }
-                value <<= 1;
+                o = WINNING;
+                return current;
+            }
+            if (chk == DRAW)
+            {
+                o = DRAW;
+                result = current;
             }
         }
+        value <<= 1;
+        current++;
     }
     return result;
 }
-
 square bestMove(const game &g)
 {
-    config cfg = g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << NUM_CELLS);
+    config cfg = g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << g.r->numCells);
+    outcome o;
+    return bestConfigMove(*g.r, cfg, allMoves(g), o);
+}
+
+/**
+ * @brief choose a 3x3 move from the table computed at compile time
+ *
+ * @return square an optimal move (a random one for the first move)
+ */
+square perfectMove(const game &g)
+{
+    moves mine = g.done[getTurn(g)], other = g.done[1 - getTurn(g)];
+    unsigned best = PERFECT3.entries[PERFECT3.base3[mine] + 2 * PERFECT3.base3[other]] & P3_MOVES_MASK;
+    if ((mine | other) == 0)
+    {
+        // first move: all draw, vary the games
+        for (int skip = g.seed / NUM_PLAYERS % __builtin_popcount(best); skip > 0; skip--)
+        {
+            best &= best - 1;
+        }
+    }
+    return g.r->minCell + __builtin_ctz(best);
+}
+
+/**
+ * @brief choose a move using only already solved positions (4x4)
+ *
+ * @param move  the chosen cell (if any)
+ * @return true if the move has been chosen
+ * @return false if some position has still to be solved
+ */
+bool cachedMove(const game &g, square &move)
+{
+    const rules &r = *g.r;
+    config cfg = g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << r.numCells);
     moves all = allMoves(g), value = 1;
-    square result = MIN_CELL, current = MIN_CELL;
-    if (all == 0 && g.DIM == 3)
+    moves candidates = distinctCells(r.symmetries, cfg, r.full & ~all);
+    square result = r.minCell + __builtin_ctz(candidates); // when all lose
+    for (square current = r.minCell; current <= r.maxCell; current++, value <<= 1)
     {
-        // first move
-        result = (rand() % 2) * (g.DIM - 1) + (rand() % 2) * g.DIM * (g.DIM - 1);
+        if ((value & candidates) != 0)
+        {
+            unsigned chk;
+            if (!probeTable(solverTable(r), positionKey(cfg | value), chk))
+            {
+                return false;
+            }
+            if (chk == WINNING)
+            {
+                result = current;
+                break;
+            }
+            if (chk == DRAW)
+            {
+                result = current;
+            }
+        }
     }
-    else
+    move = result;
+    return true;
+}
+
+// Opening book (4x4) ==========================================================
+
+/**
+ * @brief opening book file header (followed by the entries)
+ *
+ */
+struct book_header
+{
+    char magic[8];    ///< BOOK_MAGIC
+    uint32_t version; ///< BOOK_VERSION
+    uint32_t plies;   ///< moves covered
+    uint64_t rulesId; ///< rules the book was computed for
+    uint64_t entries; ///< number of entries
+};
+
+/**
+ * @brief an opening book position
+ *
+ */
+struct book_entry
+{
+    config position; ///< canonical position (player to move in the low half)
+    uint8_t move;    ///< best move (cell of the canonical position)
+    uint8_t result;  ///< outcome for the player to move
+    uint16_t unused; ///< padding
+};
+
+vector<book_entry> openingBook; ///< sorted by position (empty = no book)
+int bookPlies = -1;             ///< moves covered by the book
+
+/**
+ * @brief find the transform giving the canonical position
+ *
+ * @param cfg       the position
+ * @param canonical the canonical position
+ * @return int the transform
+ */
+int canonicalFrame(const rules &r, config cfg, config &canonical)
+{
+    config images[NUM_SYMMETRIES];
+    symmetricImages(r.symmetries, cfg, images);
+    int t = min_element(images, images + NUM_SYMMETRIES) - images;
+    canonical = images[t];
+    return t;
+}
+
+/**
+ * @brief map a cell of the canonical position back to the actual position
+ *
+ * @param t     the transform giving the canonical position
+ * @param cell  the cell of the canonical position
+ * @return square the cell moved to it by the transform
+ */
+square fromCanonical(const rules &r, int t, int cell)
+{
+    int result = 0;
+    while (symmetricCell(r.symmetries, t, result) != cell)
+    {
+        result++;
+    }
+    return r.minCell + result;
+}
+
+/**
+ * @brief Load the 4x4 opening book (before the first game)
+ *
+ * @param path  the book file
+ * @return true if loaded (the AI needs no initialization)
+ * @return false if missing or computed for other rules
+ */
+bool loadOpeningBook(const char path[])
+{
+    ifstream in(path, ios::binary);
+    book_header h{};
+    if (!in.read((char *)&h, sizeof(h)) || memcmp(h.magic, BOOK_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != BOOK_VERSION || h.rulesId != rulesId(getRules(4)))
+    {
+        return false;
+    }
+    vector<book_entry> entries(h.entries);
+    if (!in.read((char *)entries.data(), h.entries * sizeof(book_entry)))
     {
-        while (current <= MAX_CELL)
+        return false;
+    }
+    openingBook.swap(entries);
+    bookPlies = h.plies;
+    return true;
+}
+
+/**
+ * @brief Compute the 4x4 opening book: every position up to some moves
+ *
+ * Positions are canonical (one per symmetry class) and not ended.
+ *
+ * @param path  the book file
+ * @param plies the moves covered
+ * @return int the exit code
+ */
+int writeOpeningBook(const char path[], int plies)
+{
+    rules &r = getRules(4);
+    vector<book_entry> entries;
+    vector<config> level{0};
+    TimePoint start = theClock.now();
+    for (int ply = 0; ply <= plies && !level.empty(); ply++)
+    {
+        vector<config> next;
+        for (config cfg : level)
         {
-            if ((value & all) == 0)
+            moves all = (cfg | cfg >> r.numCells) & r.full;
+            outcome o;
+            square move = bestConfigMove(r, cfg, all, o);
+            entries.push_back({cfg, uint8_t(move - r.minCell), uint8_t(o), 0});
+            // the positions after each distinct move, seen by the opponent
+            moves candidates = distinctCells(r.symmetries, cfg, r.full & ~all);
+            for (moves value = 1; value < r.full; value <<= 1)
             {
-                outcome chk;
-                if (g.DIM == 3)
+                moves mine = (cfg & r.full) | value;
+                if ((value & candidates) != 0 && !isWinning(r, mine) && (all | value) != r.full)
                 {
-                    chk = checkConfig(cfg | value, all | value);
-                }
-                else
-                {
-                    chk = checkConfig4(cfg | value, all | value);
-                }
-                if (chk == WINNING)
-                {
-                    return current;
-                }
-                if (chk == DRAW)
-                {
-                    result = current;
+                    next.push_back(canonicalConfig(r.symmetries, (mine << r.numCells) | (cfg >> r.numCells)));
                 }
             }
-            value <<= 1;
-            current++;
         }
+        cout << "ply " << ply << ": " << level.size() << " positions, " << fixed << setprecision(1)
+             << Duration(theClock.now() - start).count() << " s" << defaultfloat << endl;
+        sort(next.begin(), next.end());
+        next.erase(unique(next.begin(), next.end()), next.end());
+        level.swap(next);
+    }
+    sort(entries.begin(), entries.end(), [](const book_entry &a, const book_entry &b) { return a.position < b.position; });
+    book_header h{};
+    memcpy(h.magic, BOOK_MAGIC, sizeof(h.magic));
+    h.version = BOOK_VERSION;
+    h.plies = plies;
+    h.rulesId = rulesId(r);
+    h.entries = entries.size();
+    ofstream out(path, ios::binary);
+    out.write((const char *)&h, sizeof(h));
+    out.write((const char *)entries.data(), entries.size() * sizeof(book_entry));
+    if (!out.flush())
+    {
+        cerr << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << entries.size() << " positions (" << (sizeof(h) + entries.size() * sizeof(book_entry)) / 1024
+         << " KB) written to " << path << endl;
+    return 0;
+}
+
+/**
+ * @brief choose a move from the opening book (4x4)
+ *
+ * @param move  the chosen cell (if any)
+ * @return true if the position is in the book
+ * @return false otherwise
+ */
+bool bookMove(const game &g, square &move)
+{
+    if (openingBook.empty() || g.DIM != 4 || getMoveNumber(g) > bookPlies)
+    {
+        return false;
+    }
+    const rules &r = *g.r;
+    config canonical;
+    int t = canonicalFrame(r, g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << r.numCells), canonical);
+    auto entry = lower_bound(openingBook.begin(), openingBook.end(), canonical,
+                             [](const book_entry &e, config c) { return e.position < c; });
+    if (entry == openingBook.end() || entry->position != canonical)
+    {
+        return false;
+    }
+    move = fromCanonical(r, t, entry->move);
+    return true;
+}
+
+// Weak solution strategies =====================================================
+
+#define STRATEGY_MAGIC "TTTSTRAT" ///< strategy file signature (no terminator)
+#define STRATEGY_VERSION 1        ///< strategy file format version
+
+/**
+ * @brief strategy file header (followed by the positions, then the moves)
+ *
+ */
+struct strategy_header
+{
+    char magic[8];    ///< STRATEGY_MAGIC
+    uint32_t version; ///< STRATEGY_VERSION
+    uint32_t dim;     ///< board dimension
+    uint64_t rulesId; ///< rules the strategy was computed for
+    uint64_t entries; ///< number of positions
+};
+
+/**
+ * @brief the AI replies in the positions its own play can reach
+ *
+ */
+struct strategy
+{
+    vector<config> positions; ///< canonical positions (sorted)
+    vector<uint8_t> moves;    ///< reply (cell of the canonical position)
+};
+
+strategy strategies[MAX_DIM + 1]; ///< by board dimension (empty = none)
+
+/**
+ * @brief the solved best move of a position (any dimension)
+ *
+ * @param cfg   the position (player to move in the low half)
+ * @param all   the occupied cells
+ * @return int the cell
+ */
+int solvedMove(rules &r, config cfg, moves all)
+{
+    if (r.dim == 3)
+    {
+        unsigned best = PERFECT3.entries[PERFECT3.base3[cfg & r.full] + 2 * PERFECT3.base3[cfg >> r.numCells]];
+        return __builtin_ctz(best & P3_MOVES_MASK);
+    }
+    outcome o;
+    return bestConfigMove(r, cfg, all, o) - r.minCell;
+}
+
+/**
+ * @brief the solved outcome of a move, for the player making it (any dimension)
+ *
+ * @param cfg   the position (player to move in the low half)
+ * @param all   the occupied cells
+ * @param cell  the empty cell played
+ * @return outcome the outcome with perfect play afterwards
+ */
+outcome moveOutcome(rules &r, config cfg, moves all, int cell)
+{
+    moves value = 1u << cell;
+    if (r.dim != 3)
+    {
+        solverTable(r);
+        return checkConfig4(r, cfg | value, all | value);
+    }
+    moves mine = (cfg & r.full) | value;
+    if (isWinning(r, mine))
+    {
+        return WINNING;
+    }
+    if ((all | value) == r.full)
+    {
+        return DRAW;
+    }
+    // the table outcome of the opponent, reversed
+    unsigned reply = PERFECT3.entries[PERFECT3.base3[cfg >> r.numCells] + 2 * PERFECT3.base3[mine]] >> P3_OUTCOME_SHIFT & 3;
+    return reply == WINNING ? LOSING : reply == LOSING ? WINNING : DRAW;
+}
+
+/**
+ * @brief the moves to the end of a game with perfect play (4x4)
+ *
+ * The winner takes its shortest win, the loser its longest loss; only the
+ * replies keeping the solved outcome are searched.
+ *
+ * @param cfg   the position after a move (its player in the low half, as in checkConfig4)
+ * @param all   the occupied cells
+ * @param o     the solved outcome for the player who moved
+ * @return unsigned the remaining moves
+ */
+unsigned configDistance4(rules &r, config cfg, moves all, outcome o)
+{
+    if (isWinning(r, cfg))
+    {
+        return 0;
+    }
+    if (o == DRAW)
+    {
+        return r.numCells - __builtin_popcount(all); // nobody wins: the board gets full
+    }
+    unsigned cached;
+    if (probeTable(*r.results, positionKey(DISTANCE_KEY | cfg), cached))
+    {
+        return cached;
+    }
+    config other = ((cfg & r.full) << r.numCells) | (cfg >> r.numCells);
+    moves candidates = distinctCells(r.symmetries, cfg, r.full & ~all);
+    unsigned result = o == WINNING ? 0 : TT_MAX_DEPTH;
+    for (moves rest = candidates; rest != 0; rest &= rest - 1)
+    {
+        moves value = rest & -rest;
+        outcome chk = checkConfig4(r, other | value, all | value); // for the opponent
+        if (o == LOSING && chk != WINNING)
+        {
+            continue; // the opponent wins: only its winning replies count
+        }
+        unsigned length = 1 + configDistance4(r, other | value, all | value, chk);
+        result = o == WINNING ? max(result, length) : min(result, length);
+    }
+    config images[NUM_SYMMETRIES];
+    symmetricImages(r.symmetries, cfg, images);
+    for (config c : images)
+    {
+        storeTable(*r.results, positionKey(DISTANCE_KEY | c), result, r.numCells - __builtin_popcount(all));
     }
     return result;
 }
 
 /**
- * @brief Get a move from the computer
+ * @brief analyze every move of a position (any dimension)
+ *
+ * @param cfg       the position (player to move in the low half)
+ * @param all       the occupied cells
+ * @param values    by cell, set for the empty cells only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeConfig(rules &r, config cfg, moves all, move_value values[])
+{
+    if (all == r.full || isWinning(r, cfg >> r.numCells))
+    {
+        return 0;
+    }
+    int count = 0;
+    for (moves rest = r.full & ~all; rest != 0; rest &= rest - 1, count++)
+    {
+        moves value = rest & -rest;
+        move_value &v = values[__builtin_ctz(value)];
+        if (r.dim == 3)
+        {
+            // the table entry of the opponent, reversed
+            unsigned reply = PERFECT3.entries[PERFECT3.base3[cfg >> r.numCells] + 2 * PERFECT3.base3[(cfg & r.full) | value]];
+            outcome o = outcome(reply >> P3_OUTCOME_SHIFT & 3);
+            v.result = o == WINNING ? LOSING : o == LOSING ? WINNING : DRAW;
+            v.length = 1 + (reply >> P3_DISTANCE_SHIFT);
+        }
+        else
+        {
+            solverTable(r);
+            v.result = checkConfig4(r, cfg | value, all | value);
+            v.length = 1 + configDistance4(r, cfg | value, all | value, v.result);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Analyze every move of the player to move, in one pass over the solved positions
+ *
+ * @param values    by cell (from the min cell), set for the empty cells only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeMoves(const game &g, move_value values[])
+{
+    if (g.numPlayers > NUM_PLAYERS)
+    {
+        return analyzeMultiplayerMoves(g, values);
+    }
+    if (g.gravity)
+    {
+        return analyzeGravityMoves(g, values);
+    }
+    if (getStatus(g) != RUNNING)
+    {
+        return 0;
+    }
+    config cfg = g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << g.r->numCells);
+    return analyzeConfig(*g.r, cfg, allMoves(g), values);
+}
+
+/**
+ * @brief add the positions reachable when the AI follows its strategy
+ *
+ * @param cfg       the position (player to move in the low half)
+ * @param aiToMove  whether the AI is to move
+ * @param visited   the canonical positions already expanded
+ * @param replies   the AI replies found
+ */
+void expandStrategy(rules &r, config cfg, bool aiToMove, unordered_set<config> &visited,
+                    vector<pair<config, uint8_t>> &replies)
+{
+    config canonical;
+    canonicalFrame(r, cfg, canonical);
+    if (!visited.insert(canonical).second)
+    {
+        return;
+    }
+    cfg = canonical; // replies in the canonical frame
+    moves all = (cfg | cfg >> r.numCells) & r.full;
+    moves candidates = r.full & ~all;
+    if (aiToMove)
+    {
+        int cell = solvedMove(r, cfg, all);
+        replies.emplace_back(cfg, cell);
+        candidates = 1 << cell;
+    }
+    else
+    {
+        candidates = distinctCells(r.symmetries, cfg, candidates); // any opponent move
+    }
+    for (moves value = 1; value < r.full; value <<= 1)
+    {
+        moves mine = (cfg & r.full) | value;
+        if ((value & candidates) != 0 && !isWinning(r, mine) && (all | value) != r.full)
+        {
+            expandStrategy(r, (mine << r.numCells) | (cfg >> r.numCells), !aiToMove, visited, replies);
+        }
+    }
+}
+
+/**
+ * @brief Compute the AI strategy for a board dimension, moving first or second
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ * @param dim       the board dimension
+ * @return int the exit code
+ */
+int writeStrategy(const char prefix[], int dim)
+{
+    if (dim < MIN_DIM || dim > MAX_DIM)
+    {
+        cerr << "Invalid board dimension " << dim << endl;
+        return 1;
+    }
+    rules &r = getRules(dim);
+    vector<pair<config, uint8_t>> replies;
+    TimePoint start = theClock.now();
+    for (int first = 0; first < NUM_PLAYERS; first++)
+    {
+        // positions are seen by the player to move: the roles depend on who started
+        unordered_set<config> visited;
+        expandStrategy(r, 0, first == 0, visited, replies);
+    }
+    sort(replies.begin(), replies.end());
+    strategy_header h{};
+    memcpy(h.magic, STRATEGY_MAGIC, sizeof(h.magic));
+    h.version = STRATEGY_VERSION;
+    h.dim = dim;
+    h.rulesId = rulesId(r);
+    h.entries = replies.size();
+    string path = string(prefix) + to_string(dim) + "x" + to_string(dim) + ".bin";
+    ofstream out(path, ios::binary);
+    out.write((const char *)&h, sizeof(h));
+    for (const auto &reply : replies)
+    {
+        out.write((const char *)&reply.first, sizeof(config));
+    }
+    for (const auto &reply : replies)
+    {
+        out.write((const char *)&reply.second, sizeof(uint8_t));
+    }
+    if (!out.flush())
+    {
+        cerr << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << replies.size() << " positions (" << fixed << setprecision(1)
+         << (sizeof(h) + replies.size() * (sizeof(config) + 1)) / 1024.0 << " KB) written to " << path << " in "
+         << Duration(theClock.now() - start).count() << " s" << defaultfloat << endl;
+    if (r.results != nullptr)
+    {
+        cout << "Solved positions " << dim << "x" << dim << ": ";
+        printTableStats(cout, getTableStats(*r.results));
+    }
+    return 0;
+}
+
+/**
+ * @brief Load the AI strategies (before the first game)
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ */
+void loadStrategies(const char prefix[])
+{
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        string path = string(prefix) + to_string(dim) + "x" + to_string(dim) + ".bin";
+        ifstream in(path, ios::binary);
+        strategy_header h{};
+        if (!in.read((char *)&h, sizeof(h)) || memcmp(h.magic, STRATEGY_MAGIC, sizeof(h.magic)) != 0 ||
+            h.version != STRATEGY_VERSION || h.dim != unsigned(dim) || h.rulesId != rulesId(getRules(dim)))
+        {
+            continue;
+        }
+        strategy s;
+        s.positions.resize(h.entries);
+        s.moves.resize(h.entries);
+        if (in.read((char *)s.positions.data(), h.entries * sizeof(config)) && in.read((char *)s.moves.data(), h.entries))
+        {
+            strategies[dim] = move(s);
+        }
+    }
+}
+
+/**
+ * @brief choose a move from the AI strategy
+ *
+ * @param move  the chosen cell (if any)
+ * @return true if the position is reachable by the strategy
+ * @return false otherwise (earlier moves were not chosen by the strategy)
+ */
+bool strategyMove(const game &g, square &move)
+{
+    const strategy &s = strategies[g.DIM];
+    if (s.positions.empty())
+    {
+        return false;
+    }
+    config canonical;
+    int t = canonicalFrame(*g.r, g.done[getTurn(g)] | (g.done[1 - getTurn(g)] << g.r->numCells), canonical);
+    auto position = lower_bound(s.positions.begin(), s.positions.end(), canonical);
+    if (position == s.positions.end() || *position != canonical)
+    {
+        return false;
+    }
+    move = fromCanonical(*g.r, t, s.moves[position - s.positions.begin()]);
+    return true;
+}
+
+/**
+ * @brief Get a move from the solver
+ *
+ * Safe to call concurrently on different games: solved positions are shared
+ * through a lock-free table, missing ones are solved by the calling thread.
  * 
  * @return square the chosen cell
  */
 square getMove(const game &g)
 {
-    return bestMove(g);
-    square result;
-    do
+    square move;
+    if (g.numPlayers > NUM_PLAYERS)
     {
-        result = MIN_CELL + rand() % NUM_CELLS;
-    } while (!isAllowedMove(g, result));
-    return result;
+        move = multiplayerMove(g); // a search of its own, with or without gravity
+    }
+    else if (g.gravity)
+    {
+        move = gravityMove(g); // other rules: a solver of their own
+    }
+    else if (strategyMove(g, move))
+    {
+        // position reached by the AI strategy: nothing to solve
+    }
+    else if (g.DIM == 3)
+    {
+        move = perfectMove(g); // no search for 3x3
+    }
+    else if (!bookMove(g, move) && !cachedMove(g, move))
+    {
+        ageTable(solverTable(*g.r));
+        move = bestMove(g);
+    }
+    return move;
+}
+
+/**
+ * @brief Set who chooses the moves of a player
+ *
+ */
+void setPlayerEngine(game &g, player p, engine_kind e)
+{
+    if (int(p) < g.numPlayers)
+    {
+        g.engines[p] = e;
+    }
+}
+
+/**
+ * @brief Set the player making the first move (before it)
+ *
+ */
+void setFirstPlayer(game &g, player p)
+{
+    if (int(p) < g.numPlayers && getMoveNumber(g) == 0)
+    {
+        g.turn = g.first = p;
+    }
+}
+
+/**
+ * @brief add an ended game to the records (if recording)
+ *
+ */
+void recordGame(const game &g)
+{
+    if (g.gravity || g.numPlayers != NUM_PLAYERS)
+    {
+        return; // the records (and the index built on them) hold games with the standard rules
+    }
+    game_record r;
+    r.dim = g.DIM;
+    r.numPlayers = NUM_PLAYERS;
+    r.first = g.first;
+    r.winner = g.winner < NUM_PLAYERS ? g.winner : RECORD_NO_WINNER;
+    r.timeout = g.state == TIMEOUT;
+    for (player p = 0; p < NUM_PLAYERS; p++)
+    {
+        r.engines[p] = g.engines[p];
+    }
+    r.seed = g.seed;
+    r.started = g.created;
+    r.numMoves = getMoveNumber(g);
+    for (int i = 0; i < r.numMoves; i++)
+    {
+        r.moves[i] = g.history[i] - g.r->minCell;
+        r.millis[i] = g.millis[i];
+    }
+    appendGameRecord(r);
 }
 
 /**
@@ -415,9 +1390,18 @@ bool makeMove(game &g, square c)
 {
     if (isAllowedMove(g, c))
     {
+        c = getDropCell(g, c);
+        TimePoint start = theClock.now();
+        int moveNumber = getMoveNumber(g);
         player current = getTurn(g);
-        g.done[current] |= 1 << (c - MIN_CELL);
-        if (isWinning(g.done[current]))
+        // the clock passes to the next player
+        double spent = getElapsed(g, current);
+        g.elapsed[current] = Duration(spent);
+        g.startTime = start;
+        g.history[moveNumber] = c;
+        g.millis[moveNumber] = uint32_t((spent - g.turnClock) * 1000 + 0.5);
+        g.done[current] |= 1 << (c - g.r->minCell);
+        if (isWinning(*g.r, g.done[current]))
         {
             g.winner = current;
             g.state = ENDED;
@@ -425,24 +1409,33 @@ bool makeMove(game &g, square c)
         }
         else
         {
-            if (allMoves(g) == ALL_MOVES)
+            if (allMoves(g) == g.r->full)
             {
                 g.state = ENDED;
             }
             else
             {
                 g.turn++;
-                if (g.turn == NUM_PLAYERS)
+                if (int(g.turn) == g.numPlayers)
                 {
                     g.turn = 0;
                 }
+                g.turnClock = g.elapsed[g.turn].count();
             }
         }
-        moveMade(g, c); // notify UI
         if (getStatus(g) != RUNNING)
         {
-            gameEnded(g); // notify UI
+            recordGame(g);
+        }
+        if (g.notify)
+        {
+            moveMade(g, c); // notify UI
+            if (getStatus(g) != RUNNING)
+            {
+                gameEnded(g); // notify UI
+            }
         }
+        recordLatency(LAT_MAKE_MOVE, g.DIM, moveNumber, Duration(theClock.now() - start).count());
         return true;
     }
     return false;
@@ -456,11 +1449,11 @@ bool makeMove(game &g, square c)
  */
 bool isAllowedMove(const game &g, square c)
 {
-    if (MIN_CELL <= c && c <= MAX_CELL)
+    if (g.r->minCell <= c && c <= g.r->maxCell)
     {
         if (getStatus(g) == RUNNING)
         {
-            moves move = 1 << (c - MIN_CELL);
+            moves move = 1 << (getDropCell(g, c) - g.r->minCell);
             return (allMoves(g) & move) == 0;
         }
     }
@@ -483,11 +1476,15 @@ void updateElapsed(game &g)
         {
             g.state = TIMEOUT;
             g.elapsed[current] = Duration(g.timeAllowed);
-            if (NUM_PLAYERS == 2)
+            if (g.numPlayers == 2)
             {
                 g.winner = 1 - current;
             }
-            gameEnded(g);
+            recordGame(g);
+            if (g.notify)
+            {
+                gameEnded(g);
+            }
         }
     }
 }
@@ -497,11 +1494,15 @@ void updateElapsed(game &g)
  */
 void initAI()
 {
+    if (!openingBook.empty())
+    {
+        return; // early positions answered by the book, the others are quick
+    }
     game g;
     g.DIM = 4;
+    g.r = &getRules(g.DIM);
     g.state = RUNNING;
-    initData(g);
-    square s = getMove(g);
+    getMove(g);
 }
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -32,6 +32,27 @@ enum status
     OVER = TIMEOUT | ENDED ///< over, for checking purposes
 };
 
+/**
+ * @brief solved outcome of a position
+ *
+ */
+enum outcome
+{
+    WINNING, ///< turn player wins
+    LOSING,  ///< turn player loses
+    DRAW     ///< nobody wins/loses
+};
+
+/**
+ * @brief the solved value of a move
+ *
+ */
+struct move_value
+{
+    outcome result; ///< for the player making the move
+    int length;     ///< moves to the end of the game, this one included (perfect play)
+};
+
 // actions available on the game (known to the application and the user interface)
 
 /**
@@ -62,6 +83,20 @@ player getTurn(const game &);
  */
 player getWinner(const game &);
 
+/**
+ * @brief Get the player who ran out of time
+ *
+ * @return player the player (PLAYER_NONE if none)
+ */
+player getTimedOut(const game &);
+
+/**
+ * @brief Get the number of players
+ *
+ * @return int the players (NUM_PLAYERS .. MAX_PLAYERS)
+ */
+int getNumPlayers(const game &);
+
 /**
  * @brief Get the player of a cell
  * 
@@ -69,6 +104,34 @@ player getWinner(const game &);
  */
 player getCellPlayer(const game &, square);
 
+/**
+ * @brief Get the first cell of the board
+ *
+ * @return square the first cell
+ */
+square getMinCell(const game &);
+
+/**
+ * @brief Get the last cell of the board
+ *
+ * @return square the last cell
+ */
+square getMaxCell(const game &);
+
+/**
+ * @brief Get the number of cells of the board
+ *
+ * @return int the number of cells
+ */
+int getNumCells(const game &);
+
+/**
+ * @brief Get the number of moves made so far
+ *
+ * @return int the number of moves
+ */
+int getMoveNumber(const game &);
+
 /**
  * @brief Get the elapsed time for the given player
  * 
@@ -77,12 +140,22 @@ player getCellPlayer(const game &, square);
 double getElapsed(const game &, player);
 
 /**
- * @brief Get a move from the computer
+ * @brief Get a move from the solver (thread safe)
  * 
  * @return square the chosen cell
  */
 square getMove(const game &);
 
+/**
+ * @brief Analyze every move of the player to move, in one pass over the solved positions
+ *
+ * Thread safe, as getMove; may take seconds on 4x4 positions not solved yet.
+ *
+ * @param values    by cell (from the min cell), set for the empty cells only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeMoves(const game &, move_value values[]);
+
 /**
  * @brief Allow a move to be made
  * 
@@ -94,11 +167,21 @@ bool makeMove(game &, square);
 /**
  * @brief Check if a move is allowed
  * 
+ * With gravity any cell of a column not full is allowed (the move lands
+ * on the lowest empty cell, see getDropCell).
+ *
  * @return true if move is allowed
  * @return false if move is not allowed
  */
 bool isAllowedMove(const game &, square);
 
+/**
+ * @brief Get the cell a move lands on
+ *
+ * @return square the lowest empty cell of its column with gravity (the cell itself if none)
+ */
+square getDropCell(const game &, square);
+
 /**
  * @brief update the time elapsed for the game
  * 
@@ -106,8 +189,109 @@ bool isAllowedMove(const game &, square);
 void updateElapsed(game &);
 
 /**
- * @brief Initialize AI map
+ * @brief Set who chooses the moves of a player
+ *
+ */
+void setPlayerEngine(game &, player, engine_kind);
+
+/**
+ * @brief Set the player making the first move (before it)
+ *
+ */
+void setFirstPlayer(game &, player);
+
+/**
+ * @brief Get a move from the engine of the player to move (see engine.h)
+ *
+ * Thread safe, as getMove; human and remote players get the solver move.
+ *
+ * @return square the chosen cell
+ */
+square getEngineMove(const game &);
+
+/**
+ * @brief Initialize AI map (nothing to do if the opening book is loaded)
  */
 void initAI();
 
-#endif
\ No newline at end of file
+/**
+ * @brief Load the 4x4 opening book (before the first game)
+ *
+ * @param path  the book file
+ * @return true if loaded (the AI needs no initialization)
+ * @return false if missing or computed for other rules
+ */
+bool loadOpeningBook(const char path[]);
+
+/**
+ * @brief Compute the 4x4 opening book: every position up to some moves
+ *
+ * @param path  the book file
+ * @param plies the moves covered
+ * @return int the exit code
+ */
+int writeOpeningBook(const char path[], int plies);
+
+/**
+ * @brief Load the AI strategies (before the first game)
+ *
+ * A strategy holds the AI reply in every position its own play can reach,
+ * whatever the opponent plays (a weak solution).
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ */
+void loadStrategies(const char prefix[]);
+
+/**
+ * @brief Compute the AI strategy for a board dimension, moving first or second
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ * @param dim       the board dimension
+ * @return int the exit code
+ */
+int writeStrategy(const char prefix[], int dim);
+
+/**
+ * @brief Set the memory for solved positions (before the first game)
+ *
+ * @param megabytes the table size (fixed, whatever the board dimension)
+ * @param hugePages whether to use transparent huge pages
+ * @param shared    whether to share the table with the other processes of
+ *                  the host (a segment of another size is used as it is)
+ */
+void setSolverMemory(size_t megabytes, bool hugePages, bool shared);
+
+/**
+ * @brief Keep solved positions in snapshot files (before the first game)
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ * @param interval  seconds between background saves
+ */
+void startSolverSnapshots(const char prefix[], double interval);
+
+/**
+ * @brief Write the positions solved since the last save to the snapshots
+ *
+ */
+void saveSolverSnapshots();
+
+/**
+ * @brief Stop the background saves and write the snapshots (no game running)
+ *
+ */
+void stopSolverSnapshots();
+
+/**
+ * @brief Print the usage of the solved positions tables
+ *
+ */
+void printSolverReport(std::ostream &);
+
+/**
+ * @brief Get the memory of the solved positions tables created so far
+ *
+ * @return size_t bytes
+ */
+size_t getSolverMemory();
+
+#endif
\ No newline at end of file
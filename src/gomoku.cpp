@@ -0,0 +1,991 @@
+#ifndef GOMOKU_CPP
+#define GOMOKU_CPP
+
+#include "gomoku.h"
+#include <climits>
+
+#define GOMOKU_STRIDE 16         ///< bits per row (the last one always empty)
+#define GOMOKU_BITS 256          ///< bits of a board
+#define GOMOKU_DIRECTIONS 4      ///< horizontal, vertical, the diagonals
+#define GOMOKU_LEVELS 3          ///< threats: five, four, three (pieces in a line after the move)
+#define GOMOKU_WIN 1000000       ///< search score of a won position (less the moves to the win)
+#define GOMOKU_BEAM 12           ///< moves tried at the inner search nodes
+#define GOMOKU_MAX_MOVES 256     ///< moves of a node (at most the cells)
+#define GOMOKU_VCF_DEPTH 16      ///< max fours of the threat search
+#define GOMOKU_VCF_SHARE 0.3     ///< share of the move time for the threat search
+#define GOMOKU_MOVES_AHEAD 15    ///< the time left is shared among this many moves
+#define GOMOKU_MIN_THINK 0.05    ///< least think time (seconds)
+#define GOMOKU_CLOCK_CHECK 255   ///< nodes between clock checks (mask)
+#define GOMOKU_BENCH_STONES 40   ///< stones of the kernel bench positions
+#define GOMOKU_BENCH_BOARDS 1000 ///< kernel bench positions
+
+volatile long long gomokuBenchSink; ///< keeps the benchmarked results
+
+// the board helpers take and return vectors by reference only, so no AVX argument crosses a call
+// (a vector returned by value would be reported at the end of the build, out of this push/pop)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/// a board: bit = row * GOMOKU_STRIDE + column (aligned as the AVX2 kernels expect, the base instruction set aligns to 16)
+typedef uint64_t gomoku_bits __attribute__((vector_size(32), aligned(32)));
+
+const int GOMOKU_STEPS[GOMOKU_DIRECTIONS] = {1, GOMOKU_STRIDE, GOMOKU_STRIDE + 1, GOMOKU_STRIDE - 1};
+
+/**
+ * @brief move every cell a step toward the first cell (0 < step < 64)
+ *
+ * @param result    set: the shifted board (may be x)
+ */
+__attribute__((always_inline)) inline void shiftDown(const gomoku_bits &x, int step, gomoku_bits &result)
+{
+    const gomoku_bits zero{0, 0, 0, 0};
+    gomoku_bits above = __builtin_shuffle(x, zero, (gomoku_bits){1, 2, 3, 4}); // the next word of each word
+    result = (x >> step) | (above << (64 - step));
+}
+
+/**
+ * @brief move every cell a step toward the last cell (0 < step < 64)
+ *
+ * @param result    set: the shifted board (may be x)
+ */
+__attribute__((always_inline)) inline void shiftUp(const gomoku_bits &x, int step, gomoku_bits &result)
+{
+    const gomoku_bits zero{0, 0, 0, 0};
+    gomoku_bits below = __builtin_shuffle(x, zero, (gomoku_bits){4, 0, 1, 2}); // the previous word of each word
+    result = (x << step) | (below >> (64 - step));
+}
+
+/**
+ * @brief the cells completing a five and those making a four
+ *
+ * A window of five cells along a direction starts at each cell; shifted
+ * down i steps, a board holds at each cell the i-th cell of its window.
+ * The cells found at window position j go back up j steps (Horner).
+ */
+__attribute__((always_inline)) inline void gomokuLinesBody(const gomoku_bits &mine, const gomoku_bits &empty,
+                                                           gomoku_bits &fives, gomoku_bits &fours)
+{
+    fives = fours = gomoku_bits{0, 0, 0, 0};
+    for (int step : GOMOKU_STEPS)
+    {
+        gomoku_bits m[GOMOKU_LINE], e[GOMOKU_LINE], five[GOMOKU_LINE], four[GOMOKU_LINE];
+        m[0] = mine;
+        e[0] = empty;
+        for (int i = 1; i < GOMOKU_LINE; i++)
+        {
+            shiftDown(m[i - 1], step, m[i]);
+            shiftDown(e[i - 1], step, e[i]);
+        }
+        for (int j = 0; j < GOMOKU_LINE; j++)
+        {
+            five[j] = e[j];
+            four[j] = gomoku_bits{0, 0, 0, 0};
+            for (int i = 0; i < GOMOKU_LINE; i++)
+            {
+                five[j] &= i != j ? m[i] : ~gomoku_bits{0, 0, 0, 0};
+            }
+        }
+        for (int j = 0; j < GOMOKU_LINE; j++)
+        {
+            for (int k = j + 1; k < GOMOKU_LINE; k++)
+            {
+                gomoku_bits w = e[j] & e[k];
+                for (int i = 0; i < GOMOKU_LINE; i++)
+                {
+                    w &= i != j && i != k ? m[i] : ~gomoku_bits{0, 0, 0, 0};
+                }
+                four[j] |= w;
+                four[k] |= w;
+            }
+        }
+        gomoku_bits f5 = five[GOMOKU_LINE - 1], f4 = four[GOMOKU_LINE - 1];
+        for (int j = GOMOKU_LINE - 2; j >= 0; j--)
+        {
+            shiftUp(f5, step, f5);
+            shiftUp(f4, step, f4);
+            f5 |= five[j];
+            f4 |= four[j];
+        }
+        fives |= f5;
+        fours |= f4;
+    }
+}
+
+/**
+ * @brief the cells making a five, a four or a three, by direction (for the move order)
+ *
+ */
+__attribute__((always_inline)) inline void gomokuPatternsBody(const gomoku_bits &mine, const gomoku_bits &empty,
+                                                              gomoku_bits maps[GOMOKU_DIRECTIONS][GOMOKU_LEVELS])
+{
+    for (int d = 0; d < GOMOKU_DIRECTIONS; d++)
+    {
+        int step = GOMOKU_STEPS[d];
+        gomoku_bits m[GOMOKU_LINE], e[GOMOKU_LINE], found[GOMOKU_LEVELS][GOMOKU_LINE];
+        m[0] = mine;
+        e[0] = empty;
+        for (int i = 1; i < GOMOKU_LINE; i++)
+        {
+            shiftDown(m[i - 1], step, m[i]);
+            shiftDown(e[i - 1], step, e[i]);
+        }
+        for (int l = 0; l < GOMOKU_LEVELS; l++)
+        {
+            for (int j = 0; j < GOMOKU_LINE; j++)
+            {
+                found[l][j] = gomoku_bits{0, 0, 0, 0};
+            }
+        }
+        // every subset of window positions as the pieces (2 to 4 of them), the others empty
+        for (unsigned pieces = 0; pieces < (1u << GOMOKU_LINE); pieces++)
+        {
+            int count = __builtin_popcount(pieces), level = GOMOKU_LINE - 1 - count;
+            if (level < 0 || level >= GOMOKU_LEVELS)
+            {
+                continue;
+            }
+            gomoku_bits w = ~gomoku_bits{0, 0, 0, 0};
+            for (int i = 0; i < GOMOKU_LINE; i++)
+            {
+                w &= pieces >> i & 1 ? m[i] : e[i];
+            }
+            for (int i = 0; i < GOMOKU_LINE; i++)
+            {
+                found[level][i] |= pieces >> i & 1 ? gomoku_bits{0, 0, 0, 0} : w;
+            }
+        }
+        for (int l = 0; l < GOMOKU_LEVELS; l++)
+        {
+            gomoku_bits cells = found[l][GOMOKU_LINE - 1];
+            for (int j = GOMOKU_LINE - 2; j >= 0; j--)
+            {
+                shiftUp(cells, step, cells);
+                cells |= found[l][j];
+            }
+            maps[d][l] = cells;
+        }
+    }
+}
+
+/**
+ * @brief the cells of a board
+ *
+ */
+__attribute__((always_inline)) inline int gomokuCount(const gomoku_bits &x)
+{
+    return __builtin_popcountll(x[0]) + __builtin_popcountll(x[1]) + __builtin_popcountll(x[2]) + __builtin_popcountll(x[3]);
+}
+
+/**
+ * @brief heuristic value for the player of the first board
+ *
+ * Every window of five cells free of the other player's pieces scores by
+ * the pieces in it; the count is added bit-sliced (full adders on whole
+ * boards).
+ */
+__attribute__((always_inline)) inline int gomokuEvalBody(const gomoku_bits &mine, const gomoku_bits &other,
+                                                         const gomoku_bits &empty)
+{
+    static const int WEIGHTS[GOMOKU_LINE] = {0, 1, 8, 64, 512}; // by pieces in the window
+    const gomoku_bits *players[NUM_PLAYERS] = {&mine, &other};
+    int score = 0;
+    for (int step : GOMOKU_STEPS)
+    {
+        for (int p = 0; p < NUM_PLAYERS; p++)
+        {
+            gomoku_bits m[GOMOKU_LINE], free = *players[p] | empty;
+            m[0] = *players[p];
+            gomoku_bits open = free;
+            for (int i = 1; i < GOMOKU_LINE; i++)
+            {
+                shiftDown(m[i - 1], step, m[i]);
+                shiftDown(free, step, free);
+                open &= free;
+            }
+            gomoku_bits s = m[0] ^ m[1] ^ m[2], c1 = (m[0] & m[1]) | (m[2] & (m[0] ^ m[1]));
+            gomoku_bits b0 = s ^ m[3] ^ m[4], c2 = (s & m[3]) | (m[4] & (s ^ m[3]));
+            gomoku_bits b1 = c1 ^ c2, b2 = c1 & c2;
+            int value = WEIGHTS[1] * gomokuCount(open & b0 & ~b1 & ~b2) + WEIGHTS[2] * gomokuCount(open & ~b0 & b1 & ~b2) +
+                        WEIGHTS[3] * gomokuCount(open & b0 & b1 & ~b2) + WEIGHTS[4] * gomokuCount(open & ~b0 & ~b1 & b2);
+            score += p == 0 ? value : -value;
+        }
+    }
+    return score;
+}
+
+// the kernels, for processors with AVX2 and for any processor
+
+__attribute__((target("avx2,popcnt"))) void gomokuLinesAvx2(const gomoku_bits &mine, const gomoku_bits &empty,
+                                                            gomoku_bits &fives, gomoku_bits &fours)
+{
+    gomokuLinesBody(mine, empty, fives, fours);
+}
+
+__attribute__((target("avx2,popcnt"))) void gomokuPatternsAvx2(const gomoku_bits &mine, const gomoku_bits &empty,
+                                                               gomoku_bits maps[GOMOKU_DIRECTIONS][GOMOKU_LEVELS])
+{
+    gomokuPatternsBody(mine, empty, maps);
+}
+
+__attribute__((target("avx2,popcnt"))) int gomokuEvalAvx2(const gomoku_bits &mine, const gomoku_bits &other,
+                                                          const gomoku_bits &empty)
+{
+    return gomokuEvalBody(mine, other, empty);
+}
+
+void gomokuLinesPortable(const gomoku_bits &mine, const gomoku_bits &empty, gomoku_bits &fives, gomoku_bits &fours)
+{
+    gomokuLinesBody(mine, empty, fives, fours);
+}
+
+void gomokuPatternsPortable(const gomoku_bits &mine, const gomoku_bits &empty,
+                            gomoku_bits maps[GOMOKU_DIRECTIONS][GOMOKU_LEVELS])
+{
+    gomokuPatternsBody(mine, empty, maps);
+}
+
+int gomokuEvalPortable(const gomoku_bits &mine, const gomoku_bits &other, const gomoku_bits &empty)
+{
+    return gomokuEvalBody(mine, other, empty);
+}
+
+
+/**
+ * @brief the board kernels of a processor
+ *
+ */
+struct gomoku_kernels
+{
+    const char *name;                                                                         ///< instruction set
+    void (*lines)(const gomoku_bits &, const gomoku_bits &, gomoku_bits &, gomoku_bits &);    ///< see gomokuLinesBody
+    void (*patterns)(const gomoku_bits &, const gomoku_bits &, gomoku_bits[][GOMOKU_LEVELS]); ///< see gomokuPatternsBody
+    int (*eval)(const gomoku_bits &, const gomoku_bits &, const gomoku_bits &);               ///< see gomokuEvalBody
+};
+
+const gomoku_kernels GOMOKU_AVX2{"AVX2", gomokuLinesAvx2, gomokuPatternsAvx2, gomokuEvalAvx2};
+const gomoku_kernels GOMOKU_PORTABLE{"portable", gomokuLinesPortable, gomokuPatternsPortable, gomokuEvalPortable};
+
+/**
+ * @brief the kernels for this processor
+ *
+ */
+const gomoku_kernels &getGomokuKernels()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    return avx2 ? GOMOKU_AVX2 : GOMOKU_PORTABLE;
+}
+
+/**
+ * @brief the board bit of a cell
+ *
+ */
+inline int gomokuBit(int cell)
+{
+    return cell / GOMOKU_SIZE * GOMOKU_STRIDE + cell % GOMOKU_SIZE;
+}
+
+/**
+ * @brief the cell of a board bit
+ *
+ */
+inline int gomokuCell(int bit)
+{
+    return bit / GOMOKU_STRIDE * GOMOKU_SIZE + bit % GOMOKU_STRIDE;
+}
+
+inline bool testBit(const gomoku_bits &x, int bit)
+{
+    return x[bit >> 6] >> (bit & 63) & 1;
+}
+
+inline void setBit(gomoku_bits &x, int bit)
+{
+    x[bit >> 6] |= 1ull << (bit & 63);
+}
+
+inline void clearBit(gomoku_bits &x, int bit)
+{
+    x[bit >> 6] &= ~(1ull << (bit & 63));
+}
+
+inline bool isEmptyBoard(const gomoku_bits &x)
+{
+    return (x[0] | x[1] | x[2] | x[3]) == 0;
+}
+
+/**
+ * @brief the first cell of a board (a board not empty)
+ *
+ */
+inline int firstBit(const gomoku_bits &x)
+{
+    int i = 0;
+    while (x[i] == 0)
+    {
+        i++;
+    }
+    return i * 64 + __builtin_ctzll(x[i]);
+}
+
+#pragma GCC diagnostic pop
+
+/**
+ * @brief the board tables (computed once)
+ *
+ */
+struct gomoku_tables
+{
+    gomoku_bits board;             ///< all the cells
+    gomoku_bits near[GOMOKU_BITS]; ///< the cells within two of each cell (the candidate moves)
+};
+
+/**
+ * @brief compute the tables
+ *
+ */
+void initGomokuTables(gomoku_tables &t)
+{
+    t.board = gomoku_bits{0, 0, 0, 0};
+    for (int cell = 0; cell < GOMOKU_CELLS; cell++)
+    {
+        setBit(t.board, gomokuBit(cell));
+    }
+    for (int bit = 0; bit < GOMOKU_BITS; bit++)
+    {
+        t.near[bit] = gomoku_bits{0, 0, 0, 0};
+        int row = bit / GOMOKU_STRIDE, col = bit % GOMOKU_STRIDE;
+        for (int r = max(0, row - 2); r <= min(GOMOKU_SIZE - 1, row + 2) && col < GOMOKU_SIZE; r++)
+        {
+            for (int c = max(0, col - 2); c <= min(GOMOKU_SIZE - 1, col + 2); c++)
+            {
+                setBit(t.near[bit], r * GOMOKU_STRIDE + c);
+            }
+        }
+    }
+}
+
+gomoku_tables gomokuTables;
+once_flag gomokuTablesInitialized;
+
+/**
+ * @brief Get the tables (initialized on first use)
+ *
+ */
+const gomoku_tables &getGomokuTables()
+{
+    call_once(gomokuTablesInitialized, initGomokuTables, ref(gomokuTables));
+    return gomokuTables;
+}
+
+/**
+ * @brief a position, from the player to move
+ *
+ */
+struct gomoku_board
+{
+    gomoku_bits mine, other; ///< the pieces of the player to move, of the opponent
+    gomoku_bits empty;       ///< the empty cells
+    gomoku_bits near;        ///< the empty cells within two of a piece (kept as the pieces are played)
+};
+
+/**
+ * @brief play a move (then the other player moves)
+ *
+ */
+gomoku_board playGomokuBit(const gomoku_tables &t, const gomoku_board &b, int bit)
+{
+    gomoku_board next{b.other, b.mine, b.empty, b.near | t.near[bit]};
+    setBit(next.other, bit);
+    clearBit(next.empty, bit);
+    next.near &= next.empty;
+    return next;
+}
+
+/**
+ * @brief a search in progress
+ *
+ */
+struct gomoku_search
+{
+    const gomoku_kernels &k;  ///< board kernels
+    const gomoku_tables &t;   ///< board tables
+    TimePoint deadline;       ///< stop searching
+    unsigned long long nodes; ///< positions searched
+    bool stopped;             ///< the deadline has passed
+};
+
+/**
+ * @brief count a position, check the clock now and then
+ *
+ * @return true if the search must stop
+ */
+bool gomokuVisit(gomoku_search &s)
+{
+    if ((++s.nodes & GOMOKU_CLOCK_CHECK) == 0 && theClock.now() >= s.deadline)
+    {
+        s.stopped = true;
+    }
+    return s.stopped;
+}
+
+/**
+ * @brief search a win by continuous fours (the opponent always has to block)
+ *
+ * @param depth the fours that can be played
+ * @param move  the first move of the win (set if found)
+ * @return true if won
+ */
+bool gomokuThreatSearch(gomoku_search &s, const gomoku_board &b, int depth, int &move)
+{
+    gomoku_bits fives, fours, otherFives, otherFours;
+    s.k.lines(b.mine, b.empty, fives, fours);
+    if (!isEmptyBoard(fives))
+    {
+        move = firstBit(fives);
+        return true;
+    }
+    if (depth == 0 || gomokuVisit(s))
+    {
+        return false;
+    }
+    s.k.lines(b.other, b.empty, otherFives, otherFours);
+    if (!isEmptyBoard(otherFives))
+    {
+        fours &= otherFives; // a four blocking the opponent's
+    }
+    while (!isEmptyBoard(fours))
+    {
+        int bit = firstBit(fours);
+        clearBit(fours, bit);
+        gomoku_board next = playGomokuBit(s.t, b, bit);
+        gomoku_bits threats, unused, replies;
+        s.k.lines(next.other, next.empty, threats, unused);
+        s.k.lines(next.mine, next.empty, replies, unused);
+        if (!isEmptyBoard(replies))
+        {
+            continue; // the opponent wins first
+        }
+        int block = firstBit(threats);
+        clearBit(threats, block);
+        if (!isEmptyBoard(threats))
+        {
+            move = bit; // two fives: one cannot be blocked
+            return true;
+        }
+        int unusedMove;
+        if (gomokuThreatSearch(s, playGomokuBit(s.t, next, block), depth - 1, unusedMove))
+        {
+            move = bit;
+            return true;
+        }
+        if (s.stopped)
+        {
+            break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief order the moves of a node by the lines they make or block
+ *
+ * @param candidates    the cells to consider
+ * @param limit         max moves returned
+ * @param moves         the best moves first (set)
+ * @return int the number of moves
+ */
+int gomokuOrderMoves(gomoku_search &s, const gomoku_board &b, const gomoku_bits &cells, int limit, int moves[])
+{
+    gomoku_bits candidates = cells;
+    static const int WEIGHTS[NUM_PLAYERS][GOMOKU_LEVELS] = {{10000, 100, 10}, {5000, 60, 6}}; // mine, blocking
+    gomoku_bits maps[NUM_PLAYERS][GOMOKU_DIRECTIONS][GOMOKU_LEVELS];
+    s.k.patterns(b.mine, b.empty, maps[0]);
+    s.k.patterns(b.other, b.empty, maps[1]);
+    int scores[GOMOKU_MAX_MOVES], n = 0;
+    while (!isEmptyBoard(candidates))
+    {
+        int bit = firstBit(candidates);
+        clearBit(candidates, bit);
+        int row = bit / GOMOKU_STRIDE, col = bit % GOMOKU_STRIDE;
+        int score = -abs(row - GOMOKU_SIZE / 2) - abs(col - GOMOKU_SIZE / 2); // central first on a tie
+        for (int p = 0; p < NUM_PLAYERS; p++)
+        {
+            for (int d = 0; d < GOMOKU_DIRECTIONS; d++)
+            {
+                for (int l = 0; l < GOMOKU_LEVELS; l++)
+                {
+                    score += testBit(maps[p][d][l], bit) ? WEIGHTS[p][l] : 0;
+                }
+            }
+        }
+        int j = n++;
+        for (; j > 0 && scores[j - 1] < score; j--)
+        {
+            scores[j] = scores[j - 1];
+            moves[j] = moves[j - 1];
+        }
+        scores[j] = score;
+        moves[j] = bit;
+    }
+    return min(n, limit);
+}
+
+/**
+ * @brief alpha-beta search (fail-soft negamax), a forced block does not count as a move
+ *
+ * @param ply   moves from the root
+ * @return int the score for the player to move (0 if stopped)
+ */
+int gomokuSearch(gomoku_search &s, const gomoku_board &b, int depth, int ply, int alpha, int beta)
+{
+    if (gomokuVisit(s))
+    {
+        return 0;
+    }
+    gomoku_bits fives, fours, otherFives, otherFours;
+    s.k.lines(b.mine, b.empty, fives, fours);
+    if (!isEmptyBoard(fives))
+    {
+        return GOMOKU_WIN - ply;
+    }
+    s.k.lines(b.other, b.empty, otherFives, otherFours);
+    gomoku_bits candidates = b.near;
+    int limit = GOMOKU_BEAM;
+    if (!isEmptyBoard(otherFives))
+    {
+        int block = firstBit(otherFives);
+        clearBit(otherFives, block);
+        if (!isEmptyBoard(otherFives))
+        {
+            return -(GOMOKU_WIN - ply - 1); // two fives: one cannot be blocked
+        }
+        candidates = gomoku_bits{0, 0, 0, 0};
+        setBit(candidates, block);
+        depth++; // forced
+    }
+    if (depth <= 0)
+    {
+        return s.k.eval(b.mine, b.other, b.empty);
+    }
+    if (isEmptyBoard(candidates))
+    {
+        return 0; // the board is full
+    }
+    int moves[GOMOKU_MAX_MOVES];
+    int n = gomokuOrderMoves(s, b, candidates, limit, moves), best = INT_MIN;
+    for (int i = 0; i < n; i++)
+    {
+        int score = -gomokuSearch(s, playGomokuBit(s.t, b, moves[i]), depth - 1, ply + 1, -beta, -max(alpha, best));
+        if (s.stopped)
+        {
+            return 0;
+        }
+        best = max(best, score);
+        if (best >= beta)
+        {
+            break;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief game representation
+ *
+ */
+struct gomoku
+{
+    gomoku_board board;                    ///< the position (from the player to move)
+    player turn{0};                        ///< player to move
+    player winner{PLAYER_NONE};            ///< winner
+    status state{RUNNING};                 ///< game status
+    int moves{0};                          ///< pieces played
+    int last{-1};                          ///< the last move (-1 if none)
+    bool line[GOMOKU_CELLS]{};             ///< the winning line (if any)
+    double timeAllowed{TIME_ALLOWED};      ///< time of each player for the game
+    Duration elapsed[NUM_PLAYERS]{0s, 0s}; ///< time used by each player
+    TimePoint startTime{theClock.now()};   ///< start of the turn
+};
+
+/**
+ * @brief Get a new game (the first player at random)
+ *
+ * @param timeAllowed   the time of each player for the whole game (seconds)
+ */
+gomoku newGomoku(double timeAllowed)
+{
+    const gomoku_tables &t = getGomokuTables();
+    gomoku g;
+    g.board = {gomoku_bits{0, 0, 0, 0}, gomoku_bits{0, 0, 0, 0}, t.board, gomoku_bits{0, 0, 0, 0}};
+    g.turn = rand() % NUM_PLAYERS;
+    g.timeAllowed = timeAllowed;
+    return g;
+}
+
+/**
+ * @brief Get the status of the game
+ *
+ */
+status getGomokuStatus(const gomoku &g)
+{
+    return g.state;
+}
+
+/**
+ * @brief Get the player to move (PLAYER_NONE if the game is over)
+ *
+ */
+player getGomokuTurn(const gomoku &g)
+{
+    return g.state == RUNNING ? g.turn : PLAYER_NONE;
+}
+
+/**
+ * @brief Get the winner (PLAYER_NONE if none)
+ *
+ */
+player getGomokuWinner(const gomoku &g)
+{
+    return g.winner;
+}
+
+/**
+ * @brief Get the player of a cell (PLAYER_NONE if empty)
+ *
+ */
+player getGomokuCell(const gomoku &g, int cell)
+{
+    if (0 <= cell && cell < GOMOKU_CELLS)
+    {
+        // the board is kept from the player to move
+        if (testBit(g.board.mine, gomokuBit(cell)))
+        {
+            return g.turn;
+        }
+        if (testBit(g.board.other, gomokuBit(cell)))
+        {
+            return 1 - g.turn;
+        }
+    }
+    return PLAYER_NONE;
+}
+
+/**
+ * @brief Check whether a cell belongs to the winning line
+ *
+ */
+bool isGomokuWinningCell(const gomoku &g, int cell)
+{
+    return 0 <= cell && cell < GOMOKU_CELLS && g.line[cell];
+}
+
+/**
+ * @brief Check if a move is allowed
+ *
+ */
+bool isAllowedGomokuMove(const gomoku &g, int cell)
+{
+    return g.state == RUNNING && 0 <= cell && cell < GOMOKU_CELLS && testBit(g.board.empty, gomokuBit(cell));
+}
+
+/**
+ * @brief Charge the time elapsed to the player to move (who may lose on time)
+ *
+ */
+void updateGomokuClock(gomoku &g)
+{
+    if (g.state == RUNNING)
+    {
+        TimePoint now = theClock.now();
+        g.elapsed[g.turn] += now - g.startTime;
+        g.startTime = now;
+        if (g.elapsed[g.turn].count() >= g.timeAllowed)
+        {
+            g.elapsed[g.turn] = Duration(g.timeAllowed);
+            g.state = TIMEOUT;
+            g.winner = 1 - g.turn;
+        }
+    }
+}
+
+/**
+ * @brief Get the time left to a player (seconds)
+ *
+ */
+double getGomokuTimeLeft(const gomoku &g, player p)
+{
+    return p < NUM_PLAYERS ? g.timeAllowed - g.elapsed[p].count() : 0;
+}
+
+/**
+ * @brief Get the think time of the player to move (a share of the time left)
+ *
+ */
+double getGomokuThinkTime(const gomoku &g)
+{
+    double left = getGomokuTimeLeft(g, g.turn) - Duration(theClock.now() - g.startTime).count();
+    return max(GOMOKU_MIN_THINK, left / GOMOKU_MOVES_AHEAD);
+}
+
+/**
+ * @brief Make a move of the player to move (charging the player's clock)
+ *
+ * @return true if the move was allowed (in time)
+ */
+bool makeGomokuMove(gomoku &g, int cell)
+{
+    updateGomokuClock(g);
+    if (!isAllowedGomokuMove(g, cell))
+    {
+        return false;
+    }
+    g.board = playGomokuBit(getGomokuTables(), g.board, gomokuBit(cell));
+    g.turn = 1 - g.turn;
+    g.moves++;
+    g.last = cell;
+    // the lines through the move (its player is the one not to move now)
+    static const int DIRECTIONS[GOMOKU_DIRECTIONS][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    player p = 1 - g.turn;
+    int row = cell / GOMOKU_SIZE, col = cell % GOMOKU_SIZE;
+    for (const auto &d : DIRECTIONS)
+    {
+        int first = 0, last = 0;
+        auto owned = [&](int k) {
+            int r = row + k * d[0], c = col + k * d[1];
+            return 0 <= r && r < GOMOKU_SIZE && 0 <= c && c < GOMOKU_SIZE && getGomokuCell(g, r * GOMOKU_SIZE + c) == p;
+        };
+        while (owned(first - 1))
+        {
+            first--;
+        }
+        while (owned(last + 1))
+        {
+            last++;
+        }
+        for (int k = first; last - first + 1 >= GOMOKU_LINE && k <= last; k++)
+        {
+            g.line[(row + k * d[0]) * GOMOKU_SIZE + col + k * d[1]] = true;
+            g.winner = p;
+            g.state = ENDED;
+        }
+    }
+    if (g.state == RUNNING && g.moves == GOMOKU_CELLS)
+    {
+        g.state = ENDED;
+    }
+    return true;
+}
+
+/**
+ * @brief Choose a move for the player to move (the game not over)
+ *
+ * A five is played, a five of the opponent blocked; then a win by
+ * continuous fours is searched for a share of the time, then iterative
+ * deepening alpha-beta on the cells near the pieces, the best move of each
+ * depth searched first by the next one.
+ *
+ * @param seconds   the time available
+ * @param info      what the search found (set)
+ * @return int the cell
+ */
+int getGomokuMove(const gomoku &g, double seconds, gomoku_search_info &info)
+{
+    TimePoint start = theClock.now();
+    gomoku_search s{getGomokuKernels(), getGomokuTables(), start + chrono::duration_cast<Clock::duration>(Duration(seconds * GOMOKU_VCF_SHARE)), 0, false};
+    const gomoku_board &b = g.board;
+    info = {0, 0, false, 0, 0};
+    if (g.moves == 0)
+    {
+        info.seconds = Duration(theClock.now() - start).count();
+        return GOMOKU_CELLS / 2; // the centre
+    }
+    gomoku_bits fives, fours, otherFives, otherFours;
+    s.k.lines(b.mine, b.empty, fives, fours);
+    s.k.lines(b.other, b.empty, otherFives, otherFours);
+    int move = -1;
+    if (!isEmptyBoard(fives))
+    {
+        move = firstBit(fives);
+        info.score = GOMOKU_WIN;
+    }
+    else if (!isEmptyBoard(otherFives))
+    {
+        move = firstBit(otherFives); // forced
+    }
+    else
+    {
+        for (int depth = 1; depth <= GOMOKU_VCF_DEPTH && move < 0 && !s.stopped; depth++)
+        {
+            if (gomokuThreatSearch(s, b, depth, move))
+            {
+                info.vcf = true;
+                info.score = GOMOKU_WIN;
+            }
+        }
+    }
+    if (move < 0)
+    {
+        s.deadline = start + chrono::duration_cast<Clock::duration>(Duration(seconds));
+        s.stopped = false;
+        int moves[GOMOKU_MAX_MOVES];
+        int n = gomokuOrderMoves(s, b, b.near, GOMOKU_MAX_MOVES, moves);
+        move = moves[0];
+        for (int depth = 1; !s.stopped && depth < GOMOKU_CELLS - g.moves; depth++)
+        {
+            int best = -1, alpha = -GOMOKU_WIN - 1;
+            for (int i = 0; i < n; i++)
+            {
+                int score = -gomokuSearch(s, playGomokuBit(s.t, b, moves[i]), depth - 1, 1, -GOMOKU_WIN - 1, -alpha);
+                if (s.stopped)
+                {
+                    break;
+                }
+                if (score > alpha)
+                {
+                    alpha = score;
+                    best = i;
+                }
+            }
+            if (best >= 0)
+            {
+                // the best move first next time (a depth interrupted counts for the moves searched)
+                rotate(moves, moves + best, moves + best + 1);
+                move = moves[0];
+                info.score = alpha;
+                info.depth = s.stopped ? depth - 1 : depth;
+            }
+            if (alpha >= GOMOKU_WIN - depth || alpha <= -GOMOKU_WIN + depth)
+            {
+                break; // solved
+            }
+        }
+    }
+    info.nodes = s.nodes;
+    info.seconds = Duration(theClock.now() - start).count();
+    return gomokuCell(move);
+}
+
+/**
+ * @brief Compare the board kernels (AVX2 and portable), then play some games
+ *
+ * @param games     computer vs computer games
+ * @param seconds   per move
+ * @return int the exit code
+ */
+int runGomokuBench(ostream &out, int games, double seconds)
+{
+    const gomoku_tables &t = getGomokuTables();
+    mt19937 rng(1);
+    vector<gomoku_board> boards;
+    for (int i = 0; i < GOMOKU_BENCH_BOARDS; i++)
+    {
+        gomoku_board b{gomoku_bits{0, 0, 0, 0}, gomoku_bits{0, 0, 0, 0}, t.board, gomoku_bits{0, 0, 0, 0}};
+        for (int s = 0; s < GOMOKU_BENCH_STONES; s++)
+        {
+            int bit;
+            do
+            {
+                bit = gomokuBit(rng() % GOMOKU_CELLS);
+            } while (!testBit(b.empty, bit));
+            b = playGomokuBit(t, b, bit);
+        }
+        boards.push_back(b);
+    }
+    bool avx2 = &getGomokuKernels() == &GOMOKU_AVX2;
+    out << "Gomoku " << GOMOKU_SIZE << "x" << GOMOKU_SIZE << ", AVX2 " << (avx2 ? "available" : "not available") << "\n";
+    out << "Board kernels (million boards/s, " << GOMOKU_BENCH_STONES << " pieces):\n";
+    out << setw(10) << "kernels" << setw(10) << "lines" << setw(10) << "patterns" << setw(10) << "eval" << setw(10) << "errors" << "\n";
+    const gomoku_kernels *kernels[] = {&GOMOKU_PORTABLE, &GOMOKU_AVX2};
+    for (const gomoku_kernels *k : kernels)
+    {
+        if (k == &GOMOKU_AVX2 && !avx2)
+        {
+            continue;
+        }
+        double rates[3];
+        long long checksum = 0, errors = 0;
+        for (int kernel = 0; kernel < 3; kernel++)
+        {
+            TimePoint start = theClock.now();
+            int rounds = 0;
+            for (; rounds == 0 || Duration(theClock.now() - start).count() < 0.3; rounds++)
+            {
+                for (const gomoku_board &b : boards)
+                {
+                    gomoku_bits fives, fours, maps[GOMOKU_DIRECTIONS][GOMOKU_LEVELS];
+                    switch (kernel)
+                    {
+                    case 0:
+                        k->lines(b.mine, b.empty, fives, fours);
+                        checksum += gomokuCount(fives) + gomokuCount(fours);
+                        break;
+                    case 1:
+                        k->patterns(b.mine, b.empty, maps);
+                        checksum += gomokuCount(maps[0][2]);
+                        break;
+                    default:
+                        checksum += k->eval(b.mine, b.other, b.empty);
+                    }
+                }
+            }
+            gomokuBenchSink = checksum;
+            rates[kernel] = rounds * boards.size() / Duration(theClock.now() - start).count() / 1e6;
+        }
+        // the same results as the portable kernels
+        for (const gomoku_board &b : boards)
+        {
+            gomoku_bits f1, f2, g1, g2, m1[GOMOKU_DIRECTIONS][GOMOKU_LEVELS], m2[GOMOKU_DIRECTIONS][GOMOKU_LEVELS];
+            k->lines(b.mine, b.empty, f1, g1);
+            GOMOKU_PORTABLE.lines(b.mine, b.empty, f2, g2);
+            k->patterns(b.mine, b.empty, m1);
+            GOMOKU_PORTABLE.patterns(b.mine, b.empty, m2);
+            bool same = isEmptyBoard((f1 ^ f2) | (g1 ^ g2)) && k->eval(b.mine, b.other, b.empty) == GOMOKU_PORTABLE.eval(b.mine, b.other, b.empty);
+            for (int d = 0; d < GOMOKU_DIRECTIONS; d++)
+            {
+                for (int l = 0; l < GOMOKU_LEVELS; l++)
+                {
+                    same = same && isEmptyBoard(m1[d][l] ^ m2[d][l]);
+                }
+            }
+            errors += !same;
+        }
+        out << setw(10) << k->name << fixed << setprecision(2) << setw(10) << rates[0] << setw(10) << rates[1] << setw(10)
+            << rates[2] << defaultfloat << setw(10) << errors << "\n";
+    }
+    out.flush();
+    // computer vs computer
+    unsigned long long nodes = 0, moves = 0, depths = 0, searched = 0, vcfs = 0;
+    int firstWins = 0, secondWins = 0;
+    double time = 0;
+    for (int i = 0; i < games; i++)
+    {
+        gomoku g = newGomoku(TIME_ALLOWED);
+        player first = g.turn;
+        while (g.state == RUNNING)
+        {
+            gomoku_search_info info;
+            makeGomokuMove(g, getGomokuMove(g, seconds, info));
+            g.elapsed[0] = g.elapsed[1] = Duration(0); // no clock: a fixed time per move
+            nodes += info.nodes;
+            time += info.seconds;
+            vcfs += info.vcf;
+            depths += info.depth;
+            searched += info.depth > 0;
+            moves++;
+        }
+        firstWins += g.winner == first;
+        secondWins += g.winner == 1 - first;
+        out << "Game " << i + 1 << ": "
+            << (g.winner == PLAYER_NONE ? "draw" : g.winner == first ? "first player wins" : "second player wins") << " in "
+            << g.moves << " moves\n";
+        out.flush();
+    }
+    out << games << " games, " << seconds << " s per move: first player wins " << firstWins << ", second player wins "
+        << secondWins << ", draws " << games - firstWins - secondWins << "\n";
+    out << moves << " moves, " << nodes << " positions in " << fixed << setprecision(1) << time << " s ("
+        << (time > 0 ? nodes / time / 1e6 : 0) << " M/s), wins by continuous fours found " << vcfs
+        << ", mean depth of the searched moves " << (searched > 0 ? double(depths) / searched : 0) << defaultfloat << "\n";
+    return 0;
+}
+
+#endif
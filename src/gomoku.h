@@ -0,0 +1,127 @@
+#ifndef GOMOKU_H
+#define GOMOKU_H
+
+// The 15x15 board (five in a row) =============================================
+/**
+ * Gomoku: scacchiera 15x15, vince chi allinea cinque pedine. Le celle di
+ * un giocatore stanno in 256 bit (righe di 16 bit, l'ultimo sempre vuoto
+ * così gli allineamenti non passano da una riga alla successiva) trattati
+ * come un vettore AVX2: minacce e valutazione si calcolano su tutta la
+ * scacchiera con scorrimenti e AND nelle quattro direzioni. Senza AVX2 lo
+ * stesso codice gira con le istruzioni di base.
+ * Il computer cerca prima una vittoria con quattro continui (VCF:
+ * l'avversario deve sempre bloccare), poi una ricerca alfa-beta ad
+ * approfondimento iterativo sulle celle vicine alle pedine, entro il tempo
+ * della partita.
+ */
+
+#define GOMOKU_SIZE 15   ///< cells per side
+#define GOMOKU_CELLS 225 ///< cell = row * GOMOKU_SIZE + column
+#define GOMOKU_LINE 5    ///< pieces in a row to win
+
+/**
+ * @brief the game (to be defined in gomoku.cpp)
+ *
+ */
+struct gomoku;
+
+/**
+ * @brief what a search found
+ *
+ */
+struct gomoku_search_info
+{
+    int depth;                ///< full depth searched (moves, 0 if the move was forced)
+    int score;                ///< for the player to move
+    bool vcf;                 ///< a win by continuous fours was found
+    unsigned long long nodes; ///< positions searched (threat search included)
+    double seconds;           ///< time spent
+};
+
+/**
+ * @brief Get a new game (the first player at random)
+ *
+ * @param timeAllowed   the time of each player for the whole game (seconds)
+ */
+gomoku newGomoku(double timeAllowed);
+
+/**
+ * @brief Get the status of the game
+ *
+ */
+status getGomokuStatus(const gomoku &);
+
+/**
+ * @brief Get the player to move (PLAYER_NONE if the game is over)
+ *
+ */
+player getGomokuTurn(const gomoku &);
+
+/**
+ * @brief Get the winner (PLAYER_NONE if none)
+ *
+ */
+player getGomokuWinner(const gomoku &);
+
+/**
+ * @brief Get the player of a cell (PLAYER_NONE if empty)
+ *
+ */
+player getGomokuCell(const gomoku &, int cell);
+
+/**
+ * @brief Check whether a cell belongs to the winning line
+ *
+ */
+bool isGomokuWinningCell(const gomoku &, int cell);
+
+/**
+ * @brief Check if a move is allowed
+ *
+ */
+bool isAllowedGomokuMove(const gomoku &, int cell);
+
+/**
+ * @brief Make a move of the player to move (charging the player's clock)
+ *
+ * @return true if the move was allowed (in time)
+ */
+bool makeGomokuMove(gomoku &, int cell);
+
+/**
+ * @brief Charge the time elapsed to the player to move (who may lose on time)
+ *
+ */
+void updateGomokuClock(gomoku &);
+
+/**
+ * @brief Get the time left to a player (seconds)
+ *
+ */
+double getGomokuTimeLeft(const gomoku &, player);
+
+/**
+ * @brief Get the think time of the player to move (a share of the time left)
+ *
+ */
+double getGomokuThinkTime(const gomoku &);
+
+/**
+ * @brief Choose a move for the player to move (the game not over)
+ *
+ * @param seconds   the time available
+ * @param info      what the search found (set)
+ * @return int the cell
+ */
+int getGomokuMove(const gomoku &, double seconds, gomoku_search_info &info);
+
+/**
+ * @brief Compare the board kernels (AVX2 and portable), then play some games
+ *
+ * @param games     computer vs computer games
+ * @param seconds   per move
+ * @return int the exit code
+ */
+int runGomokuBench(std::ostream &, int games, double seconds);
+
+#endif
@@ -0,0 +1,613 @@
+#ifndef GRAVITY_CPP
+#define GRAVITY_CPP
+
+#include "gravity.h"
+#include <random>
+
+#define GRAVITY_MAX_BITS 56          ///< max bits of a position
+#define GRAVITY_SCORE_OFFSET 64      ///< stored values: score + offset,
+#define GRAVITY_LOWER (1u << 7)      ///< flag of lower bounds (else upper bounds)
+#define GRAVITY_BENCH_WIDTH 7        ///< benchmark board: Connect Four
+#define GRAVITY_BENCH_HEIGHT 6
+#define GRAVITY_BENCH_CONNECT 4
+
+/**
+ * @brief Get a board geometry (at most 56 bits: width * (height + 1))
+ *
+ */
+gravity_rules makeGravityRules(int width, int height, int connect)
+{
+    gravity_rules g;
+    g.width = width;
+    g.height = height;
+    g.connect = connect;
+    g.bottom = 0;
+    g.board = 0;
+    for (int c = 0; c < width; c++)
+    {
+        g.bottom |= 1ull << (c * (height + 1));
+        g.board |= ((1ull << height) - 1) << (c * (height + 1));
+        g.order[c] = width / 2 + (1 - 2 * (c % 2)) * (c + 1) / 2;
+    }
+    return g;
+}
+
+/**
+ * @brief the cells of a column
+ *
+ */
+inline uint64_t gravityColumn(const gravity_rules &g, int col)
+{
+    return ((1ull << g.height) - 1) << (col * (g.height + 1));
+}
+
+/**
+ * @brief the lowest empty cell of each column (not full)
+ *
+ */
+inline uint64_t gravityDrops(const gravity_rules &g, uint64_t mask)
+{
+    return (mask + g.bottom) & g.board;
+}
+
+/**
+ * @brief play a move
+ *
+ * @param move  the cell (a drop cell)
+ */
+inline void playGravity(gravity_position &p, uint64_t move)
+{
+    p.current ^= p.mask; // the other player moves next
+    p.mask |= move;
+    p.moves++;
+}
+
+/**
+ * @brief shift toward the low bits (negative amounts toward the high bits)
+ *
+ */
+inline uint64_t shiftCells(uint64_t cells, int amount)
+{
+    return amount >= 0 ? cells >> amount : cells << -amount;
+}
+
+/**
+ * @brief the empty cells completing a line of some pieces
+ *
+ * The cells missing from each line are found one position of the line at a
+ * time: the other positions, shifted over it, must all hold a piece. The
+ * spare bit on top of each column stops the lines at the board border.
+ *
+ * @param pieces    the pieces of a player
+ * @param mask      the occupied cells
+ */
+uint64_t gravityWinningCells(const gravity_rules &g, uint64_t pieces, uint64_t mask)
+{
+    const int steps[] = {1, g.height + 1, g.height, g.height + 2}; // vertical, horizontal, the diagonals
+    uint64_t result = 0;
+    for (int step : steps)
+    {
+        for (int missing = 0; missing < g.connect; missing++)
+        {
+            uint64_t cells = ~0ull;
+            for (int i = 0; i < g.connect && cells != 0; i++)
+            {
+                if (i != missing)
+                {
+                    cells &= shiftCells(pieces, (i - missing) * step);
+                }
+            }
+            result |= cells;
+        }
+    }
+    return result & g.board & ~mask;
+}
+
+/**
+ * @brief check whether some pieces make a line
+ *
+ */
+bool gravityAligned(const gravity_rules &g, uint64_t pieces)
+{
+    const int steps[] = {1, g.height + 1, g.height, g.height + 2};
+    for (int step : steps)
+    {
+        uint64_t cells = pieces;
+        for (int i = 1; i < g.connect && cells != 0; i++)
+        {
+            cells &= pieces >> (i * step);
+        }
+        if (cells != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Play a sequence of columns ("1" = leftmost, such as "4453")
+ *
+ * @param p the position (played on)
+ * @return const char* the error, nullptr if played
+ */
+const char *playGravityColumns(const gravity_rules &g, gravity_position &p, const char columns[])
+{
+    for (const char *c = columns; *c != '\0'; c++)
+    {
+        int col = *c - '1';
+        if (col < 0 || col >= g.width)
+        {
+            return "invalid column";
+        }
+        uint64_t move = gravityDrops(g, p.mask) & gravityColumn(g, col);
+        if (move == 0)
+        {
+            return "full column";
+        }
+        if (gravityAligned(g, (p.current | move)))
+        {
+            return "the game is over";
+        }
+        playGravity(p, move);
+    }
+    return nullptr;
+}
+
+/**
+ * @brief the searched positions table (created on first use, as large as the solver one)
+ *
+ */
+transposition_table *gravityTable = nullptr;
+once_flag gravityTableCreated;
+transposition_table &getGravityTable()
+{
+    call_once(gravityTableCreated, [] { gravityTable = newTable(solverMegabytes << 20, solverHugePages); });
+    return *gravityTable;
+}
+
+/**
+ * @brief a search in progress
+ *
+ */
+struct gravity_search
+{
+    const gravity_rules &g;     ///< the geometry
+    transposition_table &table; ///< searched positions (bounds)
+    uint64_t geometry;          ///< mixed into the keys
+    unsigned long long nodes;   ///< positions searched
+};
+
+/**
+ * @brief the key of a position, the same for its mirror image
+ *
+ * @param symmetric set to whether the position is its own mirror image
+ */
+uint64_t gravityKey(const gravity_search &s, const gravity_position &p, bool &symmetric)
+{
+    const gravity_rules &g = s.g;
+    uint64_t key = p.current + p.mask, mirrored = 0; // unique: a column holds its pieces plus one
+    uint64_t column = (1ull << (g.height + 1)) - 1;
+    for (int c = 0; c < g.width; c++)
+    {
+        mirrored |= (key >> (c * (g.height + 1)) & column) << ((g.width - 1 - c) * (g.height + 1));
+    }
+    symmetric = key == mirrored;
+    return positionKey(min(key, mirrored) ^ s.geometry);
+}
+
+/**
+ * @brief null window search (Pascal Pons' Connect Four solver)
+ *
+ * The player to move cannot win at once (checked by the caller), and
+ * the moves letting the opponent win at once are never tried.
+ *
+ * @return int the score, or a bound of it outside (alpha, beta)
+ */
+int gravityNegamax(gravity_search &s, const gravity_position &p, int alpha, int beta)
+{
+    const gravity_rules &g = s.g;
+    int cells = g.width * g.height;
+    s.nodes++;
+    uint64_t drops = gravityDrops(g, p.mask), opponentWins = gravityWinningCells(g, p.current ^ p.mask, p.mask);
+    uint64_t candidates = drops, forced = drops & opponentWins;
+    if (forced != 0)
+    {
+        if ((forced & (forced - 1)) != 0)
+        {
+            return -(cells - p.moves) / 2; // two threats: lost next move
+        }
+        candidates = forced;
+    }
+    candidates &= ~(opponentWins >> 1); // not below a winning cell of the opponent
+    if (candidates == 0)
+    {
+        return -(cells - p.moves) / 2;
+    }
+    if (p.moves >= cells - 2)
+    {
+        return 0;
+    }
+    int low = -(cells - 2 - p.moves) / 2, high = (cells - 1 - p.moves) / 2; // nobody wins next move
+    bool symmetric;
+    uint64_t key = gravityKey(s, p, symmetric);
+    unsigned value;
+    if (probeTable(s.table, key, value))
+    {
+        int bound = int(value & ~GRAVITY_LOWER) - GRAVITY_SCORE_OFFSET;
+        (value & GRAVITY_LOWER ? low : high) = bound;
+    }
+    alpha = max(alpha, low);
+    beta = min(beta, high);
+    if (alpha >= beta)
+    {
+        return alpha;
+    }
+    // the moves making more threats first, the central columns first on a tie
+    uint64_t moves[GRAVITY_MAX_WIDTH];
+    int threats[GRAVITY_MAX_WIDTH], n = 0;
+    for (int i = 0; i < g.width; i++)
+    {
+        int col = g.order[i];
+        uint64_t move = candidates & gravityColumn(g, col);
+        if (move == 0 || (symmetric && col > g.width - 1 - col))
+        {
+            continue; // mirror moves are equivalent
+        }
+        int count = __builtin_popcountll(gravityWinningCells(g, p.current | move, p.mask | move));
+        int j = n++;
+        for (; j > 0 && threats[j - 1] < count; j--)
+        {
+            moves[j] = moves[j - 1];
+            threats[j] = threats[j - 1];
+        }
+        moves[j] = move;
+        threats[j] = count;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        gravity_position next = p;
+        playGravity(next, moves[i]);
+        int score = -gravityNegamax(s, next, -beta, -alpha);
+        if (score >= beta)
+        {
+            storeTable(s.table, key, (score + GRAVITY_SCORE_OFFSET) | GRAVITY_LOWER, cells - p.moves);
+            return score;
+        }
+        alpha = max(alpha, score);
+    }
+    storeTable(s.table, key, alpha + GRAVITY_SCORE_OFFSET, cells - p.moves);
+    return alpha;
+}
+
+/**
+ * @brief Solve a position (the game not over)
+ *
+ * A win with the last piece scores 1, every piece left to the winner one
+ * more; a draw scores 0.
+ *
+ * @param nodes positions searched (added)
+ * @return int the score for the player to move
+ */
+int solveGravity(const gravity_rules &g, const gravity_position &p, unsigned long long &nodes)
+{
+    int cells = g.width * g.height;
+    if (gravityDrops(g, p.mask) & gravityWinningCells(g, p.current, p.mask))
+    {
+        return (cells + 1 - p.moves) / 2;
+    }
+    if (p.moves >= cells)
+    {
+        return 0;
+    }
+    gravity_search s{g, getGravityTable(), positionKey(uint64_t(g.width) << 16 | g.height << 8 | g.connect), 0};
+    // narrow the score window with null window searches, probing near 0 first
+    int low = -(cells - p.moves) / 2, high = (cells + 1 - p.moves) / 2;
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (middle <= 0 && low / 2 < middle)
+        {
+            middle = low / 2;
+        }
+        else if (middle >= 0 && high / 2 > middle)
+        {
+            middle = high / 2;
+        }
+        int score = gravityNegamax(s, p, middle, middle + 1);
+        if (score <= middle)
+        {
+            high = score;
+        }
+        else
+        {
+            low = score;
+        }
+    }
+    nodes += s.nodes;
+    return low;
+}
+
+/**
+ * @brief the score of each move
+ *
+ * @param scores    by column, for the player making the move (set for the columns not full)
+ * @return uint64_t the drop cell of each column not full
+ */
+uint64_t gravityMoveScores(const gravity_rules &g, const gravity_position &p, int scores[], unsigned long long &nodes)
+{
+    int cells = g.width * g.height;
+    uint64_t drops = gravityDrops(g, p.mask);
+    for (int col = 0; col < g.width; col++)
+    {
+        uint64_t move = drops & gravityColumn(g, col);
+        if (move != 0)
+        {
+            gravity_position next = p;
+            playGravity(next, move);
+            scores[col] = gravityAligned(g, p.current | move) ? (cells + 1 - p.moves) / 2
+                          : next.moves == cells                ? 0
+                                                               : -solveGravity(g, next, nodes);
+        }
+    }
+    return drops;
+}
+
+/**
+ * @brief the value of a move from its score
+ *
+ * The winner's last move is made on a board of n pieces, with
+ * score = (cells + 1 - n) / 2: n is the one with the winner's parity.
+ *
+ * @param moves pieces played before the move
+ */
+move_value gravityMoveValue(const gravity_rules &g, int score, int moves)
+{
+    int cells = g.width * g.height;
+    if (score == 0)
+    {
+        return {DRAW, cells - moves};
+    }
+    int n = cells + 1 - 2 * abs(score);
+    if (n % 2 != (score > 0 ? moves : moves + 1) % 2)
+    {
+        n--;
+    }
+    return {score > 0 ? WINNING : LOSING, n + 1 - moves};
+}
+
+/**
+ * @brief the solver position of a game (the player to move is current)
+ *
+ * Cell (row, column) of the board, row 0 at the top, is bit
+ * column * (dim + 1) + dim - 1 - row.
+ */
+gravity_position gravityPosition(const game &g)
+{
+    gravity_position p{0, 0, getMoveNumber(g)};
+    for (square c = getMinCell(g); c <= getMaxCell(g); c++)
+    {
+        int i = c - getMinCell(g);
+        uint64_t bit = 1ull << (i % g.DIM * (g.DIM + 1) + g.DIM - 1 - i / g.DIM);
+        player o = getCellPlayer(g, c);
+        p.mask |= o != PLAYER_NONE ? bit : 0;
+        p.current |= o == getTurn(g) ? bit : 0;
+    }
+    return p;
+}
+
+/**
+ * @brief the game cell of a solver cell
+ *
+ */
+square gravityCell(const game &g, uint64_t bit)
+{
+    int b = __builtin_ctzll(bit), col = b / (g.DIM + 1), row = g.DIM - 1 - b % (g.DIM + 1);
+    return getMinCell(g) + row * g.DIM + col;
+}
+
+/**
+ * @brief Get the solver move of a gravity game
+ *
+ * @return square the cell
+ */
+square gravityMove(const game &g)
+{
+    gravity_rules gr = makeGravityRules(g.DIM, g.DIM, g.DIM);
+    gravity_position p = gravityPosition(g);
+    int scores[GRAVITY_MAX_WIDTH];
+    unsigned long long nodes = 0;
+    uint64_t drops = gravityMoveScores(gr, p, scores, nodes), best = 0;
+    int bestScore = 0;
+    for (int i = 0; i < gr.width; i++)
+    {
+        int col = gr.order[i];
+        uint64_t move = drops & gravityColumn(gr, col);
+        if (move != 0 && (best == 0 || scores[col] > bestScore))
+        {
+            best = move;
+            bestScore = scores[col];
+        }
+    }
+    return gravityCell(g, best);
+}
+
+/**
+ * @brief Analyze every move of a gravity game
+ *
+ * @param values    by cell, set for the cells reached by a move only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeGravityMoves(const game &g, move_value values[])
+{
+    if (getStatus(g) != RUNNING)
+    {
+        return 0;
+    }
+    gravity_rules gr = makeGravityRules(g.DIM, g.DIM, g.DIM);
+    gravity_position p = gravityPosition(g);
+    int scores[GRAVITY_MAX_WIDTH], count = 0;
+    unsigned long long nodes = 0;
+    uint64_t drops = gravityMoveScores(gr, p, scores, nodes);
+    for (int col = 0; col < gr.width; col++)
+    {
+        uint64_t move = drops & gravityColumn(gr, col);
+        if (move != 0)
+        {
+            values[gravityCell(g, move) - getMinCell(g)] = gravityMoveValue(gr, scores[col], p.moves);
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Solve a position given as columns and print its value and best moves
+ *
+ * @return int the exit code
+ */
+int printGravitySolution(ostream &out, int width, int height, int connect, const char columns[])
+{
+    if (width < 1 || width > GRAVITY_MAX_WIDTH || height < 1 || width * (height + 1) > GRAVITY_MAX_BITS || connect < 2)
+    {
+        out << "Invalid board: " << width << "x" << height << ", " << connect << " in a row\n";
+        return 1;
+    }
+    gravity_rules g = makeGravityRules(width, height, connect);
+    gravity_position p{0, 0, 0};
+    const char *error = playGravityColumns(g, p, columns);
+    if (error != nullptr)
+    {
+        out << "Position " << columns << ": " << error << "\n";
+        return 1;
+    }
+    if (p.moves == width * height)
+    {
+        out << "Position " << columns << ": draw (the board is full)\n";
+        return 0;
+    }
+    TimePoint start = theClock.now();
+    unsigned long long nodes = 0;
+    int scores[GRAVITY_MAX_WIDTH];
+    uint64_t drops = gravityMoveScores(g, p, scores, nodes);
+    int best = INT_MIN;
+    for (int col = 0; col < width; col++)
+    {
+        best = drops & gravityColumn(g, col) ? max(best, scores[col]) : best;
+    }
+    double seconds = Duration(theClock.now() - start).count();
+    static const char *OUTCOMES[] = {"win", "loss", "draw"}; // by enum outcome
+    move_value v = gravityMoveValue(g, best, p.moves);
+    out << "Position " << (*columns != '\0' ? columns : "(empty)") << " on " << width << "x" << height << ", " << connect
+        << " in a row: score " << best << ", " << OUTCOMES[v.result] << " in " << v.length << " moves\n";
+    out << "column:";
+    for (int col = 0; col < width; col++)
+    {
+        out << setw(4) << col + 1;
+    }
+    out << "\nscore: ";
+    for (int col = 0; col < width; col++)
+    {
+        if (drops & gravityColumn(g, col))
+        {
+            out << setw(4) << scores[col];
+        }
+        else
+        {
+            out << setw(4) << "-";
+        }
+    }
+    out << "\n" << nodes << " positions in " << fixed << setprecision(3) << seconds << " s" << defaultfloat << "\n";
+    out << "Searched positions: ";
+    printTableStats(out, getTableStats(getGravityTable()));
+    return 0;
+}
+
+/**
+ * @brief a random position: random moves, none ending the game, the next one included
+ *
+ * @param moves     pieces to be played
+ * @param columns   the moves played (set)
+ */
+gravity_position randomGravityPosition(const gravity_rules &g, int moves, mt19937 &rng, string &columns)
+{
+    for (;;)
+    {
+        gravity_position p{0, 0, 0};
+        columns.clear();
+        while (p.moves < moves)
+        {
+            uint64_t drops = gravityDrops(g, p.mask) & ~gravityWinningCells(g, p.current, p.mask);
+            if (drops == 0)
+            {
+                break; // start again
+            }
+            int skip = rng() % __builtin_popcountll(drops);
+            for (; skip > 0; skip--)
+            {
+                drops &= drops - 1;
+            }
+            uint64_t move = drops & -drops;
+            columns += char('1' + __builtin_ctzll(move) / (g.height + 1));
+            playGravity(p, move);
+        }
+        if (p.moves == moves && (gravityDrops(g, p.mask) & gravityWinningCells(g, p.current, p.mask)) == 0)
+        {
+            return p; // not won at once
+        }
+    }
+}
+
+/**
+ * @brief Solve sets of random positions (end and middle game) and report the times
+ *
+ * @param positions positions per set
+ * @param seed      random seed of the positions
+ * @return int the exit code
+ */
+int runGravityBench(ostream &out, int positions, unsigned seed)
+{
+    struct bench_set
+    {
+        const char *name;
+        int minMoves, maxMoves; ///< pieces played
+    };
+    static const bench_set SETS[] = {{"end", 28, 35}, {"late middle", 20, 27}, {"middle", 14, 19}};
+    gravity_rules g = makeGravityRules(GRAVITY_BENCH_WIDTH, GRAVITY_BENCH_HEIGHT, GRAVITY_BENCH_CONNECT);
+    mt19937 rng(seed);
+    getGravityTable(); // created before the timings
+    out << "Connect Four " << g.width << "x" << g.height << ", " << positions << " random positions per set (seed " << seed
+        << ")\n";
+    out << setw(12) << "set" << setw(8) << "moves" << setw(12) << "mean ms" << setw(12) << "max ms" << setw(14) << "mean nodes"
+        << setw(10) << "M/s" << "  hardest\n";
+    for (const bench_set &set : SETS)
+    {
+        double total = 0, worst = 0;
+        unsigned long long nodes = 0;
+        string columns, hardest;
+        for (int i = 0; i < positions; i++)
+        {
+            int moves = set.minMoves + rng() % (set.maxMoves - set.minMoves + 1);
+            gravity_position p = randomGravityPosition(g, moves, rng, columns);
+            TimePoint start = theClock.now();
+            solveGravity(g, p, nodes);
+            double seconds = Duration(theClock.now() - start).count();
+            total += seconds;
+            if (seconds >= worst)
+            {
+                worst = seconds;
+                hardest = columns;
+            }
+        }
+        out << setw(12) << set.name << setw(5) << set.minMoves << "-" << setw(2) << set.maxMoves << fixed << setprecision(3)
+            << setw(12) << 1e3 * total / max(1, positions) << setw(12) << 1e3 * worst << setprecision(0) << setw(14)
+            << double(nodes) / max(1, positions) << setprecision(2) << setw(10) << (total > 0 ? nodes / total / 1e6 : 0)
+            << defaultfloat << "  " << hardest << "\n";
+        out.flush();
+    }
+    out << "Searched positions: ";
+    printTableStats(out, getTableStats(getGravityTable()));
+    return 0;
+}
+
+#endif
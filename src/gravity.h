@@ -0,0 +1,100 @@
+#ifndef GRAVITY_H
+#define GRAVITY_H
+
+// The gravity games (Connect Four) ============================================
+/**
+ * Variante con gravità: la pedina cade nella cella libera più bassa della
+ * colonna scelta, quindi ad ogni turno c'è al più una mossa per colonna.
+ * Vince chi allinea un certo numero di pedine (sulle scacchiere del tris
+ * tante quante la dimensione, 4 nel Forza Quattro 6x7).
+ * Il risolutore rappresenta ogni colonna con altezza + 1 bit (l'ultimo
+ * sempre vuoto, così gli allineamenti non proseguono nella colonna
+ * successiva): l'allineamento si verifica con pochi scorrimenti per
+ * direzione. La ricerca è alfa-beta a finestra nulla, con la tabella delle
+ * trasposizioni (posizione e sua speculare hanno la stessa chiave) e le
+ * mosse ordinate per minacce create.
+ */
+
+#define GRAVITY_MAX_WIDTH 8 ///< max columns
+
+/**
+ * @brief a board geometry
+ *
+ */
+struct gravity_rules
+{
+    int width, height;        ///< columns, rows
+    int connect;              ///< pieces in a row to win
+    uint64_t bottom;          ///< the bottom cell of each column
+    uint64_t board;           ///< all the cells
+    int order[GRAVITY_MAX_WIDTH]; ///< the columns, central first
+};
+
+/**
+ * @brief a position
+ *
+ */
+struct gravity_position
+{
+    uint64_t current; ///< cells of the player to move
+    uint64_t mask;    ///< occupied cells
+    int moves;        ///< pieces played
+};
+
+/**
+ * @brief Get a board geometry (at most 56 bits: width * (height + 1))
+ *
+ */
+gravity_rules makeGravityRules(int width, int height, int connect);
+
+/**
+ * @brief Play a sequence of columns ("1" = leftmost, such as "4453")
+ *
+ * @param p the position (played on)
+ * @return const char* the error, nullptr if played
+ */
+const char *playGravityColumns(const gravity_rules &, gravity_position &p, const char columns[]);
+
+/**
+ * @brief Solve a position (the game not over)
+ *
+ * A win with the last piece scores 1, every piece left to the winner one
+ * more; a draw scores 0.
+ *
+ * @param nodes positions searched (added)
+ * @return int the score for the player to move
+ */
+int solveGravity(const gravity_rules &, const gravity_position &, unsigned long long &nodes);
+
+/**
+ * @brief Get the solver move of a gravity game
+ *
+ * @return square the cell
+ */
+square gravityMove(const game &);
+
+/**
+ * @brief Analyze every move of a gravity game
+ *
+ * @param values    by cell, set for the cells reached by a move only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeGravityMoves(const game &, move_value values[]);
+
+/**
+ * @brief Solve a position given as columns and print its value and best moves
+ *
+ * @return int the exit code
+ */
+int printGravitySolution(std::ostream &, int width, int height, int connect, const char columns[]);
+
+/**
+ * @brief Solve sets of random positions (end and middle game) and report the times
+ *
+ * @param positions positions per set
+ * @param seed      random seed of the positions
+ * @return int the exit code
+ */
+int runGravityBench(std::ostream &, int positions, unsigned seed);
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef LATENCY_CPP
+#define LATENCY_CPP
+
+#include "latency.h"
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+
+// log-linear buckets: values below 2^HISTOGRAM_SUB_BITS ns are exact,
+// above that every power of two is split in 2^(HISTOGRAM_SUB_BITS - 1)
+// linear sub-buckets (about 3% precision)
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_MAX_BITS 44 ///< about 4.9 hours in ns, larger values are clamped
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+#define HISTOGRAM_BUCKETS ((1 << HISTOGRAM_SUB_BITS) + (HISTOGRAM_MAX_BITS + 1 - HISTOGRAM_SUB_BITS) * HISTOGRAM_HALF)
+#define HISTOGRAM_MOVES (MAX_DIM * MAX_DIM + 1) ///< move numbers 0 .. max cells
+#define HISTOGRAM_DIMS (MAX_DIM - MIN_DIM + 1)
+
+/**
+ * @brief fixed size latency histogram (values in ns)
+ *
+ */
+struct histogram
+{
+    std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS]; ///< samples per bucket
+    std::atomic<uint64_t> max;                       ///< maximum value
+};
+
+// all the histograms (static storage: zero initialized, never reallocated)
+histogram histograms[NUM_LATENCY_METRICS][HISTOGRAM_DIMS][HISTOGRAM_MOVES];
+
+const char *LATENCY_METRIC_NAMES[NUM_LATENCY_METRICS] = {
+    "getMove",
+    "input to redraw",
+    "makeMove",
+    "server request"};
+
+/**
+ * @brief bucket index for a value
+ *
+ * @param ns the value (in ns)
+ * @return size_t the bucket index
+ */
+inline size_t bucketOf(uint64_t ns)
+{
+    if (ns < (1 << HISTOGRAM_SUB_BITS))
+    {
+        return ns;
+    }
+    if (ns >> HISTOGRAM_MAX_BITS)
+    {
+        ns = (uint64_t(1) << (HISTOGRAM_MAX_BITS + 1)) - 1;
+    }
+    int shift = 63 - __builtin_clzll(ns) - (HISTOGRAM_SUB_BITS - 1);
+    return (1 << HISTOGRAM_SUB_BITS) + (shift - 1) * HISTOGRAM_HALF + (ns >> shift) - HISTOGRAM_HALF;
+}
+
+/**
+ * @brief highest value (in ns) falling in a bucket
+ *
+ * @param bucket the bucket index
+ * @return uint64_t the value
+ */
+inline uint64_t bucketTop(size_t bucket)
+{
+    if (bucket < (1 << HISTOGRAM_SUB_BITS))
+    {
+        return bucket;
+    }
+    bucket -= 1 << HISTOGRAM_SUB_BITS;
+    int shift = bucket / HISTOGRAM_HALF + 1;
+    uint64_t top = bucket % HISTOGRAM_HALF + HISTOGRAM_HALF;
+    return ((top + 1) << shift) - 1;
+}
+
+/**
+ * @brief Record a latency sample (lock-free)
+ *
+ * @param metric    the measured operation
+ * @param dim       the board dimension
+ * @param moveNumber the number of moves already made
+ * @param seconds   the measured latency
+ */
+void recordLatency(latency_metric metric, int dim, int moveNumber, double seconds)
+{
+    if (metric < 0 || metric >= NUM_LATENCY_METRICS || dim < MIN_DIM || dim > MAX_DIM)
+    {
+        return;
+    }
+    if (moveNumber < 0)
+    {
+        moveNumber = 0;
+    }
+    if (moveNumber >= HISTOGRAM_MOVES)
+    {
+        moveNumber = HISTOGRAM_MOVES - 1;
+    }
+    uint64_t ns = seconds > 0 ? uint64_t(seconds * 1e9) : 0;
+    histogram &h = histograms[metric][dim - MIN_DIM][moveNumber];
+    h.counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t prev = h.max.load(std::memory_order_relaxed);
+    while (ns > prev && !h.max.compare_exchange_weak(prev, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+/**
+ * @brief summarize bucket counts
+ *
+ * @param counts    the bucket counts
+ * @param max       the maximum value (in ns)
+ * @return latency_summary the summary
+ */
+latency_summary summarize(const uint64_t counts[], uint64_t max)
+{
+    latency_summary result{0, 0, 0, 0, 0, max * 1e-9};
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++)
+    {
+        result.count += counts[b];
+    }
+    const double fractions[] = {0.5, 0.9, 0.99, 0.999};
+    double *values[] = {&result.p50, &result.p90, &result.p99, &result.p999};
+    unsigned long long seen = 0;
+    size_t b = 0;
+    for (int i = 0; i < 4 && result.count > 0; i++)
+    {
+        // smallest bucket including the requested fraction of samples
+        unsigned long long wanted = result.count * fractions[i];
+        if (wanted < 1)
+        {
+            wanted = 1;
+        }
+        while (seen + counts[b] < wanted)
+        {
+            seen += counts[b++];
+        }
+        uint64_t top = bucketTop(b);
+        *values[i] = (top < max ? top : max) * 1e-9;
+    }
+    return result;
+}
+
+/**
+ * @brief accumulate the counts of a histogram
+ *
+ * @param h         the histogram
+ * @param counts    the accumulated counts
+ * @param max       the accumulated maximum
+ */
+void accumulate(const histogram &h, uint64_t counts[], uint64_t &max)
+{
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++)
+    {
+        counts[b] += h.counts[b].load(std::memory_order_relaxed);
+    }
+    uint64_t m = h.max.load(std::memory_order_relaxed);
+    max = m > max ? m : max;
+}
+
+/**
+ * @brief Get the summary of a metric for a board dimension (all moves)
+ *
+ * @return latency_summary the summary
+ */
+latency_summary getLatencySummary(latency_metric metric, int dim)
+{
+    uint64_t counts[HISTOGRAM_BUCKETS]{}, max = 0;
+    if (metric >= 0 && metric < NUM_LATENCY_METRICS && dim >= MIN_DIM && dim <= MAX_DIM)
+    {
+        for (int m = 0; m < HISTOGRAM_MOVES; m++)
+        {
+            accumulate(histograms[metric][dim - MIN_DIM][m], counts, max);
+        }
+    }
+    return summarize(counts, max);
+}
+
+/**
+ * @brief Get the name of a metric
+ *
+ * @return const char* the name
+ */
+const char *latencyMetricName(latency_metric metric)
+{
+    return LATENCY_METRIC_NAMES[metric];
+}
+
+/**
+ * @brief print a summary line (times in us)
+ *
+ */
+void printSummary(std::ostream &out, const char label[], const latency_summary &s)
+{
+    out << std::setw(8) << label << std::setw(10) << s.count << std::fixed << std::setprecision(1);
+    for (double v : {s.p50, s.p90, s.p99, s.p999, s.max})
+    {
+        out << std::setw(11) << v * 1e6;
+    }
+    out << std::defaultfloat << '\n';
+}
+
+/**
+ * @brief Print the full report, by board dimension and move number
+ *
+ */
+void printLatencyReport(std::ostream &out)
+{
+    for (int metric = 0; metric < NUM_LATENCY_METRICS; metric++)
+    {
+        for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+        {
+            latency_summary all = getLatencySummary((latency_metric)metric, dim);
+            if (all.count == 0)
+            {
+                continue;
+            }
+            out << LATENCY_METRIC_NAMES[metric] << " latency, board " << dim << "x" << dim << " (us)\n";
+            out << std::setw(8) << "move" << std::setw(10) << "count";
+            for (const char *p : {"p50", "p90", "p99", "p999", "max"})
+            {
+                out << std::setw(11) << p;
+            }
+            out << '\n';
+            for (int m = 0; m < HISTOGRAM_MOVES; m++)
+            {
+                uint64_t counts[HISTOGRAM_BUCKETS]{}, max = 0;
+                accumulate(histograms[metric][dim - MIN_DIM][m], counts, max);
+                latency_summary s = summarize(counts, max);
+                if (s.count > 0)
+                {
+                    printSummary(out, std::to_string(m + 1).c_str(), s);
+                }
+            }
+            printSummary(out, "all", all);
+            out << '\n';
+        }
+    }
+    out.flush();
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+// The latency statistics ======================================================
+/**
+ * Istogrammi di latenza (stile HDR) per le operazioni più sensibili:
+ * memoria fissa allocata staticamente e registrazione lock-free, così da poter
+ * essere usati da qualsiasi thread senza influenzare ciò che misurano.
+ * I campioni sono suddivisi per dimensione della scacchiera e numero di mossa.
+ */
+
+#include <ostream>
+
+/**
+ * @brief measured operations
+ *
+ */
+enum latency_metric
+{
+    LAT_GET_MOVE,        ///< AI move computation (getMove)
+    LAT_INPUT_TO_REDRAW, ///< from human input to redrawn screen
+    LAT_MAKE_MOVE,       ///< move application (makeMove)
+    LAT_SERVER_REQUEST,  ///< server round trip (MOVE/AI) seen by a client
+    NUM_LATENCY_METRICS  ///< fake code: total number of metrics
+};
+
+/**
+ * @brief summary of a latency distribution (values in seconds)
+ *
+ */
+struct latency_summary
+{
+    unsigned long long count;   ///< number of samples
+    double p50, p90, p99, p999; ///< percentiles
+    double max;                 ///< maximum value
+};
+
+/**
+ * @brief Record a latency sample (lock-free)
+ *
+ * @param metric    the measured operation
+ * @param dim       the board dimension
+ * @param moveNumber the number of moves already made
+ * @param seconds   the measured latency
+ */
+void recordLatency(latency_metric metric, int dim, int moveNumber, double seconds);
+
+/**
+ * @brief Get the summary of a metric for a board dimension (all moves)
+ *
+ * @return latency_summary the summary
+ */
+latency_summary getLatencySummary(latency_metric, int dim);
+
+/**
+ * @brief Get the name of a metric
+ *
+ * @return const char* the name
+ */
+const char *latencyMetricName(latency_metric);
+
+/**
+ * @brief Print the full report, by board dimension and move number
+ *
+ */
+void printLatencyReport(std::ostream &);
+
+#endif
@@ -35,34 +35,284 @@ using namespace std;
 // application configuration
 const double TIME_ALLOWED = 100; ///< ten seconds = 1 seconds / guess
 const int BOARD_DIM = 4;         ///< default board dimension
+const char SNAPSHOT_PREFIX[] = "solved"; ///< solved positions files (solved4x4.tt, ...)
+const double SNAPSHOT_INTERVAL = 30;     ///< seconds between background saves
+const char BOOK_FILE[] = "book4x4.bin";  ///< 4x4 opening book
+const int BOOK_PLIES = 6;                ///< default moves covered by a new book
+const char STRATEGY_PREFIX[] = "strategy"; ///< AI strategies (strategy4x4.bin, ...)
+const char RECORDS_FILE[] = "games.rec";   ///< played games (appended)
+const char INDEX_FILE[] = "games.idx";     ///< positions of the played games
+const char NETWORK_PREFIX[] = "nnue";      ///< trained evaluations (nnue4x4.bin, ...)
+
+#include "engine.h"
 
 struct configuration
 {
     double timeAllowed{TIME_ALLOWED}; ///< tempo concesso per indovinare
     size_t boardDim{BOARD_DIM};       ///< board dimension
+    size_t tableMegabytes{256};       ///< memory for solved positions (MB)
+    bool hugePages{true};             ///< solved positions on huge pages
+    bool sharedTable{false};          ///< solved positions shared by all processes
+    bool interactive{true};           ///< whether games are shown (not saved)
+    bool gravity{false};              ///< pieces drop to the bottom of the column (not saved)
+    size_t players{2};                ///< players of a game (not saved)
+    engine_kind engines[2]{ENGINE_SOLVER, ENGINE_SOLVER}; ///< engines of the computer players (X, O)
+    engine_settings resources[NUM_ENGINE_KINDS];         ///< resources of each engine
 };
 
 // carica e restituisce la configurazione dell'applicazione
 configuration loadConfiguration();
 // salva la configurazione dell'applicazione
 void saveConfiguration(const configuration &);
+// gioca partite computer contro computer senza interfaccia
+int selfPlay(configuration, int games);
+// indica se un giocatore computer usa il risolutore
+bool solverPlays(const configuration &);
 
+#include "transposition.h"
+#include "record.h"
+#include "symmetry.h"
+#include "posindex.h"
+#include "protocol.h"
 #include "game.h"
+#include "qubic.h"
+#include "gomoku.h"
+#include "ultimate.h"
+#include "gravity.h"
+#include "multiplayer.h"
+#include "nnue.h"
 #include "action.h"
 #include "ui.h"
+#include "latency.h"
+#include "server.h"
+#include "tournament.h"
 
 #include "game.cpp"
+#include "engine.cpp"
+#include "qubic.cpp"
+#include "gomoku.cpp"
+#include "ultimate.cpp"
+#include "gravity.cpp"
+#include "multiplayer.cpp"
+#include "nnue.cpp"
 #include "action.cpp"
 #include "ui.cpp"
+#include "latency.cpp"
+#include "transposition.cpp"
+#include "record.cpp"
+#include "symmetry.cpp"
+#include "posindex.cpp"
+#include "protocol.cpp"
+#include "server.cpp"
+#include "tournament.cpp"
 
 // The main logic ==============================================================
 int main(int argc, char *argv[])
 {
     srand(time(nullptr)); // set random seed if needed
+    if (argc > 1 && string(argv[1]) == "selfplay")
+    {
+        // headless: main selfplay [games] [dim] [X engine] [O engine]
+        configuration config = loadConfiguration();
+        if (argc > 3)
+        {
+            config.boardDim = atoi(argv[3]);
+        }
+        for (int p = 0; p < 2 && argc > 4 + p; p++)
+        {
+            config.engines[p] = engineKind(argv[4 + p]);
+            if (!isComputerEngine(config.engines[p]))
+            {
+                cerr << "Unknown engine " << argv[4 + p] << endl;
+                return 1;
+            }
+        }
+        return selfPlay(config, argc > 2 ? atoi(argv[2]) : 100);
+    }
+    if (argc > 1 && string(argv[1]) == "tournament")
+    {
+        // headless: main tournament [games per pair] [min dim] [max dim] [games at a time]
+        configuration config = loadConfiguration();
+        int minDim = argc > 3 ? atoi(argv[3]) : MIN_DIM, maxDim = argc > 4 ? atoi(argv[4]) : MAX_DIM;
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        startSolverSnapshots(SNAPSHOT_PREFIX, SNAPSHOT_INTERVAL);
+        loadOpeningBook(BOOK_FILE);
+        loadStrategies(STRATEGY_PREFIX);
+        loadNetworks(NETWORK_PREFIX);
+        startGameRecords(RECORDS_FILE, SOURCE_TOURNAMENT);
+        if (minDim <= 4 && 4 <= maxDim)
+        {
+            initAI(); // the solver plays in every tournament
+        }
+        int result = runTournament(cout, config, argc > 2 ? atoi(argv[2]) : 100, minDim, maxDim, argc > 5 ? atoi(argv[5]) : 0);
+        stopGameRecords();
+        stopSolverSnapshots();
+        printSolverReport(cout);
+        return result;
+    }
+    if (argc > 1 && (string(argv[1]) == "qubic" || string(argv[1]) == "qubicbench"))
+    {
+        // main qubic [seconds per computer move], main qubicbench [games] [seconds per move]
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        if (string(argv[1]) == "qubic")
+        {
+            return playQubic(argc > 2 ? atof(argv[2]) : 1);
+        }
+        return runQubicBench(cout, argc > 2 ? atoi(argv[2]) : 10, argc > 3 ? atof(argv[3]) : 0.1);
+    }
+    if (argc > 1 && (string(argv[1]) == "gomoku" || string(argv[1]) == "gomokubench"))
+    {
+        // main gomoku (the time of each player from config.ini), main gomokubench [games] [seconds per move]
+        configuration config = loadConfiguration();
+        if (string(argv[1]) == "gomoku")
+        {
+            return playGomoku(config.timeAllowed);
+        }
+        return runGomokuBench(cout, argc > 2 ? atoi(argv[2]) : 2, argc > 3 ? atof(argv[3]) : 0.5);
+    }
+    if (argc > 1 && (string(argv[1]) == "ultimate" || string(argv[1]) == "ultimatebench"))
+    {
+        // main ultimate [seconds per computer move] [threads], main ultimatebench [positions] [seconds] [max threads]
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        int cores = max(1u, thread::hardware_concurrency());
+        if (string(argv[1]) == "ultimate")
+        {
+            return playUltimate(argc > 2 ? atof(argv[2]) : 1, argc > 3 ? atoi(argv[3]) : cores);
+        }
+        return runUltimateBench(cout, argc > 2 ? atoi(argv[2]) : 20, argc > 3 ? atof(argv[3]) : 0.1,
+                                argc > 4 ? atoi(argv[4]) : cores);
+    }
+    if (argc > 1 && (string(argv[1]) == "connect4" || string(argv[1]) == "connect4bench"))
+    {
+        // main connect4 [columns] [width height connect], main connect4bench [positions per set] [seed]
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        if (string(argv[1]) == "connect4")
+        {
+            return printGravitySolution(cout, argc > 3 ? atoi(argv[3]) : 7, argc > 4 ? atoi(argv[4]) : 6,
+                                        argc > 5 ? atoi(argv[5]) : 4, argc > 2 ? argv[2] : "");
+        }
+        return runGravityBench(cout, argc > 2 ? atoi(argv[2]) : 20, argc > 3 ? strtoul(argv[3], nullptr, 10) : 1);
+    }
+    if (argc > 1 && string(argv[1]) == "multibench")
+    {
+        // benchmark: main multibench [games] [dim] [players] [seconds per move]
+        loadConfiguration();
+        return runMultiplayerBench(cout, argc > 2 ? atoi(argv[2]) : 10, argc > 3 ? atoi(argv[3]) : 4,
+                                   argc > 4 ? atoi(argv[4]) : 3, argc > 5 ? atof(argv[5]) : 0.1);
+    }
+    if (argc > 1 && string(argv[1]) == "ttbench")
+    {
+        // benchmark: main ttbench [max threads] [seconds per run]
+        return runTableBench(argc > 2 ? atoi(argv[2]) : thread::hardware_concurrency(), argc > 3 ? atof(argv[3]) : 1);
+    }
+    if (argc > 1 && string(argv[1]) == "book")
+    {
+        // tool: main book [plies] [file]
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        return writeOpeningBook(argc > 3 ? argv[3] : BOOK_FILE, argc > 2 ? atoi(argv[2]) : BOOK_PLIES);
+    }
+    if (argc > 1 && string(argv[1]) == "strategy")
+    {
+        // tool: main strategy [dim]
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        return writeStrategy(STRATEGY_PREFIX, argc > 2 ? atoi(argv[2]) : BOARD_DIM);
+    }
+    if (argc > 1 && string(argv[1]) == "records")
+    {
+        // tool: main records [file]
+        return printGameRecords(cout, argc > 2 ? argv[2] : RECORDS_FILE);
+    }
+    if (argc > 1 && string(argv[1]) == "index")
+    {
+        // tool: main index [records file] [index file]
+        return buildPositionIndex(argc > 2 ? argv[2] : RECORDS_FILE, argc > 3 ? argv[3] : INDEX_FILE);
+    }
+    if (argc > 1 && string(argv[1]) == "query")
+    {
+        // tool: main query <board> [X|O to move] [index file]
+        if (argc < 3)
+        {
+            cerr << "usage: main query <board, such as X...O...........> [X|O] [index file]" << endl;
+            return 1;
+        }
+        return queryPositionIndex(cout, argc > 4 ? argv[4] : INDEX_FILE, argv[2], argc > 3 ? argv[3][0] : '-');
+    }
+    if (argc > 1 && string(argv[1]) == "protocol")
+    {
+        // headless: main protocol (commands on stdin, answers on stdout)
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        startSolverSnapshots(SNAPSHOT_PREFIX, SNAPSHOT_INTERVAL);
+        int result = runEngineProtocol(STDIN_FILENO, STDOUT_FILENO);
+        stopSolverSnapshots();
+        return result;
+    }
+    if (argc > 1 && string(argv[1]) == "symbench")
+    {
+        // benchmark: main symbench [seconds per run]
+        return runSymmetryBench(argc > 2 ? atof(argv[2]) : 1);
+    }
+    if (argc > 1 && string(argv[1]) == "nnuetrain")
+    {
+        // tool: main nnuetrain [dim] [epochs] [records file]
+        return trainNetwork(argc > 4 ? argv[4] : RECORDS_FILE, NETWORK_PREFIX, argc > 2 ? atoi(argv[2]) : BOARD_DIM,
+                            argc > 3 ? atoi(argv[3]) : 20);
+    }
+    if (argc > 1 && string(argv[1]) == "nnuebench")
+    {
+        // benchmark: main nnuebench [games] [dim] [seconds per move]
+        loadNetworks(NETWORK_PREFIX);
+        return runNetworkBench(argc > 2 ? atoi(argv[2]) : 100, argc > 3 ? atoi(argv[3]) : BOARD_DIM,
+                               argc > 4 ? atof(argv[4]) : 0.01);
+    }
+    if (argc > 1 && string(argv[1]) == "evalbench")
+    {
+        // benchmark: main evalbench [seconds per run]
+        return runEvalBench(argc > 2 ? atof(argv[2]) : 1);
+    }
+    if (argc > 1 && string(argv[1]) == "server")
+    {
+        // headless: main server [port|socket path] [workers] [dim]
+        configuration config = loadConfiguration();
+        setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+        startSolverSnapshots(SNAPSHOT_PREFIX, SNAPSHOT_INTERVAL);
+        loadOpeningBook(BOOK_FILE);
+        loadStrategies(STRATEGY_PREFIX);
+        loadNetworks(NETWORK_PREFIX);
+        startGameRecords(RECORDS_FILE, SOURCE_SERVER);
+        if (argc > 4)
+        {
+            config.boardDim = atoi(argv[4]);
+        }
+        int result = runServer(config, argc > 2 ? argv[2] : "5555", argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency());
+        stopGameRecords();
+        stopSolverSnapshots();
+        return result;
+    }
+    if (argc > 1 && string(argv[1]) == "serverbench")
+    {
+        // load test: main serverbench [port|socket path] [clients] [seconds]
+        return runServerBench(argc > 2 ? argv[2] : "5555", argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? atof(argv[4]) : 10);
+    }
     showWelcomeScreen();
+    statusMsg("Loading configuration...");
     configuration config = loadConfiguration();
+    setSolverMemory(config.tableMegabytes, config.hugePages, config.sharedTable);
+    startSolverSnapshots(SNAPSHOT_PREFIX, SNAPSHOT_INTERVAL);
+    loadOpeningBook(BOOK_FILE);
+    loadStrategies(STRATEGY_PREFIX);
+    loadNetworks(NETWORK_PREFIX);
+    startGameRecords(RECORDS_FILE, SOURCE_INTERACTIVE);
     statusMsg("Initializing AI. Please wait... ");
-    initAI();
+    if (solverPlays(config))
+    {
+        initAI();
+    }
     hideWelcomeScreen();
     action a;
     game g = newGame(config);
@@ -74,7 +324,11 @@ int main(int argc, char *argv[])
         processUserAction(a, g, config);
     } while (a.code != EXIT);
     saveConfiguration(config);
+    stopGameRecords();
+    stopSolverSnapshots();
     showFarewellScreen();
+    printLatencyReport(cout);
+    printSolverReport(cout);
 
     /// successful termination
     return 0;
@@ -84,14 +338,43 @@ int main(int argc, char *argv[])
 // application functions
 configuration loadConfiguration()
 {
-    statusMsg("Loading configuration...");
     configuration result;
     ifstream in("config.ini");
     if (in)
     {
         in >> result.timeAllowed >> result.boardDim;
+        in >> result.tableMegabytes >> result.hugePages >> result.sharedTable; // missing in older files
+        // engines of the computer players, then the resources of each engine
+        string names[2], name;
+        in >> names[0] >> names[1];
+        for (int p = 0; p < 2; p++)
+        {
+            engine_kind e = engineKind(names[p].c_str());
+            if (isComputerEngine(e))
+            {
+                result.engines[p] = e;
+            }
+        }
+        engine_settings s;
+        while (in >> name >> s.threads >> s.megabytes >> s.seconds)
+        {
+            engine_kind e = engineKind(name.c_str());
+            if (isComputerEngine(e))
+            {
+                result.resources[e] = s;
+            }
+            if (e == ENGINE_SOLVER)
+            {
+                result.tableMegabytes = s.megabytes; // the solver memory is the solved positions table
+            }
+        }
     }
     in.close();
+    result.resources[ENGINE_SOLVER].megabytes = result.tableMegabytes;
+    for (int e = 0; e < NUM_ENGINE_KINDS; e++)
+    {
+        setEngineSettings(engine_kind(e), result.resources[e]); // engines are created on first use
+    }
     return result;
 }
 void saveConfiguration(const configuration &c)
@@ -100,7 +383,73 @@ void saveConfiguration(const configuration &c)
     ofstream out("config.ini");
     if (out)
     {
-        out << c.timeAllowed << " " << c.boardDim;
+        out << c.timeAllowed << " " << c.boardDim << " " << c.tableMegabytes << " " << c.hugePages << " " << c.sharedTable;
+        out << "\n" << engineName(c.engines[0]) << " " << engineName(c.engines[1]);
+        for (int e = 0; e < NUM_ENGINE_KINDS; e++)
+        {
+            if (isComputerEngine(engine_kind(e)))
+            {
+                engine_settings s = c.resources[e];
+                if (e == ENGINE_SOLVER)
+                {
+                    s.megabytes = c.tableMegabytes;
+                }
+                out << "\n" << engineName(engine_kind(e)) << " " << s.threads << " " << s.megabytes << " " << s.seconds;
+            }
+        }
     }
     out.close();
+    saveSolverSnapshots();
+}
+int selfPlay(configuration c, int games)
+{
+    c.interactive = false;
+    if (c.boardDim < MIN_DIM || c.boardDim > MAX_DIM)
+    {
+        cerr << "Invalid board dimension " << c.boardDim << endl;
+        return 1;
+    }
+    setSolverMemory(c.tableMegabytes, c.hugePages, c.sharedTable);
+    startSolverSnapshots(SNAPSHOT_PREFIX, SNAPSHOT_INTERVAL);
+    loadOpeningBook(BOOK_FILE);
+    loadStrategies(STRATEGY_PREFIX);
+    loadNetworks(NETWORK_PREFIX);
+    startGameRecords(RECORDS_FILE, SOURCE_SELFPLAY);
+    if (c.boardDim == 4 && solverPlays(c))
+    {
+        initAI();
+    }
+    int outcomes[PLAYER_NONE + 1]{};
+    for (int i = 0; i < games; i++)
+    {
+        game g = newGame(c);
+        for (player p = 0; p < NUM_PLAYERS; p++)
+        {
+            setPlayerEngine(g, p, c.engines[p]);
+        }
+        while (getStatus(g) == RUNNING)
+        {
+            makeMove(g, getEngineMove(g));
+        }
+        outcomes[getWinner(g)]++;
+    }
+    stopGameRecords();
+    stopSolverSnapshots();
+    cout << "Self-play: " << games << " games on " << c.boardDim << "x" << c.boardDim << " board, X " << engineName(c.engines[0])
+         << " vs O " << engineName(c.engines[1]) << "\n";
+    cout << "X wins: " << outcomes[0] << ", O wins: " << outcomes[1] << ", draws: " << outcomes[PLAYER_NONE] << "\n\n";
+    printLatencyReport(cout);
+    printSolverReport(cout);
+    return 0;
+}
+bool solverPlays(const configuration &c)
+{
+    for (engine_kind e : c.engines)
+    {
+        if (e == ENGINE_SOLVER || e == ENGINE_WEAK)
+        {
+            return true;
+        }
+    }
+    return false;
 }
@@ -0,0 +1,484 @@
+#ifndef MULTIPLAYER_CPP
+#define MULTIPLAYER_CPP
+
+#include "multiplayer.h"
+#include <climits>
+
+#define MULTI_TOTAL 30000                           ///< sum of the scores of the players (at most)
+#define MULTI_WON (MULTI_TOTAL - MAX_DIM * MAX_DIM)  ///< least score of a won position (more for a quicker win)
+#define MULTI_SHARE (MULTI_TOTAL / 2)               ///< the positions not over share less than a win
+#define MULTI_EXACT 255                             ///< stored depth of a result not depending on the evaluation
+#define MULTI_TABLE_BITS 19                         ///< positions of the table of each thread (log2)
+#define MULTI_CLOCK_CHECK 1023                      ///< nodes between clock checks (mask)
+#define MULTI_NO_MOVE (-1)                          ///< no move known
+
+const int MULTI_LINE_WEIGHTS[MAX_DIM + 1] = {0, 1, 4, 16, 64}; ///< of a line still open to a player, by pieces
+
+/**
+ * @brief a searched position
+ *
+ */
+struct multi_entry
+{
+    uint64_t key;                ///< the position (0 = empty entry)
+    int16_t scores[MAX_PLAYERS]; ///< of each player
+    uint8_t depth;               ///< moves searched (MULTI_EXACT if to the end), 0 if only the move is known
+    int8_t move;                 ///< best move (cell, MULTI_NO_MOVE if none)
+};
+
+/**
+ * @brief the transposition table of the calling thread
+ *
+ */
+vector<multi_entry> &multiTable()
+{
+    thread_local vector<multi_entry> table(size_t(1) << MULTI_TABLE_BITS);
+    return table;
+}
+
+/**
+ * @brief a search in progress
+ *
+ */
+struct multi_search
+{
+    const rules &r;             ///< board
+    bool gravity;               ///< pieces drop to the lowest empty cell
+    int numPlayers;             ///< players
+    vector<multi_entry> &table; ///< searched positions
+    TimePoint deadline;         ///< stop searching
+    unsigned long long nodes;   ///< positions searched
+    bool stopped;               ///< the deadline has passed
+};
+
+/**
+ * @brief the scores of a node (of each player, the player indexes of the game)
+ *
+ */
+struct multi_scores
+{
+    int s[MAX_PLAYERS];
+};
+
+/**
+ * @brief identify a position (the boards of the players, the player to move and the rules)
+ *
+ */
+uint64_t multiKey(const multi_search &s, const moves done[], int turn)
+{
+    uint64_t key = 0;
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        key |= uint64_t(done[p]) << (p * MAX_DIM * MAX_DIM);
+    }
+    key |= uint64_t(turn) << 48 | uint64_t(s.r.dim) << 50 | uint64_t(s.gravity) << 53 | uint64_t(s.numPlayers) << 54;
+    return key;
+}
+
+/**
+ * @brief the entry of a position
+ *
+ */
+inline multi_entry &multiEntry(multi_search &s, uint64_t key)
+{
+    return s.table[key * 0x9E3779B97F4A7C15ull >> (64 - MULTI_TABLE_BITS)];
+}
+
+/**
+ * @brief the scores of a position won by a player
+ *
+ * @param plies moves to the win (from the position)
+ */
+multi_scores multiWon(int winner, int plies)
+{
+    multi_scores result{};
+    result.s[winner] = MULTI_TOTAL - plies;
+    return result;
+}
+
+/**
+ * @brief the scores of a position not over
+ *
+ * Each player has the weights of the lines still open to them, the scores
+ * share MULTI_SHARE in proportion.
+ */
+multi_scores multiEvaluate(const multi_search &s, const moves done[])
+{
+    int weights[MAX_PLAYERS], total = 0;
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        moves others = 0;
+        for (int q = 0; q < s.numPlayers; q++)
+        {
+            others |= q != p ? done[q] : 0;
+        }
+        weights[p] = 1;
+        for (size_t i = 0; i < s.r.numWinnings; i++)
+        {
+            if ((s.r.winnings[i] & others) == 0)
+            {
+                weights[p] += MULTI_LINE_WEIGHTS[__builtin_popcount(s.r.winnings[i] & done[p])];
+            }
+        }
+        total += weights[p];
+    }
+    multi_scores result{};
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        result.s[p] = MULTI_SHARE * weights[p] / total;
+    }
+    return result;
+}
+
+/**
+ * @brief the cells completing a line of a player
+ *
+ */
+moves multiWinningCells(const multi_search &s, moves mine, moves empty)
+{
+    moves result = 0;
+    for (size_t i = 0; i < s.r.numWinnings; i++)
+    {
+        moves missing = s.r.winnings[i] & ~mine;
+        if (__builtin_popcount(missing) == 1)
+        {
+            result |= missing & empty;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief order the moves: the known best one, the blocks, then by the lines open through the cell
+ *
+ * @return int the number of moves
+ */
+int multiOrderMoves(const multi_search &s, const moves done[], moves legal, int first, int result[])
+{
+    moves all = 0, empty = s.r.full;
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        all |= done[p];
+    }
+    empty &= ~all;
+    moves threats = 0;
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        threats |= multiWinningCells(s, done[p], empty);
+    }
+    int priority[MAX_DIM * MAX_DIM], count = 0;
+    for (moves m = legal; m != 0; m &= m - 1)
+    {
+        int cell = __builtin_ctz(m), value = 0;
+        moves bit = 1u << cell;
+        if (cell == first)
+        {
+            value = INT_MAX;
+        }
+        else
+        {
+            value = (threats & bit) != 0 ? 1 << 20 : 0;
+            for (size_t i = 0; i < s.r.numWinnings; i++)
+            {
+                if ((s.r.winnings[i] & bit) == 0)
+                {
+                    continue;
+                }
+                for (int p = 0; p < s.numPlayers; p++)
+                {
+                    if ((s.r.winnings[i] & all & ~done[p]) == 0)
+                    {
+                        value += 1 + MULTI_LINE_WEIGHTS[__builtin_popcount(s.r.winnings[i] & done[p])];
+                    }
+                }
+            }
+        }
+        // insertion sort, best first
+        int i = count++;
+        for (; i > 0 && priority[i - 1] < value; i--)
+        {
+            priority[i] = priority[i - 1];
+            result[i] = result[i - 1];
+        }
+        priority[i] = value;
+        result[i] = cell;
+    }
+    return count;
+}
+
+/**
+ * @brief max^n search with shallow pruning
+ *
+ * Every score is at least 0 and their sum at most MULTI_TOTAL: once the
+ * player to move has at least MULTI_TOTAL - bound, the previous player
+ * would get at most bound here, no more than elsewhere (cut).
+ *
+ * @param depth     moves to search
+ * @param bound     the best score of the previous player so far
+ * @param result    the scores (of each player)
+ * @return true if the result does not depend on the evaluation (searched to the end)
+ */
+bool multiSearch(multi_search &s, moves done[], int turn, int depth, int bound, multi_scores &result)
+{
+    if ((++s.nodes & MULTI_CLOCK_CHECK) == 0 && theClock.now() >= s.deadline)
+    {
+        s.stopped = true;
+    }
+    if (s.stopped)
+    {
+        return false;
+    }
+    moves all = 0;
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        all |= done[p];
+    }
+    moves legal = dropMoves(s.r, all, s.gravity);
+    if ((multiWinningCells(s, done[turn], legal)) != 0)
+    {
+        result = multiWon(turn, 1); // wins now
+        return true;
+    }
+    if (legal == 0)
+    {
+        result = multi_scores{}; // draw
+        for (int p = 0; p < s.numPlayers; p++)
+        {
+            result.s[p] = MULTI_SHARE / s.numPlayers;
+        }
+        return true;
+    }
+    if (depth == 0)
+    {
+        result = multiEvaluate(s, done);
+        return false;
+    }
+    uint64_t key = multiKey(s, done, turn);
+    multi_entry &e = multiEntry(s, key);
+    int first = MULTI_NO_MOVE;
+    if (e.key == key)
+    {
+        if (e.depth >= depth)
+        {
+            for (int p = 0; p < s.numPlayers; p++)
+            {
+                result.s[p] = e.scores[p];
+            }
+            return e.depth == MULTI_EXACT;
+        }
+        first = e.move;
+    }
+    int order[MAX_DIM * MAX_DIM];
+    int count = multiOrderMoves(s, done, legal, first, order);
+    int next = (turn + 1) % s.numPlayers, best = MULTI_NO_MOVE;
+    bool exact = true, cut = false; // a cut is exact too: the scores that caused it are
+    for (int i = 0; i < count && !cut; i++)
+    {
+        multi_scores child;
+        done[turn] |= 1u << order[i];
+        exact &= multiSearch(s, done, next, depth - 1, best == MULTI_NO_MOVE ? 0 : result.s[turn], child);
+        done[turn] &= ~(1u << order[i]);
+        if (s.stopped)
+        {
+            return false;
+        }
+        for (int p = 0; p < s.numPlayers; p++)
+        {
+            child.s[p] -= child.s[p] >= MULTI_WON; // a win is a move further
+        }
+        if (best == MULTI_NO_MOVE || child.s[turn] > result.s[turn])
+        {
+            result = child;
+            best = order[i];
+        }
+        cut = result.s[turn] >= MULTI_TOTAL - bound;
+    }
+    // keep the best move, the scores only if not cut (else a bound only)
+    multi_entry &slot = multiEntry(s, key);
+    slot.key = key;
+    slot.move = best;
+    slot.depth = cut ? 0 : exact ? MULTI_EXACT : depth;
+    for (int p = 0; p < s.numPlayers; p++)
+    {
+        slot.scores[p] = result.s[p];
+    }
+    return exact;
+}
+
+/**
+ * @brief iterative deepening search of the moves of the player to move
+ *
+ * @param all       whether every move gets its scores (else the moves worse than the best are cut)
+ * @param scores    by cell (set for the allowed moves)
+ * @return int the best move (cell from the min cell)
+ */
+int multiRoot(const game &g, double seconds, bool all, multi_scores scores[], multiplayer_search_info &info)
+{
+    TimePoint start = theClock.now();
+    multi_search s{*g.r, g.gravity, g.numPlayers, multiTable(),
+                   start + chrono::duration_cast<Clock::duration>(Duration(seconds)), 0, false};
+    moves done[MAX_PLAYERS] = {};
+    copy(g.done, g.done + g.numPlayers, done);
+    int turn = getTurn(g), next = (turn + 1) % g.numPlayers;
+    moves legal = legalMoves(g), wins = multiWinningCells(s, done[turn], legal);
+    int order[MAX_DIM * MAX_DIM], best = __builtin_ctz(legal), empty = __builtin_popcount(g.r->full & ~allMoves(g));
+    info = {0, false, 0, 0};
+    for (int depth = 1; depth <= empty && !info.exact; depth++)
+    {
+        int count = multiOrderMoves(s, done, legal, best, order), found = MULTI_NO_MOVE;
+        multi_scores foundScores[MAX_DIM * MAX_DIM]{};
+        bool exact = true;
+        for (int i = 0; i < count; i++)
+        {
+            multi_scores &child = foundScores[order[i]];
+            if ((wins >> order[i] & 1) != 0)
+            {
+                child = multiWon(turn, 1); // wins now
+            }
+            else
+            {
+                done[turn] |= 1u << order[i];
+                int bound = all || found == MULTI_NO_MOVE ? 0 : foundScores[found].s[turn];
+                bool known = multiSearch(s, done, next, depth - 1, bound, child);
+                done[turn] &= ~(1u << order[i]);
+                if (s.stopped)
+                {
+                    break;
+                }
+                exact &= known;
+                for (int p = 0; p < g.numPlayers; p++)
+                {
+                    child.s[p] -= child.s[p] >= MULTI_WON;
+                }
+            }
+            if (found == MULTI_NO_MOVE || child.s[turn] > foundScores[found].s[turn])
+            {
+                found = order[i];
+            }
+        }
+        if (found == MULTI_NO_MOVE || (s.stopped && depth > 1))
+        {
+            break; // the last search completed stands
+        }
+        best = found;
+        copy(foundScores, foundScores + g.r->numCells, scores);
+        info.depth = depth;
+        info.exact = exact;
+    }
+    info.nodes = s.nodes;
+    info.seconds = Duration(theClock.now() - start).count();
+    return best;
+}
+
+/**
+ * @brief the think time of the player to move: the solver one, within the game clock
+ *
+ */
+double multiThinkTime(const game &g)
+{
+    double left = g.timeAllowed - getElapsed(g, getTurn(g));
+    int ownMoves = (__builtin_popcount(legalMoves(g)) + g.numPlayers - 1) / g.numPlayers;
+    return max(0.0, min(getEngineSettings(ENGINE_SOLVER).seconds, left / (ownMoves + 1)));
+}
+
+/**
+ * @brief Get the move of the player to move (the game not over, more than two players)
+ *
+ * @return square the cell
+ */
+square multiplayerMove(const game &g)
+{
+    multi_scores scores[MAX_DIM * MAX_DIM];
+    multiplayer_search_info info;
+    return g.r->minCell + multiRoot(g, multiThinkTime(g), false, scores, info);
+}
+
+/**
+ * @brief Analyze every move of the player to move (more than two players)
+ *
+ * @param values    by cell, set for the allowed moves only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeMultiplayerMoves(const game &g, move_value values[])
+{
+    if (getStatus(g) != RUNNING)
+    {
+        return 0;
+    }
+    multi_scores scores[MAX_DIM * MAX_DIM];
+    multiplayer_search_info info;
+    multiRoot(g, getEngineSettings(ENGINE_SOLVER).seconds, true, scores, info);
+    int count = 0, turn = getTurn(g), empty = __builtin_popcount(g.r->full & ~allMoves(g));
+    for (moves m = legalMoves(g); m != 0; m &= m - 1, count++)
+    {
+        int cell = __builtin_ctz(m), winner = -1;
+        for (int p = 0; p < g.numPlayers; p++)
+        {
+            winner = scores[cell].s[p] >= MULTI_WON ? p : winner;
+        }
+        // a win after MULTI_TOTAL - score moves, this one included; else the game goes on to the end
+        values[cell] = winner < 0         ? move_value{DRAW, empty}
+                       : winner == turn ? move_value{WINNING, MULTI_TOTAL - scores[cell].s[winner]}
+                                        : move_value{LOSING, MULTI_TOTAL - scores[cell].s[winner]};
+    }
+    return count;
+}
+
+/**
+ * @brief Play computer games of more than two players and report the searches
+ *
+ * @param games     games played
+ * @param dim       board dimension
+ * @param players   players of a game
+ * @param seconds   per move
+ * @return int the exit code
+ */
+int runMultiplayerBench(ostream &out, int games, int dim, int players, double seconds)
+{
+    if (dim < MIN_DIM || dim > MAX_DIM || players <= NUM_PLAYERS || players > MAX_PLAYERS)
+    {
+        cerr << "Invalid board dimension or players" << endl;
+        return 1;
+    }
+    configuration c;
+    c.boardDim = dim;
+    c.players = players;
+    c.interactive = false;
+    int wins[PLAYER_NONE + 1]{}, exact = 0, maxDepth = 0, moveCount = 0;
+    unsigned long long nodes = 0;
+    double total = 0, slowest = 0, depths = 0;
+    for (int i = 0; i < games; i++)
+    {
+        game g = newGame(c);
+        while (getStatus(g) == RUNNING)
+        {
+            multi_scores scores[MAX_DIM * MAX_DIM];
+            multiplayer_search_info info;
+            int move = multiRoot(g, seconds, false, scores, info);
+            makeMove(g, g.r->minCell + move);
+            moveCount++;
+            nodes += info.nodes;
+            total += info.seconds;
+            slowest = max(slowest, info.seconds);
+            depths += info.depth;
+            maxDepth = max(maxDepth, info.depth);
+            exact += info.exact;
+        }
+        // by order of play: the first player is 0
+        player winner = getWinner(g);
+        wins[winner == PLAYER_NONE ? PLAYER_NONE : (winner + g.numPlayers - g.first) % g.numPlayers]++;
+    }
+    out << players << " players, " << dim << "x" << dim << " board, " << games << " games, " << seconds << " s per move\n";
+    for (int p = 0; p < players; p++)
+    {
+        out << "player " << p + 1 << " wins " << wins[p] << ", ";
+    }
+    out << "draws " << wins[PLAYER_NONE] << "\n";
+    out << fixed << setprecision(3) << moveCount << " moves: think time mean " << total / max(1, moveCount) << " s, max "
+        << slowest << " s; depth mean " << setprecision(1) << depths / max(1, moveCount) << ", max " << maxDepth
+        << "; searched to the end " << 100.0 * exact / max(1, moveCount) << "%; " << setprecision(2)
+        << nodes / max(total, 1e-9) / 1e6 << " M positions/s" << defaultfloat << "\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MULTIPLAYER_H
+#define MULTIPLAYER_H
+
+// More than two players =======================================================
+/**
+ * Partite a tre giocatori (X, O, +) sulle stesse scacchiere: vince il primo
+ * che completa una linea. Il risolutore esatto è per due giocatori (vincere,
+ * perdere, pareggiare), qui ogni posizione ha invece un punteggio per ogni
+ * giocatore, a somma costante: la ricerca max^n sceglie in ogni nodo la
+ * mossa migliore per chi muove, con il taglio superficiale (il giocatore
+ * che muove ha già un punteggio che lascia al giocatore precedente meno di
+ * quanto questi ha altrove). La ricerca è ad approfondimento iterativo, con
+ * una tabella delle trasposizioni per thread, entro il tempo del risolutore.
+ */
+
+/**
+ * @brief what a search found
+ *
+ */
+struct multiplayer_search_info
+{
+    int depth;                ///< moves searched (the last search completed)
+    bool exact;               ///< the search reached the end of every line of play
+    unsigned long long nodes; ///< positions searched
+    double seconds;           ///< time spent
+};
+
+/**
+ * @brief Get the move of the player to move (the game not over, more than two players)
+ *
+ * @return square the cell
+ */
+square multiplayerMove(const game &);
+
+/**
+ * @brief Analyze every move of the player to move (more than two players)
+ *
+ * A move is winning if the player to move wins (every player choosing the
+ * moves best for their own score), losing if another player does.
+ *
+ * @param values    by cell, set for the allowed moves only
+ * @return int the number of moves analyzed (0 if the game is over)
+ */
+int analyzeMultiplayerMoves(const game &, move_value values[]);
+
+/**
+ * @brief Play computer games of more than two players and report the searches
+ *
+ * @param games     games played
+ * @param dim       board dimension
+ * @param players   players of a game
+ * @param seconds   per move
+ * @return int the exit code
+ */
+int runMultiplayerBench(std::ostream &, int games, int dim, int players, double seconds);
+
+#endif
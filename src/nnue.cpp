@@ -0,0 +1,836 @@
+#ifndef NNUE_CPP
+#define NNUE_CPP
+
+#include "nnue.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#define NNUE_MAGIC "TTTNNUE"     ///< network file signature
+#define NNUE_VERSION 1           ///< network file format version
+#define NNUE_FEATURE_LIMIT 2.0f  ///< max first layer weight (16 pieces stay within int16)
+#define NNUE_LAYER_LIMIT 1.98f   ///< max second and output layer weight (within int8)
+#define NNUE_LEARNING_RATE 0.01f ///< initial training step
+#define NNUE_VALIDATION 10       ///< percent of the positions kept for validation
+#define NNUE_BENCH_GAMES 4096    ///< random games of the evaluation benchmark
+#define NNUE_BENCH_OPENING 2     ///< random moves before the engines play (bench games)
+
+nnue_network networks[MAX_DIM + 1]; ///< by board dimension (dim 0 = none)
+volatile int networkBenchSink;      ///< keeps the benchmark results alive
+
+/**
+ * @brief network file header (followed by the weights, as in nnue_network)
+ *
+ */
+struct nnue_header
+{
+    char magic[8];    ///< NNUE_MAGIC
+    uint32_t version; ///< NNUE_VERSION
+    uint32_t dim;     ///< board dimension
+    uint64_t rulesId; ///< rules the network was trained for
+};
+
+// the kernels, for processors with AVX2 and for any processor
+
+/**
+ * @brief add a feature row to an accumulator (any processor)
+ *
+ */
+void nnueAddPortable(const int16_t from[], const int16_t row[], int16_t to[])
+{
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        to[i] = from[i] + row[i];
+    }
+}
+
+/**
+ * @brief the layers after the accumulator (any processor)
+ *
+ * @param mine  the accumulator of the player to move
+ * @param other the accumulator of the other player
+ * @return int the value for the player to move
+ */
+int nnueForwardPortable(const nnue_network &n, const int16_t mine[], const int16_t other[])
+{
+    uint8_t input[2 * NNUE_HIDDEN];
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+    {
+        input[i] = min(max(int(mine[i]), 0), NNUE_ACTIVATION);
+        input[NNUE_HIDDEN + i] = min(max(int(other[i]), 0), NNUE_ACTIVATION);
+    }
+    int32_t out = n.outBias;
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        int32_t sum = n.bias[o];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++)
+        {
+            sum += input[i] * n.weights[o][i];
+        }
+        out += min(max(sum >> NNUE_WEIGHT_SHIFT, 0), NNUE_ACTIVATION) * n.outWeights[o];
+    }
+    return out * NNUE_UNIT / (NNUE_ACTIVATION * NNUE_WEIGHT_SCALE);
+}
+
+__attribute__((target("avx2"))) void nnueAddAvx2(const int16_t from[], const int16_t row[], int16_t to[])
+{
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i sum = _mm256_add_epi16(_mm256_load_si256((const __m256i *)(from + i)), _mm256_load_si256((const __m256i *)(row + i)));
+        _mm256_store_si256((__m256i *)(to + i), sum);
+    }
+}
+
+__attribute__((target("avx2"))) int nnueForwardAvx2(const nnue_network &n, const int16_t mine[], const int16_t other[])
+{
+    // clipped activations, int16 to uint8 (the pack works by 128-bit lane: the permute restores the order)
+    const __m256i top = _mm256_set1_epi8(NNUE_ACTIVATION), ones = _mm256_set1_epi16(1);
+    const int16_t *halves[2] = {mine, other};
+    __m256i input[2];
+    for (int h = 0; h < 2; h++)
+    {
+        __m256i packed = _mm256_packus_epi16(_mm256_load_si256((const __m256i *)halves[h]),
+                                             _mm256_load_si256((const __m256i *)(halves[h] + 16)));
+        input[h] = _mm256_min_epu8(_mm256_permute4x64_epi64(packed, 0xD8), top);
+    }
+    // second layer: 4 outputs at a time, u8 x i8 products summed in pairs (no saturation: 2 * 127 * 128 < 32768)
+    alignas(32) int32_t hidden[NNUE_L1];
+    for (int o = 0; o < NNUE_L1; o += 4)
+    {
+        __m256i sums[4];
+        for (int k = 0; k < 4; k++)
+        {
+            __m256i p0 = _mm256_maddubs_epi16(input[0], _mm256_load_si256((const __m256i *)n.weights[o + k]));
+            __m256i p1 = _mm256_maddubs_epi16(input[1], _mm256_load_si256((const __m256i *)(n.weights[o + k] + 32)));
+            sums[k] = _mm256_add_epi32(_mm256_madd_epi16(p0, ones), _mm256_madd_epi16(p1, ones));
+        }
+        __m256i quad = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]), _mm256_hadd_epi32(sums[2], sums[3]));
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(quad), _mm256_extracti128_si256(quad, 1));
+        total = _mm_srai_epi32(_mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(n.bias + o))), NNUE_WEIGHT_SHIFT);
+        total = _mm_min_epi32(_mm_max_epi32(total, _mm_setzero_si128()), _mm_set1_epi32(NNUE_ACTIVATION));
+        _mm_store_si128((__m128i *)(hidden + o), total);
+    }
+    // output layer
+    __m256i out = _mm256_setzero_si256();
+    for (int o = 0; o < NNUE_L1; o += 8)
+    {
+        __m256i w = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(n.outWeights + o)));
+        out = _mm256_add_epi32(out, _mm256_mullo_epi32(_mm256_load_si256((const __m256i *)(hidden + o)), w));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return (n.outBias + _mm_cvtsi128_si32(half)) * NNUE_UNIT / (NNUE_ACTIVATION * NNUE_WEIGHT_SCALE);
+}
+
+/**
+ * @brief the network kernels of a processor
+ *
+ */
+struct nnue_kernels
+{
+    const char *name;                                                       ///< instruction set
+    void (*add)(const int16_t[], const int16_t[], int16_t[]);               ///< see nnueAddPortable
+    int (*forward)(const nnue_network &, const int16_t[], const int16_t[]); ///< see nnueForwardPortable
+};
+
+const nnue_kernels NNUE_AVX2{"AVX2", nnueAddAvx2, nnueForwardAvx2};
+const nnue_kernels NNUE_PORTABLE{"portable", nnueAddPortable, nnueForwardPortable};
+
+/**
+ * @brief the kernels for this processor
+ *
+ */
+const nnue_kernels &getNetworkKernels()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? NNUE_AVX2 : NNUE_PORTABLE;
+}
+
+/**
+ * @brief compute an accumulator from scratch, with given kernels
+ *
+ */
+void refreshWith(const nnue_kernels &k, const nnue_network &n, const uint32_t done[2], nnue_accumulator &a)
+{
+    for (int p = 0; p < 2; p++)
+    {
+        memcpy(a.values[p], n.featureBias, sizeof(n.featureBias));
+        for (uint32_t m = done[p]; m != 0; m &= m - 1)
+        {
+            k.add(a.values[p], n.features[__builtin_ctz(m)], a.values[p]);
+        }
+        for (uint32_t m = done[1 - p]; m != 0; m &= m - 1)
+        {
+            k.add(a.values[p], n.features[NNUE_CELLS + __builtin_ctz(m)], a.values[p]);
+        }
+    }
+}
+
+/**
+ * @brief update an accumulator for a piece placed, with given kernels
+ *
+ */
+inline void addPieceWith(const nnue_kernels &k, const nnue_network &n, const nnue_accumulator &from, nnue_accumulator &to,
+                         int p, int cell)
+{
+    k.add(from.values[p], n.features[cell], to.values[p]);
+    k.add(from.values[1 - p], n.features[NNUE_CELLS + cell], to.values[1 - p]);
+}
+
+/**
+ * @brief Get the network of a board dimension
+ *
+ * @return const nnue_network* the network (nullptr if none was loaded)
+ */
+const nnue_network *getNetwork(int dim)
+{
+    return dim >= MIN_DIM && dim <= MAX_DIM && networks[dim].dim == dim ? &networks[dim] : nullptr;
+}
+
+/**
+ * @brief the network file of a board dimension
+ *
+ */
+string networkPath(const char prefix[], int dim)
+{
+    return string(prefix) + to_string(dim) + "x" + to_string(dim) + ".bin";
+}
+
+/**
+ * @brief Load the networks (before the first game)
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ */
+void loadNetworks(const char prefix[])
+{
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        ifstream in(networkPath(prefix, dim), ios::binary);
+        nnue_header h{};
+        if (!in.read((char *)&h, sizeof(h)) || memcmp(h.magic, NNUE_MAGIC, sizeof(h.magic)) != 0 ||
+            h.version != NNUE_VERSION || h.dim != unsigned(dim) || h.rulesId != rulesId(getRules(dim)))
+        {
+            continue;
+        }
+        nnue_network &n = networks[dim];
+        if (in.read((char *)n.features, sizeof(n.features)) && in.read((char *)n.featureBias, sizeof(n.featureBias)) &&
+            in.read((char *)n.weights, sizeof(n.weights)) && in.read((char *)n.bias, sizeof(n.bias)) &&
+            in.read((char *)n.outWeights, sizeof(n.outWeights)) && in.read((char *)&n.outBias, sizeof(n.outBias)))
+        {
+            n.dim = dim;
+        }
+    }
+}
+
+/**
+ * @brief Compute the accumulator of a position from scratch
+ *
+ * @param done  the cells of the two players
+ */
+void nnueRefresh(const nnue_network &n, const uint32_t done[2], nnue_accumulator &a)
+{
+    refreshWith(getNetworkKernels(), n, done, a);
+}
+
+/**
+ * @brief Update the accumulator for a piece placed
+ *
+ * @param from  the accumulator before the piece
+ * @param to    set: the accumulator after the piece
+ * @param p     the player of the piece (0 or 1, as in nnueRefresh)
+ * @param cell  the cell
+ */
+void nnueAddPiece(const nnue_network &n, const nnue_accumulator &from, nnue_accumulator &to, int p, int cell)
+{
+    addPieceWith(getNetworkKernels(), n, from, to, p, cell);
+}
+
+/**
+ * @brief Evaluate a position (not over)
+ *
+ * @param p the player to move (0 or 1, as in nnueRefresh)
+ * @return int the value for the player to move (NNUE_UNIT = sure win)
+ */
+int nnueEvaluate(const nnue_network &n, const nnue_accumulator &a, int p)
+{
+    return getNetworkKernels().forward(n, a.values[p], a.values[1 - p]);
+}
+
+// Training ====================================================================
+
+/**
+ * @brief the weights of a network being trained (the meaning of nnue_network, unscaled)
+ *
+ */
+struct float_network
+{
+    float features[NNUE_INPUTS][NNUE_HIDDEN]; ///< first layer
+    float featureBias[NNUE_HIDDEN];           ///< first layer biases
+    float weights[NNUE_L1][2 * NNUE_HIDDEN];  ///< second layer (the player to move first)
+    float bias[NNUE_L1];                      ///< second layer biases
+    float outWeights[NNUE_L1];                ///< output layer
+    float outBias;                            ///< output bias
+};
+
+/**
+ * @brief the activations of a position (for the gradients)
+ *
+ */
+struct float_activations
+{
+    float accumulators[2][NNUE_HIDDEN]; ///< first layer, before clipping (the player to move first)
+    float input[2 * NNUE_HIDDEN];       ///< first layer, clipped
+    float sums[NNUE_L1];                ///< second layer, before clipping
+    float hidden[NNUE_L1];              ///< second layer, clipped
+    float output;                       ///< the network output (the value is its tanh)
+};
+
+/**
+ * @brief a training position (the player to move first)
+ *
+ */
+struct training_position
+{
+    moves mine, other; ///< the cells of the player to move and of the other
+    float target;      ///< the mean result for the player to move (1 win, 0 draw, -1 loss)
+};
+
+/**
+ * @brief the network output of a position
+ *
+ */
+float floatForward(const float_network &n, const training_position &t, float_activations &a)
+{
+    const moves done[2] = {t.mine, t.other};
+    for (int p = 0; p < 2; p++)
+    {
+        float *acc = a.accumulators[p];
+        copy(n.featureBias, n.featureBias + NNUE_HIDDEN, acc);
+        for (int side = 0; side < 2; side++)
+        {
+            for (moves m = done[p ^ side]; m != 0; m &= m - 1)
+            {
+                const float *row = n.features[side * NNUE_CELLS + __builtin_ctz(m)];
+                for (int j = 0; j < NNUE_HIDDEN; j++)
+                {
+                    acc[j] += row[j];
+                }
+            }
+        }
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            a.input[p * NNUE_HIDDEN + j] = min(max(acc[j], 0.0f), 1.0f);
+        }
+    }
+    a.output = n.outBias;
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        float sum = n.bias[o];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++)
+        {
+            sum += n.weights[o][i] * a.input[i];
+        }
+        a.sums[o] = sum;
+        a.hidden[o] = min(max(sum, 0.0f), 1.0f);
+        a.output += n.outWeights[o] * a.hidden[o];
+    }
+    return a.output;
+}
+
+/**
+ * @brief one gradient step on a position (squared error of the tanh of the output)
+ *
+ * @return float the squared error
+ */
+float floatStep(float_network &n, const training_position &t, float rate)
+{
+    float_activations a;
+    float value = tanh(floatForward(n, t, a)), error = value - t.target;
+    float dOutput = 2 * error * (1 - value * value) * rate, dInput[2 * NNUE_HIDDEN]{};
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        float dSum = a.sums[o] > 0 && a.sums[o] < 1 ? dOutput * n.outWeights[o] : 0;
+        n.outWeights[o] = min(max(n.outWeights[o] - dOutput * a.hidden[o], -NNUE_LAYER_LIMIT), NNUE_LAYER_LIMIT);
+        if (dSum != 0)
+        {
+            for (int i = 0; i < 2 * NNUE_HIDDEN; i++)
+            {
+                dInput[i] += dSum * n.weights[o][i];
+                n.weights[o][i] = min(max(n.weights[o][i] - dSum * a.input[i], -NNUE_LAYER_LIMIT), NNUE_LAYER_LIMIT);
+            }
+            n.bias[o] -= dSum;
+        }
+    }
+    n.outBias -= dOutput;
+    const moves done[2] = {t.mine, t.other};
+    for (int p = 0; p < 2; p++)
+    {
+        float dAcc[NNUE_HIDDEN];
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            float acc = a.accumulators[p][j];
+            dAcc[j] = acc > 0 && acc < 1 ? dInput[p * NNUE_HIDDEN + j] : 0;
+            n.featureBias[j] -= dAcc[j];
+        }
+        for (int side = 0; side < 2; side++)
+        {
+            for (moves m = done[p ^ side]; m != 0; m &= m - 1)
+            {
+                float *row = n.features[side * NNUE_CELLS + __builtin_ctz(m)];
+                for (int j = 0; j < NNUE_HIDDEN; j++)
+                {
+                    row[j] = min(max(row[j] - dAcc[j], -NNUE_FEATURE_LIMIT), NNUE_FEATURE_LIMIT);
+                }
+            }
+        }
+    }
+    return error * error;
+}
+
+/**
+ * @brief the fixed point weights of a trained network
+ *
+ */
+void quantizeNetwork(const float_network &f, int dim, nnue_network &n)
+{
+    auto scaled = [](float value, float scale, float limit) { return lround(min(max(value * scale, -limit), limit)); };
+    const float wide = NNUE_ACTIVATION * NNUE_WEIGHT_SCALE;
+    n.dim = dim;
+    for (int i = 0; i < NNUE_INPUTS; i++)
+    {
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+        {
+            n.features[i][j] = scaled(f.features[i][j], NNUE_ACTIVATION, INT16_MAX);
+        }
+    }
+    for (int j = 0; j < NNUE_HIDDEN; j++)
+    {
+        n.featureBias[j] = scaled(f.featureBias[j], NNUE_ACTIVATION, INT16_MAX);
+    }
+    for (int o = 0; o < NNUE_L1; o++)
+    {
+        for (int i = 0; i < 2 * NNUE_HIDDEN; i++)
+        {
+            n.weights[o][i] = scaled(f.weights[o][i], NNUE_WEIGHT_SCALE, INT8_MAX);
+        }
+        n.bias[o] = scaled(f.bias[o], wide, INT32_MAX / 2);
+        n.outWeights[o] = scaled(f.outWeights[o], NNUE_WEIGHT_SCALE, INT8_MAX);
+    }
+    n.outBias = scaled(f.outBias, wide, INT32_MAX / 2);
+}
+
+/**
+ * @brief the positions of the recorded games of a board dimension, with their symmetric images
+ *
+ * @return vector<training_position> every position once, with its mean result
+ */
+vector<training_position> trainingPositions(const char path[], const rules &r, size_t &games)
+{
+    unordered_map<uint64_t, pair<float, int>> results; // by position: sum of the results, count
+    record_reader rd;
+    games = 0;
+    if (!openGameRecords(rd, path))
+    {
+        return {};
+    }
+    game_record g;
+    size_t offset;
+    while (nextGameRecord(rd, g, offset))
+    {
+        if (g.dim != r.dim || g.numPlayers != NUM_PLAYERS || g.timeout || g.first >= NUM_PLAYERS)
+        {
+            continue;
+        }
+        games++;
+        moves done[NUM_PLAYERS] = {0, 0};
+        int turn = g.first;
+        for (int k = 0; k < g.numMoves && g.moves[k] < r.numCells; k++, turn = 1 - turn)
+        {
+            float result = g.winner == RECORD_NO_WINNER ? 0 : g.winner == turn ? 1 : -1;
+            for (int t = 0; t < NUM_SYMMETRIES; t++)
+            {
+                moves image[NUM_PLAYERS] = {0, 0};
+                for (int p = 0; p < NUM_PLAYERS; p++)
+                {
+                    for (moves m = done[p]; m != 0; m &= m - 1)
+                    {
+                        image[p] |= 1u << symmetricCell(r.symmetries, t, __builtin_ctz(m));
+                    }
+                }
+                auto &entry = results[image[turn] | uint64_t(image[1 - turn]) << 32];
+                entry.first += result;
+                entry.second++;
+            }
+            done[turn] |= 1u << g.moves[k];
+        }
+    }
+    closeGameRecords(rd);
+    vector<training_position> positions;
+    positions.reserve(results.size());
+    for (const auto &entry : results)
+    {
+        positions.push_back({moves(entry.first), moves(entry.first >> 32), entry.second.first / entry.second.second});
+    }
+    sort(positions.begin(), positions.end(), [](const training_position &a, const training_position &b) {
+        return a.mine != b.mine ? a.mine < b.mine : a.other < b.other;
+    }); // the same order on every run
+    return positions;
+}
+
+/**
+ * @brief Train the network of a board dimension on the recorded games, and save it
+ *
+ * Every position of the two-player games is labeled by the result for the
+ * player to move; the board symmetries multiply the positions.
+ *
+ * @param records   the records file
+ * @param prefix    the network files prefix
+ * @param dim       board dimension
+ * @param epochs    passes over the positions
+ * @return int the exit code
+ */
+int trainNetwork(const char records[], const char prefix[], int dim, int epochs)
+{
+    if (dim < MIN_DIM || dim > MAX_DIM)
+    {
+        cerr << "Invalid board dimension " << dim << endl;
+        return 1;
+    }
+    const rules &r = getRules(dim);
+    TimePoint start = theClock.now();
+    size_t games;
+    vector<training_position> positions = trainingPositions(records, r, games);
+    if (positions.empty())
+    {
+        cerr << "No " << dim << "x" << dim << " games in " << records << endl;
+        return 1;
+    }
+    // a fixed part of the positions for validation
+    mt19937 rng(1);
+    shuffle(positions.begin(), positions.end(), rng);
+    size_t validation = positions.size() * NNUE_VALIDATION / 100;
+    vector<training_position> tests(positions.end() - validation, positions.end());
+    positions.resize(positions.size() - validation);
+    cout << games << " games, " << positions.size() << " training and " << tests.size() << " validation positions\n";
+    // small random weights, the first layer mostly active
+    static float_network f;
+    uniform_real_distribution<float> unit(-1, 1);
+    for (auto &row : f.features)
+    {
+        for (float &w : row)
+        {
+            w = 0.25f * unit(rng);
+        }
+    }
+    fill(begin(f.featureBias), end(f.featureBias), 0.5f);
+    for (auto &row : f.weights)
+    {
+        for (float &w : row)
+        {
+            w = unit(rng) / sqrt(2.0f * NNUE_HIDDEN);
+        }
+    }
+    fill(begin(f.bias), end(f.bias), 0.1f);
+    for (float &w : f.outWeights)
+    {
+        w = unit(rng) / sqrt(float(NNUE_L1));
+    }
+    f.outBias = 0;
+    auto validate = [&tests](const float_network &n, double &agreement) {
+        double loss = 0;
+        size_t decisive = 0, right = 0;
+        for (const training_position &t : tests)
+        {
+            float_activations a;
+            float value = tanh(floatForward(n, t, a));
+            loss += (value - t.target) * (value - t.target);
+            if (fabs(t.target) > 0.5f)
+            {
+                decisive++;
+                right += (value > 0) == (t.target > 0);
+            }
+        }
+        agreement = decisive > 0 ? 100.0 * right / decisive : 0;
+        return tests.empty() ? 0 : loss / tests.size();
+    };
+    cout << "epoch   training loss   validation loss   decisive results predicted\n";
+    for (int epoch = 1; epoch <= epochs; epoch++)
+    {
+        shuffle(positions.begin(), positions.end(), rng);
+        float rate = NNUE_LEARNING_RATE / (1 + 4.0f * (epoch - 1) / max(1, epochs));
+        double loss = 0, agreement;
+        for (const training_position &t : positions)
+        {
+            loss += floatStep(f, t, rate);
+        }
+        double tested = validate(f, agreement);
+        cout << fixed << setprecision(4) << setw(5) << epoch << setw(16) << loss / positions.size() << setw(18) << tested
+             << setprecision(1) << setw(28) << agreement << "%" << defaultfloat << endl;
+    }
+    // the fixed point network, and how far it is from the trained one
+    nnue_network &n = networks[dim];
+    quantizeNetwork(f, dim, n);
+    double difference = 0;
+    for (const training_position &t : tests)
+    {
+        float_activations a;
+        nnue_accumulator acc;
+        const uint32_t done[2] = {t.mine, t.other};
+        refreshWith(NNUE_PORTABLE, n, done, acc);
+        difference += fabs(floatForward(f, t, a) * NNUE_UNIT - NNUE_PORTABLE.forward(n, acc.values[0], acc.values[1]));
+    }
+    cout << "Fixed point vs trained output: " << fixed << setprecision(1) << difference / max(size_t(1), tests.size())
+         << " (mean, unit " << NNUE_UNIT << ")" << defaultfloat << endl;
+    string path = networkPath(prefix, dim);
+    ofstream out(path, ios::binary);
+    nnue_header h{};
+    memcpy(h.magic, NNUE_MAGIC, sizeof(h.magic));
+    h.version = NNUE_VERSION;
+    h.dim = dim;
+    h.rulesId = rulesId(r);
+    out.write((const char *)&h, sizeof(h));
+    out.write((const char *)n.features, sizeof(n.features));
+    out.write((const char *)n.featureBias, sizeof(n.featureBias));
+    out.write((const char *)n.weights, sizeof(n.weights));
+    out.write((const char *)n.bias, sizeof(n.bias));
+    out.write((const char *)n.outWeights, sizeof(n.outWeights));
+    out.write((const char *)&n.outBias, sizeof(n.outBias));
+    if (!out.flush())
+    {
+        cerr << "Cannot write " << path << endl;
+        return 1;
+    }
+    cout << "Network written to " << path << " in " << fixed << setprecision(1) << Duration(theClock.now() - start).count()
+         << " s" << defaultfloat << endl;
+    return 0;
+}
+
+// Benchmark ===================================================================
+
+/**
+ * @brief time the evaluation of every position of random games
+ *
+ * @param evaluate  evaluates the positions of a game (returns their sum)
+ * @return double millions of evaluations per second
+ */
+template <typename F>
+double benchNetwork(const vector<vector<int>> &games, double seconds, F evaluate)
+{
+    unsigned long long done = 0;
+    int sum = 0;
+    TimePoint start = theClock.now();
+    double elapsed;
+    do
+    {
+        for (const vector<int> &g : games)
+        {
+            sum += evaluate(g);
+            done += g.size();
+        }
+        elapsed = Duration(theClock.now() - start).count();
+    } while (elapsed < seconds);
+    networkBenchSink = sum;
+    return done / elapsed / 1e6;
+}
+
+/**
+ * @brief Benchmark the network: evaluations per second (AVX2, portable, from scratch)
+ * and games of the nnue engine against the alphabeta engine at equal time
+ *
+ * @param games     games played (half with each symbol)
+ * @param dim       board dimension (a network must be loaded)
+ * @param seconds   per move
+ * @return int the exit code (not 0 if the kernels disagree)
+ */
+int runNetworkBench(int games, int dim, double seconds)
+{
+    const nnue_network *net = getNetwork(dim);
+    if (net == nullptr)
+    {
+        cerr << "No " << dim << "x" << dim << " network: train it first (main nnuetrain " << dim << ")" << endl;
+        return 1;
+    }
+    rules &r = getRules(dim);
+    mt19937 rng(1);
+    // random games, the moves before the end
+    vector<vector<int>> played(NNUE_BENCH_GAMES);
+    for (vector<int> &g : played)
+    {
+        moves done[2] = {0, 0};
+        for (int turn = 0; (done[0] | done[1]) != r.full; turn = 1 - turn)
+        {
+            int cell = randomCell(r.full & ~(done[0] | done[1]), rng);
+            done[turn] |= 1u << cell;
+            if (isWinning(r, done[turn]))
+            {
+                break;
+            }
+            g.push_back(cell);
+        }
+    }
+    // incremental = the evaluations after each piece, as in a search
+    auto incremental = [net](const nnue_kernels &k) {
+        return [net, &k](const vector<int> &g) {
+            nnue_accumulator a[2];
+            const uint32_t none[2] = {0, 0};
+            refreshWith(k, *net, none, a[0]);
+            int sum = 0;
+            for (size_t i = 0; i < g.size(); i++)
+            {
+                addPieceWith(k, *net, a[i & 1], a[(i + 1) & 1], i & 1, g[i]);
+                sum += k.forward(*net, a[(i + 1) & 1].values[(i + 1) & 1], a[(i + 1) & 1].values[i & 1]);
+            }
+            return sum;
+        };
+    };
+    auto fromScratch = [net](const vector<int> &g) {
+        uint32_t done[2] = {0, 0};
+        int sum = 0;
+        for (size_t i = 0; i < g.size(); i++)
+        {
+            done[i & 1] |= 1u << g[i];
+            nnue_accumulator a;
+            nnueRefresh(*net, done, a);
+            sum += nnueEvaluate(*net, a, (i + 1) & 1);
+        }
+        return sum;
+    };
+    auto lines = [&r](const vector<int> &g) {
+        moves done[2] = {0, 0};
+        int sum = 0;
+        for (size_t i = 0; i < g.size(); i++)
+        {
+            done[i & 1] |= 1u << g[i];
+            sum += evaluateConfig(r, done[(i + 1) & 1] | done[i & 1] << r.numCells);
+        }
+        return sum;
+    };
+    // every way gives the same values
+    bool avx2 = &getNetworkKernels() == &NNUE_AVX2;
+    long long errors = 0;
+    for (const vector<int> &g : played)
+    {
+        errors += incremental(NNUE_PORTABLE)(g) != fromScratch(g) || (avx2 && incremental(NNUE_AVX2)(g) != fromScratch(g));
+    }
+    cout << "Network " << dim << "x" << dim << ", AVX2 " << (avx2 ? "available" : "not available") << "\n";
+    cout << "Evaluations (million positions/s):\n";
+    cout << "  incremental AVX2   incremental portable   from scratch   lines (pext)\n";
+    double rates[4] = {};
+    if (avx2)
+    {
+        rates[0] = benchNetwork(played, 0.5, incremental(NNUE_AVX2));
+    }
+    rates[1] = benchNetwork(played, 0.5, incremental(NNUE_PORTABLE));
+    rates[2] = benchNetwork(played, 0.5, fromScratch);
+    rates[3] = benchNetwork(played, 0.5, lines);
+    cout << fixed << setprecision(1) << setw(19) << rates[0] << setw(23) << rates[1] << setw(15) << rates[2] << setw(15)
+         << rates[3] << defaultfloat << '\n'; // 0 = not available
+    // the two engines at equal time: the move of a side (0 = nnue, 1 = alphabeta)
+    unsigned long long evals[2] = {}, depths[2] = {}, searches[2] = {};
+    double elapsed[2] = {};
+    auto engineMove = [&](int side, moves mine, moves other) {
+        alphabeta_search s{r, false, theClock.now() + chrono::duration_cast<Clock::duration>(Duration(seconds)), false, 0, 0};
+        TimePoint moveStart = theClock.now();
+        int cell, depth, value;
+        if (side == 0)
+        {
+            network_leaf e(*net, mine, other);
+            cell = alphaBetaRoot(s, e, mine, other, depth, value);
+        }
+        else
+        {
+            line_leaf e{r};
+            cell = alphaBetaRoot(s, e, mine, other, depth, value);
+        }
+        elapsed[side] += Duration(theClock.now() - moveStart).count();
+        evals[side] += s.evals;
+        depths[side] += depth;
+        searches[side]++;
+        return cell;
+    };
+    // games from the same random openings
+    int wins = 0, draws = 0, losses = 0;
+    for (int i = 0; i < games; i++)
+    {
+        if (i % 2 == 0)
+        {
+            rng.seed(i / 2 + 1);
+        }
+        int networkPlayer = i % 2;
+        moves done[2] = {0, 0};
+        int turn = 0, winner = -1;
+        for (int ply = 0; winner < 0 && (done[0] | done[1]) != r.full; ply++, turn = 1 - turn)
+        {
+            int cell = ply < NNUE_BENCH_OPENING ? randomCell(r.full & ~(done[0] | done[1]), rng)
+                                                : engineMove(turn == networkPlayer ? 0 : 1, done[turn], done[1 - turn]);
+            done[turn] |= 1u << cell;
+            if (isWinning(r, done[turn]))
+            {
+                winner = turn;
+            }
+        }
+        wins += winner == networkPlayer;
+        losses += winner == 1 - networkPlayer;
+        draws += winner < 0;
+    }
+    // the moves of both engines in positions of the random games, against the solved outcomes
+    int positions = 0, winning = 0, mistakes[2] = {};
+    auto rank = [](outcome o) { return o == WINNING ? 2 : o == DRAW ? 1 : 0; };
+    for (size_t i = 0; i < played.size() && positions < games; i++)
+    {
+        const vector<int> &g = played[i];
+        size_t plies = NNUE_BENCH_OPENING + i % max(size_t(1), g.size() - min(g.size(), size_t(NNUE_BENCH_OPENING)));
+        if (plies >= g.size())
+        {
+            continue;
+        }
+        moves done[2] = {0, 0};
+        for (size_t k = 0; k < plies; k++)
+        {
+            done[k & 1] |= 1u << g[k];
+        }
+        moves mine = done[plies & 1], other = done[1 - (plies & 1)], all = mine | other;
+        config cfg = mine | other << r.numCells;
+        int best = 0;
+        for (moves m = r.full & ~all; m != 0; m &= m - 1)
+        {
+            best = max(best, rank(moveOutcome(r, cfg, all, __builtin_ctz(m))));
+        }
+        for (int side = 0; side < 2; side++)
+        {
+            mistakes[side] += rank(moveOutcome(r, cfg, all, engineMove(side, mine, other))) < best;
+        }
+        positions++;
+        winning += best == rank(WINNING);
+    }
+    double score = (wins + 0.5 * draws) / max(1, games);
+    cout << "nnue vs alphabeta at " << seconds << " s per move: " << games << " games (" << NNUE_BENCH_OPENING
+         << " random moves first, each opening with both symbols)\n";
+    cout << "  wins " << wins << ", draws " << draws << ", losses " << losses << ", score " << fixed << setprecision(1)
+         << 100 * score << "%";
+    if (wins != losses && score > 0 && score < 1)
+    {
+        cout << ", Elo " << showpos << -400 * log10(1 / score - 1) << noshowpos;
+    }
+    cout << "\n";
+    cout << "  moves worse than the solved best, in " << positions << " positions of random games (" << winning
+         << " with a win):\n";
+    const char *names[2] = {"nnue", "alphabeta"};
+    for (int side = 0; side < 2; side++)
+    {
+        cout << setw(11) << names[side] << ": " << setprecision(1) << 100.0 * mistakes[side] / max(1, positions)
+             << "% mistakes, mean depth " << double(depths[side]) / max(1ull, searches[side]) << ", " << setprecision(0)
+             << evals[side] / max(1e-9, elapsed[side]) / 1e3 << " k evaluations/s" << '\n';
+    }
+    cout << defaultfloat << (errors == 0 ? "All kernels agree" : "Kernels DISAGREE") << endl;
+    return errors == 0 ? 0 : 1;
+}
+
+#endif
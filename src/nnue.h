@@ -0,0 +1,116 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+// The neural evaluation =======================================================
+/**
+ * Una piccola rete neurale che stima il valore di una posizione (per chi
+ * muove) dalle celle dei due giocatori, addestrata con i risultati delle
+ * partite registrate. Come nelle reti NNUE degli scacchi il primo strato ha
+ * un accumulatore per ogni giocatore (le sue celle come "mie", quelle
+ * dell'altro come "sue"), aggiornato sommando una riga di pesi per ogni
+ * pedina posata invece di ricalcolarlo; gli strati successivi lavorano su
+ * interi a 8 bit, con istruzioni AVX2 se il processore le ha (altrimenti
+ * con le stesse operazioni intere, un elemento alla volta).
+ * Il motore "nnue" è la ricerca alfa-beta con la rete come valutazione.
+ */
+
+#include <cstdint>
+
+#define NNUE_CELLS 16                              ///< feature cells (the largest board)
+#define NNUE_INPUTS (2 * NNUE_CELLS)               ///< features: the cells of the perspective player, then of the other
+#define NNUE_HIDDEN 32                             ///< accumulator values per player
+#define NNUE_L1 32                                 ///< second layer outputs
+#define NNUE_ACTIVATION 127                        ///< activation 1.0 (clipped ReLU, 0 .. 1)
+#define NNUE_WEIGHT_SHIFT 6                        ///< weight 1.0 of the second and output layers (log2)
+#define NNUE_WEIGHT_SCALE (1 << NNUE_WEIGHT_SHIFT) ///< weight 1.0 of the second and output layers
+#define NNUE_UNIT 1000                             ///< evaluation of a sure win (output 1.0)
+
+/**
+ * @brief the quantized weights of a network (for a board dimension)
+ *
+ */
+struct nnue_network
+{
+    int dim{0};                                               ///< board dimension (0 = no network)
+    alignas(32) int16_t features[NNUE_INPUTS][NNUE_HIDDEN]{}; ///< first layer: a row per feature (scale NNUE_ACTIVATION)
+    alignas(32) int16_t featureBias[NNUE_HIDDEN]{};           ///< first layer biases
+    alignas(32) int8_t weights[NNUE_L1][2 * NNUE_HIDDEN]{};   ///< second layer (the player to move first)
+    int32_t bias[NNUE_L1]{};                                  ///< second layer biases (scale NNUE_ACTIVATION * NNUE_WEIGHT_SCALE)
+    alignas(32) int8_t outWeights[NNUE_L1]{};                 ///< output layer
+    int32_t outBias{0};                                       ///< output bias (scale NNUE_ACTIVATION * NNUE_WEIGHT_SCALE)
+};
+
+/**
+ * @brief the first layer of a position, from the perspective of each player
+ *
+ */
+struct nnue_accumulator
+{
+    alignas(32) int16_t values[2][NNUE_HIDDEN]; ///< by player (0 = the first player of the done cells)
+};
+
+/**
+ * @brief Get the network of a board dimension
+ *
+ * @return const nnue_network* the network (nullptr if none was loaded)
+ */
+const nnue_network *getNetwork(int dim);
+
+/**
+ * @brief Load the networks (before the first game)
+ *
+ * @param prefix    the files prefix (dimension and extension are appended)
+ */
+void loadNetworks(const char prefix[]);
+
+/**
+ * @brief Compute the accumulator of a position from scratch
+ *
+ * @param done  the cells of the two players
+ */
+void nnueRefresh(const nnue_network &, const uint32_t done[2], nnue_accumulator &);
+
+/**
+ * @brief Update the accumulator for a piece placed
+ *
+ * @param from  the accumulator before the piece
+ * @param to    set: the accumulator after the piece
+ * @param p     the player of the piece (0 or 1, as in nnueRefresh)
+ * @param cell  the cell
+ */
+void nnueAddPiece(const nnue_network &, const nnue_accumulator &from, nnue_accumulator &to, int p, int cell);
+
+/**
+ * @brief Evaluate a position (not over)
+ *
+ * @param p the player to move (0 or 1, as in nnueRefresh)
+ * @return int the value for the player to move (NNUE_UNIT = sure win)
+ */
+int nnueEvaluate(const nnue_network &, const nnue_accumulator &, int p);
+
+/**
+ * @brief Train the network of a board dimension on the recorded games, and save it
+ *
+ * Every position of the two-player games is labeled by the result for the
+ * player to move; the board symmetries multiply the positions.
+ *
+ * @param records   the records file
+ * @param prefix    the network files prefix
+ * @param dim       board dimension
+ * @param epochs    passes over the positions
+ * @return int the exit code
+ */
+int trainNetwork(const char records[], const char prefix[], int dim, int epochs);
+
+/**
+ * @brief Benchmark the network: evaluations per second (AVX2, portable, from scratch)
+ * and games of the nnue engine against the alphabeta engine at equal time
+ *
+ * @param games     games played (half with each symbol)
+ * @param dim       board dimension (a network must be loaded)
+ * @param seconds   per move
+ * @return int the exit code (not 0 if the kernels disagree)
+ */
+int runNetworkBench(int games, int dim, double seconds);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef PERFECT3_H
+#define PERFECT3_H
+
+// The 3x3 perfect play table ==================================================
+/**
+ * Tabella completa del gioco 3x3, calcolata dal compilatore (constexpr):
+ * per ogni posizione (3^9, indicizzata in base 3) l'esito per il giocatore
+ * di turno, l'insieme delle mosse ottime e la durata della partita con gioco
+ * perfetto. Durante la partita la mossa del computer è una semplice lettura,
+ * senza ricerca né inizializzazione.
+ */
+
+#include <cstdint>
+
+#define P3_CELLS 9                  ///< cells of the 3x3 board
+#define P3_POSITIONS 19683          ///< 3^9 positions (unreachable ones included)
+#define P3_MOVES_MASK 0x1FFu        ///< entry bits: optimal moves
+#define P3_OUTCOME_SHIFT 9          ///< entry bits: outcome (as enum outcome)
+#define P3_SOLVED (1u << 11)        ///< entry bit: computed (generation only)
+#define P3_DISTANCE_SHIFT 12        ///< entry bits: moves to the end (the winner hurries, the loser delays)
+#define P3_WINNING 0                ///< player to move wins
+#define P3_LOSING 1                 ///< player to move loses
+#define P3_DRAW 2                   ///< nobody wins
+
+/**
+ * @brief outcome and optimal moves of every 3x3 position
+ *
+ */
+struct perfect3_table
+{
+    uint16_t base3[1 << P3_CELLS];  ///< index contribution of a moves bitmap
+    uint16_t entries[P3_POSITIONS]; ///< optimal moves | outcome << P3_OUTCOME_SHIFT | distance << P3_DISTANCE_SHIFT
+};
+
+/**
+ * @brief whether some moves contain a line of the 3x3 board
+ *
+ */
+constexpr bool perfect3Line(unsigned moves)
+{
+    constexpr unsigned lines[] = {0x007, 0x038, 0x1C0, 0x049, 0x092, 0x124, 0x111, 0x054};
+    for (unsigned line : lines)
+    {
+        if ((moves & line) == line)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief solve a position (and, recursively, its successors)
+ *
+ * @param mine  cells of the player to move
+ * @param other cells of the other player
+ * @return unsigned the outcome for the player to move
+ */
+constexpr unsigned perfect3Solve(perfect3_table &t, unsigned mine, unsigned other)
+{
+    uint16_t &entry = t.entries[t.base3[mine] + 2 * t.base3[other]];
+    if (entry & P3_SOLVED)
+    {
+        return (entry >> P3_OUTCOME_SHIFT) & 3;
+    }
+    unsigned result = P3_LOSING, best = 0, distance = 0;
+    if (perfect3Line(other))
+    {
+        result = P3_LOSING; // the last move won
+    }
+    else if ((mine | other) == P3_MOVES_MASK)
+    {
+        result = P3_DRAW;
+    }
+    else
+    {
+        for (unsigned cell = 0; cell < P3_CELLS; cell++)
+        {
+            unsigned value = 1u << cell;
+            if ((mine | other) & value)
+            {
+                continue;
+            }
+            // the outcome of the opponent after the move, reversed
+            unsigned reply = perfect3Solve(t, other, mine | value);
+            unsigned mineOutcome = reply == P3_WINNING ? P3_LOSING : reply == P3_LOSING ? P3_WINNING : P3_DRAW;
+            unsigned length = 1 + (t.entries[t.base3[other] + 2 * t.base3[mine | value]] >> P3_DISTANCE_SHIFT);
+            int rank[] = {2, 0, 1}; // WINNING > DRAW > LOSING
+            if (best == 0 || rank[mineOutcome] > rank[result])
+            {
+                result = mineOutcome;
+                best = value;
+                distance = length;
+            }
+            else if (mineOutcome == result)
+            {
+                best |= value;
+                if (result == P3_WINNING ? length < distance : length > distance)
+                {
+                    distance = length;
+                }
+            }
+        }
+    }
+    entry = uint16_t(best | result << P3_OUTCOME_SHIFT | P3_SOLVED | distance << P3_DISTANCE_SHIFT);
+    return result;
+}
+
+/**
+ * @brief build the table (at compile time)
+ *
+ */
+constexpr perfect3_table makePerfect3()
+{
+    perfect3_table t{};
+    for (unsigned moves = 0; moves < (1u << P3_CELLS); moves++)
+    {
+        unsigned power = 1;
+        for (unsigned cell = 0; cell < P3_CELLS; cell++, power *= 3)
+        {
+            if (moves & (1u << cell))
+            {
+                t.base3[moves] += power;
+            }
+        }
+    }
+    perfect3Solve(t, 0, 0);
+    return t;
+}
+
+constexpr perfect3_table PERFECT3 = makePerfect3(); ///< the 3x3 table
+
+static_assert(((PERFECT3.entries[0] >> P3_OUTCOME_SHIFT) & 3) == P3_DRAW, "3x3 is a draw");
+static_assert((PERFECT3.entries[0] & P3_MOVES_MASK) == P3_MOVES_MASK, "every first move draws");
+static_assert((PERFECT3.entries[0] >> P3_DISTANCE_SHIFT) == P3_CELLS, "draws fill the board");
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef POSINDEX_CPP
+#define POSINDEX_CPP
+
+#include "posindex.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#define INDEX_MAGIC "TTTINDEX" ///< index file signature (no terminator)
+#define INDEX_VERSION 1        ///< index file format version
+#define INDEX_NONE 255         ///< no next move / nobody to move (ended game)
+#define INDEX_SAMPLE_GAMES 10  ///< game offsets shown by a query
+
+/**
+ * @brief index file header (followed by the entries, sorted)
+ *
+ */
+struct index_header
+{
+    char magic[8];        ///< INDEX_MAGIC
+    uint32_t version;     ///< INDEX_VERSION
+    uint32_t unused;      ///< padding
+    uint64_t entries;     ///< number of entries
+    uint64_t recordBytes; ///< size of the records file indexed
+};
+
+/**
+ * @brief a position reached in a game
+ *
+ */
+struct index_entry
+{
+    uint32_t position; ///< canonical board: X cells, then O cells
+    uint8_t dim;       ///< board dimension
+    uint8_t turn;      ///< player to move (INDEX_NONE if the game ended)
+    uint8_t next;      ///< next move, as a cell of the canonical board (INDEX_NONE if ended)
+    uint8_t winner;    ///< game winner (RECORD_NO_WINNER = draw)
+    uint64_t game;     ///< offset of the game record in the records file
+};
+
+/**
+ * @brief index order: position (with dimension and turn), then game
+ *
+ */
+inline bool operator<(const index_entry &a, const index_entry &b)
+{
+    if (a.dim != b.dim)
+    {
+        return a.dim < b.dim;
+    }
+    if (a.position != b.position)
+    {
+        return a.position < b.position;
+    }
+    if (a.turn != b.turn)
+    {
+        return a.turn < b.turn;
+    }
+    return a.game < b.game;
+}
+
+/**
+ * @brief Build the index of a records file
+ *
+ * @param records   the records file
+ * @param index     the index file
+ * @return int the exit code
+ */
+int buildPositionIndex(const char records[], const char index[])
+{
+    record_reader rd;
+    if (!openGameRecords(rd, records))
+    {
+        cerr << "Not a records file: " << records << endl;
+        return 1;
+    }
+    TimePoint start = theClock.now();
+    vector<index_entry> entries;
+    game_record r;
+    size_t offset, games = 0;
+    while (nextGameRecord(rd, r, offset))
+    {
+        if (r.dim < MIN_DIM || r.dim > MAX_DIM || r.numPlayers != 2)
+        {
+            continue;
+        }
+        games++;
+        const rules &rl = getRules(r.dim);
+        unsigned numCells = r.dim * r.dim;
+        uint32_t cells[2] = {0, 0};
+        unsigned turn = r.first;
+        for (int ply = 0; ply <= r.numMoves; ply++)
+        {
+            index_entry e;
+            e.position = cells[0] | cells[1] << numCells;
+            int t = canonicalFrame(rl, e.position, e.position);
+            e.dim = r.dim;
+            e.turn = ply < r.numMoves ? turn : INDEX_NONE;
+            e.next = ply < r.numMoves ? symmetricCell(rl.symmetries, t, r.moves[ply]) : INDEX_NONE;
+            e.winner = r.winner;
+            e.game = offset;
+            entries.push_back(e);
+            if (ply < r.numMoves)
+            {
+                cells[turn] |= 1u << r.moves[ply];
+                turn = 1 - turn;
+            }
+        }
+    }
+    size_t recordBytes = rd.size;
+    closeGameRecords(rd);
+    sort(entries.begin(), entries.end());
+    index_header h{};
+    memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+    h.version = INDEX_VERSION;
+    h.entries = entries.size();
+    h.recordBytes = recordBytes;
+    ofstream out(index, ios::binary);
+    out.write((const char *)&h, sizeof(h));
+    out.write((const char *)entries.data(), entries.size() * sizeof(index_entry));
+    if (!out.flush())
+    {
+        cerr << "Cannot write " << index << endl;
+        return 1;
+    }
+    cout << games << " games, " << entries.size() << " positions (" << (sizeof(h) + entries.size() * sizeof(index_entry)) / 1024
+         << " KB) indexed in " << fixed << setprecision(2) << Duration(theClock.now() - start).count() << " s"
+         << defaultfloat << endl;
+    return 0;
+}
+
+/**
+ * @brief Answer a position query
+ *
+ * @param index     the index file
+ * @param board     the cells by rows: X, O or . (such as "X...O..........." for 4x4)
+ * @param turn      the player to move (X, O, or anything else for both)
+ * @return int the exit code
+ */
+int queryPositionIndex(std::ostream &out, const char index[], const char board[], char turn)
+{
+    int dim = MIN_DIM;
+    while (dim <= MAX_DIM && size_t(dim * dim) != strlen(board))
+    {
+        dim++;
+    }
+    if (dim > MAX_DIM)
+    {
+        out << "The board must have 9 or 16 cells (X, O or .)\n";
+        return 1;
+    }
+    TimePoint start = theClock.now();
+    int fd = open(index, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(index_header))
+    {
+        out << "Not an index file: " << index << '\n';
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        out << "Cannot map " << index << '\n';
+        return 1;
+    }
+    const index_header &h = *(const index_header *)p;
+    if (memcmp(h.magic, INDEX_MAGIC, sizeof(h.magic)) != 0 || h.version != INDEX_VERSION ||
+        sizeof(h) + h.entries * sizeof(index_entry) > size_t(st.st_size))
+    {
+        out << "Not an index file: " << index << '\n';
+        munmap(p, st.st_size);
+        return 1;
+    }
+    const index_entry *first = (const index_entry *)(&h + 1), *last = first + h.entries;
+    // the position, reduced as in the index
+    const rules &r = getRules(dim);
+    index_entry key{0, uint8_t(dim), 0, 0, 0, 0};
+    for (int cell = 0; cell < dim * dim; cell++)
+    {
+        char c = toupper(board[cell]);
+        key.position |= c == 'X' ? 1u << cell : c == 'O' ? 1u << (cell + dim * dim) : 0;
+    }
+    int t = canonicalFrame(r, key.position, key.position);
+    const index_entry *from = lower_bound(first, last, key), *to = from;
+    while (to < last && to->dim == key.dim && to->position == key.position)
+    {
+        to++;
+    }
+    // outcomes, overall and by next move (cells of the query board)
+    int wanted = toupper(turn) == 'X' ? 0 : toupper(turn) == 'O' ? 1 : -1;
+    unsigned long long count = 0, outcomes[3] = {};
+    map<int, array<unsigned long long, 3>> next;
+    vector<uint64_t> sample;
+    for (const index_entry *e = from; e < to; e++)
+    {
+        if (wanted >= 0 && e->turn != wanted)
+        {
+            continue;
+        }
+        int outcome = e->winner < 2 ? e->winner : 2;
+        count++;
+        outcomes[outcome]++;
+        if (e->next != INDEX_NONE)
+        {
+            next[fromCanonical(r, t, e->next) - r.minCell][outcome]++;
+        }
+        if (sample.size() < INDEX_SAMPLE_GAMES)
+        {
+            sample.push_back(e->game);
+        }
+    }
+    double elapsed = Duration(theClock.now() - start).count();
+    out << dim << "x" << dim << " position reached " << count << " times (of " << h.entries << " indexed) in "
+        << fixed << setprecision(3) << elapsed * 1000 << " ms\n";
+    if (count > 0)
+    {
+        out << setprecision(1) << "  X wins " << outcomes[0] << " (" << 100.0 * outcomes[0] / count << "%), O wins "
+            << outcomes[1] << " (" << 100.0 * outcomes[1] / count << "%), draws " << outcomes[2] << " ("
+            << 100.0 * outcomes[2] / count << "%)\n";
+        for (const auto &n : next)
+        {
+            out << "  next " << setw(2) << n.first << ": " << setw(8) << n.second[0] + n.second[1] + n.second[2]
+                << " (X " << n.second[0] << ", O " << n.second[1] << ", draws " << n.second[2] << ")\n";
+        }
+        out << "  games (record offsets):";
+        for (uint64_t game : sample)
+        {
+            out << ' ' << game;
+        }
+        out << '\n';
+    }
+    out << defaultfloat;
+    munmap(p, st.st_size);
+    return 0;
+}
+
+#endif
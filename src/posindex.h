@@ -0,0 +1,34 @@
+#ifndef POSINDEX_H
+#define POSINDEX_H
+
+// The position index ==========================================================
+/**
+ * Indice delle posizioni raggiunte nelle partite registrate: ogni posizione
+ * intermedia (ridotta per simmetria) è associata alla partita, al suo esito
+ * ed alla mossa successiva. Il file è ordinato per posizione, così una
+ * domanda ("quante volte è stata raggiunta e cosa è successo dopo") è una
+ * ricerca binaria sul file mappato in memoria, senza rileggere le partite.
+ */
+
+#include <ostream>
+
+/**
+ * @brief Build the index of a records file
+ *
+ * @param records   the records file
+ * @param index     the index file
+ * @return int the exit code
+ */
+int buildPositionIndex(const char records[], const char index[]);
+
+/**
+ * @brief Answer a position query
+ *
+ * @param index     the index file
+ * @param board     the cells by rows: X, O or . (such as "X...O..........." for 4x4)
+ * @param turn      the player to move (X, O, or anything else for both)
+ * @return int the exit code
+ */
+int queryPositionIndex(std::ostream &, const char index[], const char board[], char turn);
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef PROTOCOL_CPP
+#define PROTOCOL_CPP
+
+#include "protocol.h"
+#include <unistd.h>
+#include <cerrno>
+#include <string>
+#include <string_view>
+
+#define PROTOCOL_READ_SIZE (1 << 20)  ///< bytes per read
+#define PROTOCOL_FLUSH_SIZE (1 << 20) ///< pending output written at once
+
+/**
+ * @brief a position given to the protocol
+ *
+ */
+struct protocol_position
+{
+    rules *r{nullptr}; ///< the rules (by board dimension)
+    config cfg{0};     ///< player to move in the low half
+    moves all{0};      ///< occupied cells
+};
+
+/**
+ * @brief the protocol data
+ *
+ */
+struct protocol_state
+{
+    int in, out;              ///< file descriptors
+    string output;            ///< pending output
+    protocol_position current; ///< the last position set
+};
+
+/**
+ * @brief write all the pending output
+ *
+ * @return true if written
+ */
+bool flushProtocol(protocol_state &s)
+{
+    size_t done = 0;
+    while (done < s.output.size())
+    {
+        ssize_t n = write(s.out, s.output.data() + done, s.output.size() - done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        done += n;
+    }
+    s.output.clear();
+    return true;
+}
+
+/**
+ * @brief the next space separated word of a line
+ *
+ * @param line  the rest of the line (the word removed)
+ * @return string_view the word (empty at the end of the line)
+ */
+string_view nextWord(string_view &line)
+{
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == string_view::npos)
+    {
+        line = string_view();
+        return line;
+    }
+    size_t end = line.find_first_of(" \t\r", start);
+    string_view word = line.substr(start, end == string_view::npos ? string_view::npos : end - start);
+    line.remove_prefix(end == string_view::npos ? line.size() : end);
+    return word;
+}
+
+/**
+ * @brief parse a position: <board> [<turn>]
+ *
+ * @param line  the rest of the command line
+ * @param p     the position
+ * @return const char* the error, nullptr if parsed
+ */
+const char *parsePosition(string_view line, protocol_position &p)
+{
+    string_view board = nextWord(line), turn = nextWord(line);
+    int dim = MIN_DIM;
+    while (dim <= MAX_DIM && size_t(dim * dim) != board.size())
+    {
+        dim++;
+    }
+    if (dim > MAX_DIM)
+    {
+        return "board size";
+    }
+    moves cells[NUM_PLAYERS] = {0, 0};
+    for (int cell = 0; cell < dim * dim; cell++)
+    {
+        char c = board[cell];
+        if (c == 'X' || c == 'x')
+        {
+            cells[0] |= 1u << cell;
+        }
+        else if (c == 'O' || c == 'o')
+        {
+            cells[1] |= 1u << cell;
+        }
+        else if (c != '.')
+        {
+            return "board cell";
+        }
+    }
+    int count[NUM_PLAYERS] = {__builtin_popcount(cells[0]), __builtin_popcount(cells[1])};
+    player mover = count[0] <= count[1] ? 0 : 1;
+    if (turn == "X" || turn == "x")
+    {
+        mover = 0;
+    }
+    else if (turn == "O" || turn == "o")
+    {
+        mover = 1;
+    }
+    else if (!turn.empty())
+    {
+        return "turn";
+    }
+    rules &r = getRules(dim);
+    // the player to move has as many pieces as the other, or one less (the other moved first)
+    if ((count[mover] != count[1 - mover] && count[mover] + 1 != count[1 - mover]) || isWinning(r, cells[mover]))
+    {
+        return "unreachable position";
+    }
+    p.r = &r;
+    p.cfg = cells[mover] | cells[1 - mover] << r.numCells;
+    p.all = cells[0] | cells[1];
+    return nullptr;
+}
+
+/**
+ * @brief whether the game is over in a position
+ *
+ */
+bool positionOver(const protocol_position &p)
+{
+    return p.all == p.r->full || isWinning(*p.r, p.cfg >> p.r->numCells);
+}
+
+/**
+ * @brief the best move of a position (the game not over)
+ *
+ * @param o     the outcome for the player to move
+ * @return int the first winning cell, else the first drawing one, else the first empty one
+ */
+int protocolBestMove(const protocol_position &p, outcome &o)
+{
+    const rules &r = *p.r;
+    moves candidates = distinctCells(r.symmetries, p.cfg, r.full & ~p.all); // symmetric moves are equivalent
+    int result = __builtin_ctz(candidates);
+    o = LOSING;
+    for (moves rest = candidates; rest != 0 && o != WINNING; rest &= rest - 1)
+    {
+        int cell = __builtin_ctz(rest);
+        outcome chk = moveOutcome(*p.r, p.cfg, p.all, cell);
+        if (chk == WINNING || (chk == DRAW && o == LOSING))
+        {
+            o = chk;
+            result = cell;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief answer a command line
+ *
+ * @return true to go on, false at quit
+ */
+bool protocolCommand(protocol_state &s, string_view line)
+{
+    static const char OUTCOMES[] = "WLD"; // by enum outcome
+    string_view command = nextWord(line);
+    if (command.empty())
+    {
+        return true;
+    }
+    if (command == "quit")
+    {
+        return false;
+    }
+    if (command == "isready")
+    {
+        s.output += "readyok\n";
+        return true;
+    }
+    bool analyze = command == "analyze", best = command == "bestmove", solve = command == "solve";
+    if (command != "position" && !analyze && !best && !solve)
+    {
+        s.output += "error unknown command\n";
+        return true;
+    }
+    if (line.find_first_not_of(" \t\r") != string_view::npos)
+    {
+        const char *error = parsePosition(line, s.current);
+        if (error != nullptr)
+        {
+            s.output += "error ";
+            s.output += error;
+            s.output += '\n';
+            s.current.r = nullptr;
+            return true;
+        }
+    }
+    if (command == "position")
+    {
+        return true;
+    }
+    const protocol_position &p = s.current;
+    if (p.r == nullptr)
+    {
+        s.output += "error no position\n";
+        return true;
+    }
+    if (analyze)
+    {
+        move_value values[MAX_DIM * MAX_DIM];
+        s.output += "analysis";
+        for (moves rest = analyzeConfig(*p.r, p.cfg, p.all, values) > 0 ? p.r->full & ~p.all : 0; rest != 0; rest &= rest - 1)
+        {
+            int cell = __builtin_ctz(rest);
+            s.output += ' ';
+            s.output += to_string(cell);
+            s.output += ':';
+            s.output += OUTCOMES[values[cell].result];
+            s.output += to_string(values[cell].length);
+        }
+        s.output += '\n';
+        return true;
+    }
+    outcome o = isWinning(*p.r, p.cfg >> p.r->numCells) ? LOSING : DRAW;
+    int cell = positionOver(p) ? -1 : protocolBestMove(p, o);
+    if (best)
+    {
+        s.output += "bestmove ";
+        s.output += cell < 0 ? "-" : to_string(cell);
+    }
+    else
+    {
+        s.output += "solve";
+    }
+    s.output += ' ';
+    s.output += OUTCOMES[o];
+    s.output += '\n';
+    return true;
+}
+
+/**
+ * @brief Answer the protocol commands until quit or the end of the input
+ *
+ * @param in    input file descriptor
+ * @param out   output file descriptor
+ * @return int the exit code
+ */
+int runEngineProtocol(int in, int out)
+{
+    protocol_state s;
+    s.in = in;
+    s.out = out;
+    s.output.reserve(PROTOCOL_FLUSH_SIZE + 4096);
+    string input;
+    size_t inPos = 0;
+    vector<char> buffer(PROTOCOL_READ_SIZE);
+    for (;;)
+    {
+        // answer the complete lines
+        size_t eol;
+        while ((eol = input.find('\n', inPos)) != string::npos)
+        {
+            bool going = protocolCommand(s, string_view(input).substr(inPos, eol - inPos));
+            inPos = eol + 1;
+            if (!going)
+            {
+                return flushProtocol(s) ? 0 : 1;
+            }
+            if (s.output.size() >= PROTOCOL_FLUSH_SIZE && !flushProtocol(s))
+            {
+                return 1;
+            }
+        }
+        input.erase(0, inPos);
+        inPos = 0;
+        // the answers are due before waiting for more commands
+        if (!flushProtocol(s))
+        {
+            return 1;
+        }
+        ssize_t n = read(s.in, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            if (!input.empty())
+            {
+                protocolCommand(s, input); // last line without newline
+            }
+            return flushProtocol(s) && n == 0 ? 0 : 1;
+        }
+        input.append(buffer.data(), n);
+    }
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+// The engine protocol =========================================================
+/**
+ * Modalità motore per altri programmi (nello spirito di UCI/GTP): comandi
+ * testuali su stdin, risposte su stdout, senza interfaccia utente.
+ * I comandi possono arrivare in blocco: l'input è letto ed il risultato
+ * scritto in blocchi grandi, svuotando l'output solo prima di attendere
+ * altro input.
+ *
+ * Comandi (una riga ciascuno; <board> = celle per righe, X O o ., ad es.
+ * "X...O..........." per 4x4; <turn> = X o O, di default chi ha meno pedine,
+ * X a parità):
+ *  position <board> [<turn>]        -> (nessuna risposta)
+ *  analyze [<board> [<turn>]]       -> analysis <cell>:<W|D|L><length> ...
+ *  bestmove [<board> [<turn>]]      -> bestmove <cell> <W|D|L>
+ *  solve [<board> [<turn>]]         -> solve <W|D|L>
+ *  isready                          -> readyok
+ *  quit                             -> (fine)
+ * Gli esiti sono per il giocatore di turno (per analyze: per chi fa la mossa,
+ * con il numero di mosse alla fine della partita, questa compresa);
+ * a partita finita analyze non elenca mosse e bestmove risponde con "-".
+ * Gli errori sono segnalati con "error <reason>".
+ */
+
+/**
+ * @brief Answer the protocol commands until quit or the end of the input
+ *
+ * @param in    input file descriptor
+ * @param out   output file descriptor
+ * @return int the exit code
+ */
+int runEngineProtocol(int in, int out);
+
+#endif
@@ -0,0 +1,616 @@
+#ifndef QUBIC_CPP
+#define QUBIC_CPP
+
+#include "qubic.h"
+#include <climits>
+
+#define QUBIC_LINES 76            ///< winning lines
+#define QUBIC_MAX_CELL_LINES 7    ///< max lines through a cell (corners and inner cells)
+#define QUBIC_EVAL_LIMIT 100      ///< heuristic scores are within +-this
+#define QUBIC_LEAF_THREATS 2      ///< threats tried at the search leaves
+#define QUBIC_ROOT_THREATS 32     ///< threats tried before searching
+#define QUBIC_CLOCK_CHECK 1023    ///< nodes between clock checks (mask)
+#define QUBIC_KIND_SHIFT 6        ///< stored values: cell bits, then the kind
+#define QUBIC_HINT 0              ///< stored kind: the best move found
+#define QUBIC_WON 1               ///< stored kind: won for the player to move (with the winning move)
+#define QUBIC_LOST 2              ///< stored kind: lost for the player to move
+
+using qubic_cells = uint64_t; ///< bitmap of cells
+
+/**
+ * @brief the winning lines (computed once)
+ *
+ */
+struct qubic_rules
+{
+    qubic_cells lines[QUBIC_LINES];                       ///< winning lines
+    uint8_t cellLines[QUBIC_CELLS][QUBIC_MAX_CELL_LINES]; ///< the lines through each cell
+    int numCellLines[QUBIC_CELLS];                        ///< number of lines through each cell
+};
+
+/**
+ * @brief compute the winning lines (the 3D extension of initRules)
+ *
+ * A line moves along one of 13 directions (the first non zero component
+ * positive) and spans the whole board in the coordinates that change.
+ */
+void initQubicRules(qubic_rules &q)
+{
+    int numLines = 0;
+    fill(q.numCellLines, q.numCellLines + QUBIC_CELLS, 0);
+    for (int dl = -1; dl <= 1; dl++)
+    {
+        for (int dr = -1; dr <= 1; dr++)
+        {
+            for (int dc = -1; dc <= 1; dc++)
+            {
+                int first = dl != 0 ? dl : dr != 0 ? dr : dc;
+                for (int start = 0; first > 0 && start < QUBIC_CELLS; start++)
+                {
+                    int layer = start / (QUBIC_DIM * QUBIC_DIM), row = start / QUBIC_DIM % QUBIC_DIM, col = start % QUBIC_DIM;
+                    qubic_cells line = 0;
+                    for (int k = 0; k < QUBIC_DIM; k++)
+                    {
+                        int l = layer + k * dl, r = row + k * dr, c = col + k * dc;
+                        if (l < 0 || l >= QUBIC_DIM || r < 0 || r >= QUBIC_DIM || c < 0 || c >= QUBIC_DIM)
+                        {
+                            line = 0;
+                            break;
+                        }
+                        line |= 1ull << ((l * QUBIC_DIM + r) * QUBIC_DIM + c);
+                    }
+                    if (line != 0)
+                    {
+                        for (qubic_cells rest = line; rest != 0; rest &= rest - 1)
+                        {
+                            int cell = __builtin_ctzll(rest);
+                            q.cellLines[cell][q.numCellLines[cell]++] = numLines;
+                        }
+                        q.lines[numLines++] = line;
+                    }
+                }
+            }
+        }
+    }
+}
+
+qubic_rules qubicRules;
+once_flag qubicRulesInitialized;
+
+/**
+ * @brief Get the winning lines (initialized on first use)
+ *
+ */
+const qubic_rules &getQubicRules()
+{
+    call_once(qubicRulesInitialized, initQubicRules, ref(qubicRules));
+    return qubicRules;
+}
+
+transposition_table *qubicTable = nullptr;
+once_flag qubicTableCreated;
+
+/**
+ * @brief Get the searched positions table (created on first use, as large as the solver one)
+ *
+ */
+transposition_table &getQubicTable()
+{
+    call_once(qubicTableCreated, [] { qubicTable = newTable(solverMegabytes << 20, solverHugePages); });
+    return *qubicTable;
+}
+
+/**
+ * @brief check whether a move completes a line (just the lines through it)
+ *
+ * @param mine  the cells of the player, the move included
+ */
+bool qubicWins(const qubic_rules &q, qubic_cells mine, int cell)
+{
+    for (int i = 0; i < q.numCellLines[cell]; i++)
+    {
+        qubic_cells line = q.lines[q.cellLines[cell][i]];
+        if ((mine & line) == line)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief the cells completing a line of a player (threats)
+ *
+ */
+qubic_cells qubicThreats(const qubic_rules &q, qubic_cells mine, qubic_cells other)
+{
+    qubic_cells result = 0;
+    for (qubic_cells line : q.lines)
+    {
+        qubic_cells empty = line & ~mine;
+        if ((line & other) == 0 && empty != 0 && (empty & (empty - 1)) == 0)
+        {
+            result |= empty;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief the cells making a threat: the empty cells of the lines with two pieces of a player and none of the other
+ *
+ */
+qubic_cells qubicThreatMoves(const qubic_rules &q, qubic_cells mine, qubic_cells other)
+{
+    qubic_cells result = 0;
+    for (qubic_cells line : q.lines)
+    {
+        qubic_cells empty = line & ~mine, rest = empty & (empty - 1);
+        if ((line & other) == 0 && rest != 0 && (rest & (rest - 1)) == 0)
+        {
+            result |= empty;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief heuristic value of a position: the lines still open for each player, weighted by their pieces
+ *
+ * @return int for the first player, within +-QUBIC_EVAL_LIMIT
+ */
+int qubicEval(const qubic_rules &q, qubic_cells mine, qubic_cells other)
+{
+    static const int WEIGHTS[QUBIC_DIM] = {0, 1, 3, 9}; // by pieces in the line
+    int score = 0;
+    for (qubic_cells line : q.lines)
+    {
+        int m = __builtin_popcountll(line & mine), o = __builtin_popcountll(line & other);
+        if (o == 0)
+        {
+            score += WEIGHTS[m];
+        }
+        else if (m == 0)
+        {
+            score -= WEIGHTS[o];
+        }
+    }
+    return max(-QUBIC_EVAL_LIMIT, min(QUBIC_EVAL_LIMIT, score));
+}
+
+/**
+ * @brief sort some moves: the hinted one first, then by the lines they extend or block
+ *
+ * @param candidates    the moves
+ * @param hint          the move to be tried first (-1 if none)
+ * @param order         the sorted moves (set)
+ * @return int the number of moves
+ */
+int qubicOrderMoves(const qubic_rules &q, qubic_cells mine, qubic_cells other, qubic_cells candidates, int hint, int order[])
+{
+    int scores[QUBIC_CELLS], n = 0;
+    for (; candidates != 0; candidates &= candidates - 1)
+    {
+        int cell = __builtin_ctzll(candidates), score = 0;
+        for (int i = 0; i < q.numCellLines[cell]; i++)
+        {
+            qubic_cells line = q.lines[q.cellLines[cell][i]];
+            int m = __builtin_popcountll(line & mine), o = __builtin_popcountll(line & other);
+            score += (o == 0 ? 1 << (2 * m) : 0) + (m == 0 ? 1 << (2 * o) : 0);
+        }
+        if (cell == hint)
+        {
+            score = INT_MAX;
+        }
+        int i = n++;
+        for (; i > 0 && scores[i - 1] < score; i--)
+        {
+            scores[i] = scores[i - 1];
+            order[i] = order[i - 1];
+        }
+        scores[i] = score;
+        order[i] = cell;
+    }
+    return n;
+}
+
+/**
+ * @brief a search in progress
+ *
+ */
+struct qubic_search
+{
+    const qubic_rules &q;       ///< the lines
+    transposition_table &table; ///< searched positions
+    TimePoint deadline;         ///< when to stop
+    unsigned long long nodes;   ///< positions searched
+    bool stopped;               ///< out of time (the results are not valid)
+};
+
+/**
+ * @brief count a searched position, check the time
+ *
+ * @return true if the search must stop
+ */
+bool qubicVisit(qubic_search &s)
+{
+    if ((++s.nodes & QUBIC_CLOCK_CHECK) == 0 && theClock.now() >= s.deadline)
+    {
+        s.stopped = true;
+    }
+    return s.stopped;
+}
+
+/**
+ * @brief the key of a position
+ *
+ * @param mine  the cells of the player to move
+ */
+uint64_t qubicKey(qubic_cells mine, qubic_cells other)
+{
+    return positionKey(mine ^ positionKey(other));
+}
+
+/**
+ * @brief look for a win by continuous threats (every move makes three in a line)
+ *
+ * The opponent must block each threat; a move making two threats at once
+ * wins. The blocks may threaten in turn: then the next move must block,
+ * and threaten again.
+ *
+ * @param mine  the cells of the player to move
+ * @param depth the threats that can be tried
+ * @param move  the first move of the win (set if found)
+ * @return true if found
+ */
+bool qubicThreatSearch(qubic_search &s, qubic_cells mine, qubic_cells other, int depth, int &move)
+{
+    if (qubicVisit(s))
+    {
+        return false;
+    }
+    const qubic_rules &q = s.q;
+    qubic_cells wins = qubicThreats(q, mine, other);
+    if (wins != 0)
+    {
+        move = __builtin_ctzll(wins);
+        return true;
+    }
+    qubic_cells blocks = qubicThreats(q, other, mine);
+    if (depth == 0 || (blocks & (blocks - 1)) != 0)
+    {
+        return false;
+    }
+    qubic_cells candidates = qubicThreatMoves(q, mine, other);
+    if (blocks != 0)
+    {
+        candidates &= blocks;
+    }
+    for (; candidates != 0; candidates &= candidates - 1)
+    {
+        int cell = __builtin_ctzll(candidates), reply;
+        qubic_cells threats = qubicThreats(q, mine | 1ull << cell, other);
+        // a single threat: the opponent has to take that cell
+        if ((threats & (threats - 1)) != 0 || qubicThreatSearch(s, mine | 1ull << cell, other | threats, depth - 1, reply))
+        {
+            move = cell;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief alpha-beta search (fail soft): forced blocks do not count as depth
+ *
+ * Won and lost positions are exact (QUBIC_WIN is the highest score), so
+ * they are stored as solved whatever the depth, unless the score comes
+ * from a cutoff.
+ *
+ * @param mine  the cells of the player to move
+ * @return int the score for the player to move (0 if stopped)
+ */
+int qubicSearch(qubic_search &s, qubic_cells mine, qubic_cells other, int depth, int alpha, int beta)
+{
+    if (qubicVisit(s))
+    {
+        return 0;
+    }
+    const qubic_rules &q = s.q;
+    if (qubicThreats(q, mine, other) != 0)
+    {
+        return QUBIC_WIN;
+    }
+    qubic_cells blocks = qubicThreats(q, other, mine);
+    if ((blocks & (blocks - 1)) != 0)
+    {
+        return -QUBIC_WIN;
+    }
+    if ((mine | other) == ~0ull)
+    {
+        return 0;
+    }
+    uint64_t key = qubicKey(mine, other);
+    unsigned value;
+    int hint = -1;
+    if (probeTable(s.table, key, value))
+    {
+        unsigned kind = value >> QUBIC_KIND_SHIFT;
+        if (kind != QUBIC_HINT)
+        {
+            return kind == QUBIC_WON ? QUBIC_WIN : -QUBIC_WIN;
+        }
+        hint = value & (QUBIC_CELLS - 1);
+    }
+    int move;
+    if (depth <= 0 && blocks == 0)
+    {
+        if (qubicThreatSearch(s, mine, other, QUBIC_LEAF_THREATS, move))
+        {
+            storeTable(s.table, key, QUBIC_WON << QUBIC_KIND_SHIFT | move, TT_MAX_DEPTH);
+            return QUBIC_WIN;
+        }
+        return s.stopped ? 0 : qubicEval(q, mine, other);
+    }
+    int order[QUBIC_CELLS];
+    int n = qubicOrderMoves(q, mine, other, blocks != 0 ? blocks : ~(mine | other), hint, order);
+    int best = -QUBIC_WIN - 1;
+    move = order[0];
+    for (int i = 0; i < n && best < beta && best < QUBIC_WIN; i++)
+    {
+        int score = -qubicSearch(s, other, mine | 1ull << order[i], blocks != 0 ? depth : depth - 1, -beta, -max(alpha, best));
+        if (s.stopped)
+        {
+            return 0;
+        }
+        if (score > best)
+        {
+            best = score;
+            move = order[i];
+        }
+    }
+    unsigned kind = QUBIC_HINT;
+    if (best < beta) // after a cutoff the score is only a bound
+    {
+        kind = best == QUBIC_WIN ? QUBIC_WON : best == -QUBIC_WIN ? QUBIC_LOST : QUBIC_HINT;
+    }
+    storeTable(s.table, key, kind << QUBIC_KIND_SHIFT | move, kind == QUBIC_HINT ? max(depth, 0) : TT_MAX_DEPTH);
+    return best;
+}
+
+/**
+ * @brief game representation
+ *
+ */
+struct qubic
+{
+    qubic_cells done[NUM_PLAYERS]{0, 0}; ///< the cells of each player
+    player turn{0};                      ///< player to move
+    player winner{PLAYER_NONE};          ///< winner
+    status state{RUNNING};               ///< game status
+    qubic_cells line{0};                 ///< the winning line (if any)
+};
+
+/**
+ * @brief Get a new game (the first player at random)
+ *
+ */
+qubic newQubic()
+{
+    qubic g;
+    g.turn = rand() % NUM_PLAYERS;
+    return g;
+}
+
+/**
+ * @brief Get the status of the game
+ *
+ */
+status getQubicStatus(const qubic &g)
+{
+    return g.state;
+}
+
+/**
+ * @brief Get the player to move (PLAYER_NONE if the game is over)
+ *
+ */
+player getQubicTurn(const qubic &g)
+{
+    return g.state == RUNNING ? g.turn : PLAYER_NONE;
+}
+
+/**
+ * @brief Get the winner (PLAYER_NONE if none)
+ *
+ */
+player getQubicWinner(const qubic &g)
+{
+    return g.winner;
+}
+
+/**
+ * @brief Get the player of a cell (PLAYER_NONE if empty)
+ *
+ */
+player getQubicCell(const qubic &g, int cell)
+{
+    for (player p = 0; p < NUM_PLAYERS; p++)
+    {
+        if (0 <= cell && cell < QUBIC_CELLS && (g.done[p] >> cell & 1))
+        {
+            return p;
+        }
+    }
+    return PLAYER_NONE;
+}
+
+/**
+ * @brief Check whether a cell belongs to the winning line
+ *
+ */
+bool isQubicWinningCell(const qubic &g, int cell)
+{
+    return 0 <= cell && cell < QUBIC_CELLS && (g.line >> cell & 1);
+}
+
+/**
+ * @brief Check if a move is allowed
+ *
+ */
+bool isAllowedQubicMove(const qubic &g, int cell)
+{
+    return g.state == RUNNING && getQubicCell(g, cell) == PLAYER_NONE && 0 <= cell && cell < QUBIC_CELLS;
+}
+
+/**
+ * @brief Make a move of the player to move
+ *
+ * @return true if the move was allowed
+ */
+bool makeQubicMove(qubic &g, int cell)
+{
+    if (!isAllowedQubicMove(g, cell))
+    {
+        return false;
+    }
+    const qubic_rules &q = getQubicRules();
+    g.done[g.turn] |= 1ull << cell;
+    if (qubicWins(q, g.done[g.turn], cell))
+    {
+        for (int i = 0; i < q.numCellLines[cell]; i++)
+        {
+            qubic_cells line = q.lines[q.cellLines[cell][i]];
+            if ((g.done[g.turn] & line) == line)
+            {
+                g.line |= line;
+            }
+        }
+        g.state = ENDED;
+        g.winner = g.turn;
+    }
+    else if ((g.done[0] | g.done[1]) == ~0ull)
+    {
+        g.state = ENDED;
+    }
+    else
+    {
+        g.turn = 1 - g.turn;
+    }
+    return true;
+}
+
+/**
+ * @brief Choose a move for the player to move (the game not over)
+ *
+ * A win by continuous threats is played at once; otherwise iterative
+ * deepening, the best move of each depth searched first by the next one
+ * (a depth interrupted by the clock still counts for the moves it has
+ * searched).
+ *
+ * @param seconds   the time available
+ * @param info      what the search found (set)
+ * @return int the cell
+ */
+int getQubicMove(const qubic &g, double seconds, qubic_search_info &info)
+{
+    TimePoint start = theClock.now();
+    const qubic_rules &q = getQubicRules();
+    transposition_table &table = getQubicTable();
+    ageTable(table);
+    qubic_search s{q, table, start + chrono::duration_cast<Clock::duration>(Duration(seconds)), 0, false};
+    qubic_cells mine = g.done[g.turn], other = g.done[1 - g.turn];
+    qubic_cells blocks = qubicThreats(q, other, mine);
+    info = {0, QUBIC_WIN, 0, 0};
+    int order[QUBIC_CELLS];
+    int n = qubicOrderMoves(q, mine, other, blocks != 0 ? blocks : ~(mine | other), -1, order);
+    if (!qubicThreatSearch(s, mine, other, QUBIC_ROOT_THREATS, order[0]))
+    {
+        s.stopped = theClock.now() >= s.deadline;
+        info.score = 0;
+        for (int depth = 1; depth <= QUBIC_CELLS - __builtin_popcountll(mine | other) && !s.stopped; depth++)
+        {
+            int alpha = -QUBIC_WIN - 1, best = -1;
+            for (int i = 0; i < n && alpha < QUBIC_WIN; i++) // a win cannot be improved
+            {
+                int score = -qubicSearch(s, other, mine | 1ull << order[i], depth - 1, -QUBIC_WIN - 1, -alpha);
+                if (s.stopped)
+                {
+                    break;
+                }
+                if (score > alpha)
+                {
+                    alpha = score;
+                    best = i;
+                }
+            }
+            if (best < 0)
+            {
+                break; // not even the first move searched
+            }
+            rotate(order, order + best, order + best + 1);
+            info.score = alpha;
+            if (!s.stopped)
+            {
+                info.depth = depth;
+            }
+            if (alpha == QUBIC_WIN || alpha == -QUBIC_WIN)
+            {
+                break; // solved
+            }
+        }
+    }
+    info.nodes = s.nodes;
+    info.seconds = Duration(theClock.now() - start).count();
+    return order[0];
+}
+
+/**
+ * @brief Play some computer vs computer games and report the search statistics
+ *
+ * @param games     the games
+ * @param seconds   per move
+ * @return int the exit code
+ */
+int runQubicBench(ostream &out, int games, double seconds)
+{
+    int wins[PLAYER_NONE + 1]{}, firstWins = 0;
+    unsigned long long nodes = 0, moves = 0, depths = 0, solved = 0;
+    double time = 0;
+    for (int i = 0; i < games; i++)
+    {
+        qubic g = newQubic();
+        player first = g.turn;
+        while (g.state == RUNNING)
+        {
+            qubic_search_info info;
+            makeQubicMove(g, getQubicMove(g, seconds, info));
+            nodes += info.nodes;
+            if (info.score == QUBIC_WIN || info.score == -QUBIC_WIN)
+            {
+                solved++;
+            }
+            else
+            {
+                depths += info.depth;
+            }
+            time += info.seconds;
+            moves++;
+        }
+        wins[g.winner]++;
+        firstWins += g.winner == first;
+        out << "Game " << i + 1 << ": " << (g.winner == PLAYER_NONE ? "draw" : g.winner == first ? "first player wins" : "second player wins")
+            << " in " << __builtin_popcountll(g.done[0] | g.done[1]) << " moves\n";
+    }
+    out << "Qubic: " << games << " games, " << seconds << " s per move: X wins " << wins[0] << ", O wins " << wins[1]
+        << ", draws " << wins[PLAYER_NONE] << ", first player wins " << firstWins << "\n";
+    out << moves << " moves, " << nodes << " positions in " << fixed << setprecision(1) << time << " s ("
+        << (time > 0 ? nodes / time / 1e6 : 0) << " M/s), solved " << solved << " moves, mean depth of the others "
+        << (moves > solved ? double(depths) / (moves - solved) : 0) << defaultfloat << "\n";
+    out << "Searched positions: ";
+    printTableStats(out, getTableStats(getQubicTable()));
+    out.flush();
+    return 0;
+}
+
+#endif
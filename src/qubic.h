@@ -0,0 +1,107 @@
+#ifndef QUBIC_H
+#define QUBIC_H
+
+// The 4x4x4 game (Qubic) ======================================================
+/**
+ * Tris tridimensionale: quattro livelli 4x4 sovrapposti, vince chi allinea
+ * quattro pedine in una delle 76 linee (righe, colonne e diagonali di ogni
+ * livello, verticali e diagonali fra i livelli). Le 64 celle di ciascun
+ * giocatore stanno in una parola a 64 bit, come le mosse delle scacchiere
+ * piane in una parola a 32 bit.
+ * Il computer cerca prima una vittoria forzata con minacce continue (tre
+ * pedine in una linea libera obbligano l'avversario a bloccare), poi
+ * valuta le mosse con una ricerca alfa-beta ad approfondimento iterativo,
+ * usando la tabella delle trasposizioni per le mosse migliori e per le
+ * posizioni risolte.
+ */
+
+#define QUBIC_DIM 4    ///< cells per side
+#define QUBIC_CELLS 64 ///< cell = (layer * QUBIC_DIM + row) * QUBIC_DIM + column
+#define QUBIC_WIN 120  ///< search score of a won position (heuristic scores are lower)
+
+/**
+ * @brief the game (to be defined in qubic.cpp)
+ *
+ */
+struct qubic;
+
+/**
+ * @brief what a search found
+ *
+ */
+struct qubic_search_info
+{
+    int depth;                ///< full depth searched (moves)
+    int score;                ///< for the player to move (QUBIC_WIN / -QUBIC_WIN if proven)
+    unsigned long long nodes; ///< positions searched (threat search included)
+    double seconds;           ///< time spent
+};
+
+/**
+ * @brief Get a new game (the first player at random)
+ *
+ */
+qubic newQubic();
+
+/**
+ * @brief Get the status of the game
+ *
+ */
+status getQubicStatus(const qubic &);
+
+/**
+ * @brief Get the player to move (PLAYER_NONE if the game is over)
+ *
+ */
+player getQubicTurn(const qubic &);
+
+/**
+ * @brief Get the winner (PLAYER_NONE if none)
+ *
+ */
+player getQubicWinner(const qubic &);
+
+/**
+ * @brief Get the player of a cell (PLAYER_NONE if empty)
+ *
+ */
+player getQubicCell(const qubic &, int cell);
+
+/**
+ * @brief Check whether a cell belongs to the winning line
+ *
+ */
+bool isQubicWinningCell(const qubic &, int cell);
+
+/**
+ * @brief Check if a move is allowed
+ *
+ */
+bool isAllowedQubicMove(const qubic &, int cell);
+
+/**
+ * @brief Make a move of the player to move
+ *
+ * @return true if the move was allowed
+ */
+bool makeQubicMove(qubic &, int cell);
+
+/**
+ * @brief Choose a move for the player to move (the game not over)
+ *
+ * @param seconds   the time available
+ * @param info      what the search found (set)
+ * @return int the cell
+ */
+int getQubicMove(const qubic &, double seconds, qubic_search_info &info);
+
+/**
+ * @brief Play some computer vs computer games and report the search statistics
+ *
+ * @param games     the games
+ * @param seconds   per move
+ * @return int the exit code
+ */
+int runQubicBench(std::ostream &, int games, double seconds);
+
+#endif
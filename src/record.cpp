@@ -0,0 +1,478 @@
+#ifndef RECORD_CPP
+#define RECORD_CPP
+
+#include "record.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define RECORD_MAGIC "TTTGAMES"       ///< records file signature (no terminator)
+#define RECORD_VERSION 1              ///< records file format version
+#define RECORD_BLOCK (1 << 20)        ///< bytes written at once
+#define RECORD_FLUSH_INTERVAL 5       ///< seconds before a partial block is written
+#define RECORD_MAX_BYTES 2048         ///< upper bound of an encoded record
+
+/**
+ * @brief records file header (followed by the records)
+ *
+ * Each record: size (2 bytes, the whole record), dim, players (4 bits) and
+ * first player (4 bits), winner, timeout, source, one engine per player,
+ * seed (4 bytes), start time (varint), number of moves, the moves (nibbles
+ * when cells fit, else bytes), then the time of each move (varint).
+ */
+struct record_file_header
+{
+    char magic[8];    ///< RECORD_MAGIC
+    uint32_t version; ///< RECORD_VERSION
+    uint32_t unused;  ///< padding
+};
+
+/**
+ * @brief the records writer (one per process)
+ *
+ */
+struct record_writer
+{
+    int fd{-1};                        ///< the file (-1 if not recording)
+    record_source source;              ///< where games are played
+    std::mutex lock;                   ///< protects the buffers
+    std::condition_variable wake;      ///< block ready, or stop
+    std::vector<uint8_t> filling;      ///< records being appended
+    std::vector<uint8_t> writing;      ///< block being written
+    bool writePending{false};          ///< whether writing holds a block
+    bool stop{false};                  ///< whether to stop the flusher
+    std::thread flusher;               ///< writes the blocks
+};
+
+record_writer recordWriter;
+
+/**
+ * @brief append an unsigned number, 7 bits per byte (LEB128)
+ *
+ */
+inline uint8_t *putVarint(uint8_t *p, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = uint8_t(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = uint8_t(value);
+    return p;
+}
+
+/**
+ * @brief read an unsigned number written by putVarint
+ *
+ * @return const uint8_t* after the number (nullptr if past end)
+ */
+inline const uint8_t *getVarint(const uint8_t *p, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t b = *p++;
+        value |= uint64_t(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief whether the moves of a dimension are written as nibbles
+ *
+ */
+inline bool nibbleMoves(unsigned dim)
+{
+    return dim * dim <= 16;
+}
+
+/**
+ * @brief encode a record
+ *
+ * @param out   the buffer (RECORD_MAX_BYTES at least)
+ * @return size_t the bytes used
+ */
+size_t encodeGameRecord(const game_record &r, uint8_t *out)
+{
+    uint8_t *p = out + 2;
+    *p++ = r.dim;
+    *p++ = uint8_t(r.numPlayers << 4 | r.first);
+    *p++ = r.winner;
+    *p++ = r.timeout;
+    *p++ = r.source;
+    for (int i = 0; i < r.numPlayers; i++)
+    {
+        *p++ = r.engines[i];
+    }
+    memcpy(p, &r.seed, sizeof(r.seed));
+    p = putVarint(p + sizeof(r.seed), r.started);
+    *p++ = r.numMoves;
+    if (nibbleMoves(r.dim))
+    {
+        for (int i = 0; i < r.numMoves; i += 2)
+        {
+            *p++ = uint8_t(r.moves[i] | (i + 1 < r.numMoves ? r.moves[i + 1] << 4 : 0));
+        }
+    }
+    else
+    {
+        memcpy(p, r.moves, r.numMoves);
+        p += r.numMoves;
+    }
+    for (int i = 0; i < r.numMoves; i++)
+    {
+        p = putVarint(p, r.millis[i]);
+    }
+    uint16_t size = uint16_t(p - out);
+    memcpy(out, &size, sizeof(size));
+    return size;
+}
+
+/**
+ * @brief decode a record
+ *
+ * @param p     the record
+ * @param end   the end of the data
+ * @return size_t the record size (0 if not valid)
+ */
+size_t decodeGameRecord(const uint8_t *p, const uint8_t *end, game_record &r)
+{
+    uint16_t size;
+    if (end - p < 2 + 6)
+    {
+        return 0;
+    }
+    memcpy(&size, p, sizeof(size));
+    if (size > end - p)
+    {
+        return 0;
+    }
+    const uint8_t *q = p + 2, *stop = p + size;
+    r.dim = *q++;
+    r.numPlayers = *q >> 4;
+    r.first = *q++ & 15;
+    r.winner = *q++;
+    r.timeout = *q++;
+    r.source = *q++;
+    if (r.dim < MIN_DIM || r.dim > MAX_DIM || r.numPlayers < 2 || r.numPlayers > RECORD_MAX_PLAYERS ||
+        r.first >= r.numPlayers || (r.winner >= r.numPlayers && r.winner != RECORD_NO_WINNER) ||
+        stop - q < r.numPlayers + 4)
+    {
+        return 0; // the readers index their tables by these fields
+    }
+    memcpy(r.engines, q, r.numPlayers);
+    q += r.numPlayers;
+    memcpy(&r.seed, q, sizeof(r.seed));
+    q += sizeof(r.seed);
+    if ((q = getVarint(q, stop, r.started)) == nullptr || q >= stop)
+    {
+        return 0;
+    }
+    r.numMoves = *q++;
+    if (r.numMoves > r.dim * r.dim)
+    {
+        return 0;
+    }
+    size_t moveBytes = nibbleMoves(r.dim) ? (r.numMoves + 1) / 2 : r.numMoves;
+    if (size_t(stop - q) < moveBytes)
+    {
+        return 0;
+    }
+    for (int i = 0; i < r.numMoves; i++)
+    {
+        r.moves[i] = nibbleMoves(r.dim) ? (q[i / 2] >> (i % 2 * 4)) & 15 : q[i];
+        if (r.moves[i] >= r.dim * r.dim)
+        {
+            return 0;
+        }
+    }
+    q += moveBytes;
+    for (int i = 0; i < r.numMoves; i++)
+    {
+        uint64_t millis;
+        if ((q = getVarint(q, stop, millis)) == nullptr)
+        {
+            return 0;
+        }
+        r.millis[i] = uint32_t(millis);
+    }
+    return size;
+}
+
+/**
+ * @brief write a buffer at the end of the file
+ *
+ */
+void appendBlock(int fd, const std::vector<uint8_t> &block)
+{
+    // O_APPEND: whole blocks of whole records, even with other processes
+    size_t done = 0;
+    while (done < block.size())
+    {
+        ssize_t n = write(fd, block.data() + done, block.size() - done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return; // records lost, the game goes on
+        }
+        done += n;
+    }
+}
+
+/**
+ * @brief the flusher thread: writes full blocks, and partial ones from time to time
+ *
+ */
+void recordFlusher()
+{
+    record_writer &w = recordWriter;
+    std::unique_lock<std::mutex> lock(w.lock);
+    while (!w.stop)
+    {
+        if (!w.wake.wait_for(lock, Duration(RECORD_FLUSH_INTERVAL), [&w] { return w.stop || w.writePending; }) &&
+            !w.filling.empty())
+        {
+            w.filling.swap(w.writing); // idle: write what is there
+            w.writePending = true;
+        }
+        if (w.writePending)
+        {
+            lock.unlock();
+            appendBlock(w.fd, w.writing);
+            w.writing.clear();
+            lock.lock();
+            w.writePending = false;
+        }
+    }
+}
+
+/**
+ * @brief Start recording games (appending to a file)
+ *
+ * @param path      the file
+ * @param source    where the games of this process are played
+ * @return true if the file could be opened
+ */
+bool startGameRecords(const char path[], record_source source)
+{
+    record_writer &w = recordWriter;
+    w.fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (w.fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(w.fd, &st) == 0 && st.st_size == 0)
+    {
+        record_file_header h{};
+        memcpy(h.magic, RECORD_MAGIC, sizeof(h.magic));
+        h.version = RECORD_VERSION;
+        ssize_t ignored = write(w.fd, &h, sizeof(h));
+        (void)ignored;
+    }
+    w.source = source;
+    w.filling.reserve(RECORD_BLOCK + RECORD_MAX_BYTES);
+    w.writing.reserve(RECORD_BLOCK + RECORD_MAX_BYTES);
+    w.stop = false;
+    w.flusher = std::thread(recordFlusher);
+    return true;
+}
+
+/**
+ * @brief Record a game (buffered, written in blocks by a background thread)
+ *
+ * Does nothing if recording was not started; safe from any thread.
+ */
+void appendGameRecord(game_record &r)
+{
+    record_writer &w = recordWriter;
+    if (w.fd < 0)
+    {
+        return;
+    }
+    r.source = w.source;
+    uint8_t encoded[RECORD_MAX_BYTES];
+    size_t size = encodeGameRecord(r, encoded);
+    std::lock_guard<std::mutex> guard(w.lock);
+    w.filling.insert(w.filling.end(), encoded, encoded + size);
+    if (w.filling.size() >= RECORD_BLOCK && !w.writePending)
+    {
+        // the previous block is written: hand over this one (else keep growing)
+        w.filling.swap(w.writing);
+        w.writePending = true;
+        w.wake.notify_one();
+    }
+}
+
+/**
+ * @brief Write the buffered records and stop recording
+ *
+ */
+void stopGameRecords()
+{
+    record_writer &w = recordWriter;
+    if (w.fd < 0)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(w.lock);
+        w.stop = true;
+    }
+    w.wake.notify_one();
+    w.flusher.join();
+    if (w.writePending)
+    {
+        appendBlock(w.fd, w.writing);
+    }
+    appendBlock(w.fd, w.filling);
+    w.writing.clear();
+    w.filling.clear();
+    w.writePending = false;
+    close(w.fd);
+    w.fd = -1;
+}
+
+/**
+ * @brief Open a records file (mapped in memory)
+ *
+ * @return true if it is a records file
+ */
+bool openGameRecords(record_reader &rd, const char path[])
+{
+    rd = record_reader();
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(record_file_header))
+    {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    const record_file_header *h = (const record_file_header *)p;
+    if (memcmp(h->magic, RECORD_MAGIC, sizeof(h->magic)) != 0 || h->version != RECORD_VERSION)
+    {
+        munmap(p, st.st_size);
+        return false;
+    }
+    rd.data = (const uint8_t *)p;
+    rd.size = st.st_size;
+    rd.offset = sizeof(record_file_header);
+    return true;
+}
+
+/**
+ * @brief Read the next record
+ *
+ * @param offset    set to the position of the record in the file
+ * @return true if read
+ * @return false at the end (or at a truncated record)
+ */
+bool nextGameRecord(record_reader &rd, game_record &r, size_t &offset)
+{
+    size_t size = decodeGameRecord(rd.data + rd.offset, rd.data + rd.size, r);
+    if (size == 0)
+    {
+        return false;
+    }
+    offset = rd.offset;
+    rd.offset += size;
+    return true;
+}
+
+/**
+ * @brief Close a records file
+ *
+ */
+void closeGameRecords(record_reader &rd)
+{
+    if (rd.data != nullptr)
+    {
+        munmap((void *)rd.data, rd.size);
+    }
+    rd = record_reader();
+}
+
+/**
+ * @brief Print a summary of a records file (streaming all the records)
+ *
+ * @return int the exit code
+ */
+int printGameRecords(std::ostream &out, const char path[])
+{
+    record_reader rd;
+    if (!openGameRecords(rd, path))
+    {
+        out << "Not a records file: " << path << '\n';
+        return 1;
+    }
+    static const char *sources[NUM_RECORD_SOURCES] = {"interactive", "server", "self-play", "tournament"};
+    unsigned long long games[MAX_DIM + 1][NUM_RECORD_SOURCES] = {}, wins[MAX_DIM + 1][RECORD_MAX_PLAYERS + 1] = {};
+    unsigned long long moves = 0, millis = 0, total = 0;
+    game_record r;
+    size_t offset;
+    TimePoint start = theClock.now();
+    while (nextGameRecord(rd, r, offset))
+    {
+        if (r.dim > MAX_DIM || r.source >= NUM_RECORD_SOURCES)
+        {
+            continue;
+        }
+        total++;
+        games[r.dim][r.source]++;
+        wins[r.dim][r.winner == RECORD_NO_WINNER ? RECORD_MAX_PLAYERS : r.winner]++;
+        moves += r.numMoves;
+        for (int i = 0; i < r.numMoves; i++)
+        {
+            millis += r.millis[i];
+        }
+    }
+    double elapsed = Duration(theClock.now() - start).count();
+    out << total << " games (" << rd.size / 1024 << " KB) read in " << fixed << setprecision(3) << elapsed << " s ("
+        << setprecision(1) << total / elapsed / 1e6 << " M games/s)" << (rd.offset < rd.size ? ", truncated" : "")
+        << '\n';
+    for (int dim = 0; dim <= MAX_DIM; dim++)
+    {
+        for (int s = 0; s < NUM_RECORD_SOURCES; s++)
+        {
+            if (games[dim][s] > 0)
+            {
+                out << "  " << dim << "x" << dim << " " << sources[s] << ": " << games[dim][s] << " games\n";
+            }
+        }
+        if (wins[dim][0] + wins[dim][1] + wins[dim][RECORD_MAX_PLAYERS] > 0)
+        {
+            out << "  " << dim << "x" << dim << " X wins " << wins[dim][0] << ", O wins " << wins[dim][1] << ", draws "
+                << wins[dim][RECORD_MAX_PLAYERS] << '\n';
+        }
+    }
+    out << "  " << (total ? double(moves) / total : 0) << " moves per game, "
+        << (moves ? double(millis) / moves : 0) << " ms per move" << defaultfloat << '\n';
+    closeGameRecords(rd);
+    return 0;
+}
+
+#endif
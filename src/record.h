@@ -0,0 +1,117 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+// The game records ============================================================
+/**
+ * Archivio binario delle partite giocate (interattive, server, self-play):
+ * ogni record contiene le regole (dimensione), i giocatori con il loro motore,
+ * il seme, le mosse (in nibble se la scacchiera ha al più 16 celle) ed il
+ * tempo di ogni mossa (varint in millisecondi).
+ * La scrittura accoda i record in un buffer, scritto in blocchi grandi da un
+ * thread separato; la lettura scorre il file mappato in memoria.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#define RECORD_MAX_PLAYERS 4 ///< players a record can describe
+#define RECORD_MAX_MOVES 255 ///< moves a record can describe
+#define RECORD_NO_WINNER 255 ///< winner of a drawn game
+
+/**
+ * @brief where games are played
+ *
+ */
+enum record_source
+{
+    SOURCE_INTERACTIVE, ///< the console game
+    SOURCE_SERVER,      ///< the game server
+    SOURCE_SELFPLAY,    ///< headless AI vs AI
+    SOURCE_TOURNAMENT,  ///< round robin between the engines
+    NUM_RECORD_SOURCES  ///< fake code: total number of sources
+};
+
+/**
+ * @brief a game, as recorded
+ *
+ */
+struct game_record
+{
+    uint8_t dim;                          ///< board dimension (the rules)
+    uint8_t numPlayers;                   ///< number of players
+    uint8_t first;                        ///< player making the first move
+    uint8_t winner;                       ///< winner (RECORD_NO_WINNER = draw)
+    uint8_t timeout;                      ///< whether the game ended by timeout
+    uint8_t source;                       ///< record_source
+    uint8_t engines[RECORD_MAX_PLAYERS];  ///< engine of each player (engine_kind)
+    uint32_t seed;                        ///< game seed
+    uint64_t started;                     ///< start (milliseconds since the epoch)
+    uint8_t numMoves;                     ///< number of moves
+    uint8_t moves[RECORD_MAX_MOVES];      ///< cells, in order
+    uint32_t millis[RECORD_MAX_MOVES];    ///< time of each move (milliseconds)
+};
+
+/**
+ * @brief Start recording games (appending to a file)
+ *
+ * @param path      the file
+ * @param source    where the games of this process are played
+ * @return true if the file could be opened
+ */
+bool startGameRecords(const char path[], record_source source);
+
+/**
+ * @brief Record a game (buffered, written in blocks by a background thread)
+ *
+ * Does nothing if recording was not started; safe from any thread.
+ */
+void appendGameRecord(game_record &);
+
+/**
+ * @brief Write the buffered records and stop recording
+ *
+ */
+void stopGameRecords();
+
+/**
+ * @brief a records file being read
+ *
+ */
+struct record_reader
+{
+    const uint8_t *data{nullptr}; ///< the mapped file
+    size_t size{0};               ///< file size
+    size_t offset{0};             ///< next record
+};
+
+/**
+ * @brief Open a records file (mapped in memory)
+ *
+ * @return true if it is a records file
+ */
+bool openGameRecords(record_reader &, const char path[]);
+
+/**
+ * @brief Read the next record
+ *
+ * @param offset    set to the position of the record in the file
+ * @return true if read
+ * @return false at the end (or at a truncated record)
+ */
+bool nextGameRecord(record_reader &, game_record &, size_t &offset);
+
+/**
+ * @brief Close a records file
+ *
+ */
+void closeGameRecords(record_reader &);
+
+/**
+ * @brief Print a summary of a records file (streaming all the records)
+ *
+ * @return int the exit code
+ */
+int printGameRecords(std::ostream &, const char path[]);
+
+#endif
@@ -0,0 +1,873 @@
+#ifndef SERVER_CPP
+#define SERVER_CPP
+
+#include "server.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define SERVER_MAX_EVENTS 256       ///< events per epoll_wait
+#define SERVER_READ_SIZE 65536      ///< bytes per read
+#define SERVER_BACKLOG 4096         ///< pending connections
+#define SERVER_WAIT_MILLIS 200      ///< epoll_wait timeout (to check for stop)
+#define SERVER_MAX_OUTPUT (1 << 20) ///< pending reply bytes beyond which a connection is not read
+#define SERVER_MAX_INPUT (1 << 20)  ///< pending command bytes beyond which a read stops (until served)
+
+/**
+ * @brief a client connection with its game sessions
+ *
+ */
+struct connection
+{
+    int fd;                            ///< the socket
+    string in, out;                    ///< pending input and output
+    size_t inPos{0};                   ///< first unprocessed input char
+    unordered_map<int, game> sessions; ///< games by session id
+    int nextSession{1};                ///< next session id
+    bool busy{false};                  ///< an AI move is being computed
+    bool closed{false};                ///< to be closed (peer gone or QUIT)
+    bool eof{false};                   ///< the peer sends nothing more (close when the input is served)
+    uint32_t events{EPOLLIN};          ///< the epoll events watched
+};
+
+/**
+ * @brief an AI move request, for the worker pool
+ *
+ */
+struct ai_job
+{
+    connection *c; ///< the requesting connection
+    game *g;       ///< the session game
+};
+
+/**
+ * @brief a completed AI move request
+ *
+ */
+struct ai_done
+{
+    connection *c; ///< the requesting connection
+    string reply;  ///< the reply line
+};
+
+/**
+ * @brief the server data
+ *
+ */
+struct server_state
+{
+    configuration cfg;                          ///< game configuration
+    int epfd{-1}, listenfd{-1}, wakefd{-1};     ///< epoll, listening socket, worker wake up
+    mutex jobsLock;                             ///< protects jobs and stopping
+    condition_variable jobsReady;               ///< signals new jobs
+    deque<ai_job> jobs;                         ///< pending AI moves
+    bool stopping{false};                       ///< workers must exit
+    mutex doneLock;                             ///< protects done
+    vector<ai_done> done;                       ///< completed AI moves
+    unordered_map<int, connection *> conns;     ///< connections by socket
+    unsigned long long sessionsStarted{0};      ///< NEW commands served
+    unsigned long long sessionsEnded{0};        ///< sessions finished or discarded
+    unsigned long long requests{0};             ///< commands served
+};
+
+// set by SIGINT/SIGTERM
+volatile sig_atomic_t serverStopRequested = 0;
+
+void serverStopHandler(int)
+{
+    serverStopRequested = 1;
+}
+
+/**
+ * @brief build a socket address from a port or a Unix socket path
+ *
+ * @param address   the address (a path if it contains '/')
+ * @param sa        the resulting address
+ * @param len       the resulting address length
+ * @return int the address family
+ */
+int serverAddress(const char address[], sockaddr_storage &sa, socklen_t &len)
+{
+    sa = {};
+    if (strchr(address, '/') != nullptr)
+    {
+        sockaddr_un *un = (sockaddr_un *)&sa;
+        un->sun_family = AF_UNIX;
+        strncpy(un->sun_path, address, sizeof(un->sun_path) - 1);
+        len = sizeof(sockaddr_un);
+        return AF_UNIX;
+    }
+    sockaddr_in *in = (sockaddr_in *)&sa;
+    in->sin_family = AF_INET;
+    in->sin_port = htons(atoi(address));
+    in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    len = sizeof(sockaddr_in);
+    return AF_INET;
+}
+
+/**
+ * @brief textual game state: <status> <turn> <winner> <board>
+ *
+ */
+string describeGame(const game &g)
+{
+    static const char *STATUS_NAMES[] = {"RUNNING", "TIMEOUT", "ENDED", "OVER"};
+    string result = STATUS_NAMES[getStatus(g)];
+    result += ' ';
+    result += "XO+-"[getTurn(g)];
+    result += ' ';
+    result += "XO+-"[getWinner(g)];
+    result += ' ';
+    for (square c = getMinCell(g); c <= getMaxCell(g); c++)
+    {
+        result += "XO+."[getCellPlayer(g, c)];
+    }
+    return result;
+}
+
+/**
+ * @brief worker thread: computes AI moves
+ *
+ */
+void serverWorker(server_state &s)
+{
+    for (;;)
+    {
+        ai_job job;
+        {
+            unique_lock<mutex> lock(s.jobsLock);
+            s.jobsReady.wait(lock, [&s] { return s.stopping || !s.jobs.empty(); });
+            if (s.jobs.empty())
+            {
+                return;
+            }
+            job = s.jobs.front();
+            s.jobs.pop_front();
+        }
+        player turn = getTurn(*job.g); // running games only are queued
+        setPlayerEngine(*job.g, turn, turn < NUM_PLAYERS ? s.cfg.engines[turn] : ENGINE_SOLVER);
+        square move = getEngineMove(*job.g);
+        string reply = "ERR move not allowed\n";
+        if (makeMove(*job.g, move))
+        {
+            reply = "OK " + to_string(move - getMinCell(*job.g)) + " " + describeGame(*job.g) + "\n";
+        }
+        {
+            lock_guard<mutex> lock(s.doneLock);
+            s.done.push_back({job.c, reply});
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(s.wakefd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+/**
+ * @brief release a connection (unless an AI move is still being computed)
+ *
+ */
+void serverClose(server_state &s, connection *c)
+{
+    if (!c->closed)
+    {
+        c->closed = true;
+        epoll_ctl(s.epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+        s.conns.erase(c->fd);
+        close(c->fd);
+    }
+    if (!c->busy)
+    {
+        s.sessionsEnded += c->sessions.size();
+        delete c;
+    }
+}
+
+/**
+ * @brief send pending output, waiting for writability if needed
+ *
+ * @return false if the connection has been released
+ */
+bool serverFlush(server_state &s, connection *c)
+{
+    while (!c->out.empty())
+    {
+        ssize_t n = send(c->fd, c->out.data(), c->out.size(), MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            c->out.erase(0, n);
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            serverClose(s, c);
+            return false;
+        }
+    }
+    // no reading after the end of the input, nor while too many commands or unread replies are pending
+    bool wantRead = !c->eof && c->out.size() < SERVER_MAX_OUTPUT && c->in.size() - c->inPos < SERVER_MAX_INPUT;
+    bool wantWrite = !c->out.empty();
+    uint32_t events = (wantRead ? uint32_t(EPOLLIN) : uint32_t(0)) | (wantWrite ? uint32_t(EPOLLOUT) : uint32_t(0));
+    if (events != c->events)
+    {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = c->fd;
+        epoll_ctl(s.epfd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->events = events;
+    }
+    return true;
+}
+
+/**
+ * @brief find the game of a session
+ *
+ * @return game* the game (nullptr if not found)
+ */
+game *serverSession(connection *c, int id)
+{
+    auto found = c->sessions.find(id);
+    return found == c->sessions.end() ? nullptr : &found->second;
+}
+
+/**
+ * @brief execute a command line, appending the reply (if not asynchronous)
+ *
+ * @return false if the connection must be closed
+ */
+bool serverCommand(server_state &s, connection *c, const string &line)
+{
+    istringstream in(line);
+    string cmd;
+    int id = 0;
+    in >> cmd;
+    s.requests++;
+    if (cmd == "NEW")
+    {
+        configuration cfg = s.cfg;
+        int dim = cfg.boardDim;
+        in >> dim;
+        if (dim < MIN_DIM || dim > MAX_DIM)
+        {
+            c->out += "ERR unsupported dimension\n";
+            return true;
+        }
+        cfg.boardDim = dim;
+        id = c->nextSession++;
+        game &g = c->sessions[id] = newGame(cfg);
+        for (player p = 0; p < NUM_PLAYERS; p++)
+        {
+            setPlayerEngine(g, p, ENGINE_REMOTE); // until the AI moves for it
+        }
+        s.sessionsStarted++;
+        c->out += "OK " + to_string(id) + " " + describeGame(g) + "\n";
+    }
+    else if (cmd == "MOVE")
+    {
+        int cell = -1;
+        if (!(in >> id >> cell))
+        {
+            cell = -1; // not a number (a failed read stores 0)
+        }
+        game *g = serverSession(c, id);
+        if (g == nullptr)
+        {
+            c->out += "ERR unknown session\n";
+        }
+        else if (cell < 0 || cell >= getNumCells(*g) || !isAllowedMove(*g, getMinCell(*g) + cell) ||
+                 !makeMove(*g, getMinCell(*g) + cell))
+        {
+            c->out += "ERR move not allowed\n"; // checked before the cell becomes a square
+        }
+        else
+        {
+            c->out += "OK " + describeGame(*g) + "\n";
+        }
+    }
+    else if (cmd == "AI")
+    {
+        in >> id;
+        game *g = serverSession(c, id);
+        if (g == nullptr)
+        {
+            c->out += "ERR unknown session\n";
+        }
+        else if (getStatus(*g) != RUNNING)
+        {
+            c->out += "ERR game over\n";
+        }
+        else
+        {
+            // the reply comes from the worker, later commands wait for it
+            c->busy = true;
+            {
+                lock_guard<mutex> lock(s.jobsLock);
+                s.jobs.push_back({c, g});
+            }
+            s.jobsReady.notify_one();
+        }
+    }
+    else if (cmd == "STATE")
+    {
+        in >> id;
+        game *g = serverSession(c, id);
+        c->out += g == nullptr ? "ERR unknown session\n" : "OK " + describeGame(*g) + "\n";
+    }
+    else if (cmd == "END")
+    {
+        in >> id;
+        if (c->sessions.erase(id) > 0)
+        {
+            s.sessionsEnded++;
+            c->out += "OK\n";
+        }
+        else
+        {
+            c->out += "ERR unknown session\n";
+        }
+    }
+    else if (cmd == "QUIT")
+    {
+        c->out += "OK\n";
+        return false;
+    }
+    else if (!cmd.empty())
+    {
+        c->out += "ERR unknown command\n";
+    }
+    return true;
+}
+
+/**
+ * @brief execute all complete command lines, stopping at AI moves
+ *
+ */
+void serverProcess(server_state &s, connection *c)
+{
+    bool keep = true;
+    size_t eol;
+    while (keep && !c->busy && c->out.size() < SERVER_MAX_OUTPUT && (eol = c->in.find('\n', c->inPos)) != string::npos)
+    {
+        size_t end = eol > c->inPos && c->in[eol - 1] == '\r' ? eol - 1 : eol;
+        keep = serverCommand(s, c, c->in.substr(c->inPos, end - c->inPos));
+        c->inPos = eol + 1;
+    }
+    if (c->in.size() - c->inPos >= SERVER_MAX_INPUT && c->in.find('\n', c->inPos) == string::npos)
+    {
+        keep = false; // a line too long to be a command
+    }
+    if (c->inPos > 0 && (c->inPos == c->in.size() || c->inPos > SERVER_READ_SIZE))
+    {
+        c->in.erase(0, c->inPos);
+        c->inPos = 0;
+    }
+    if (serverFlush(s, c) && (!keep || (c->eof && !c->busy && c->out.empty())))
+    {
+        serverClose(s, c); // after QUIT, or once the replies to a half-closed peer are sent
+    }
+}
+
+/**
+ * @brief accept all pending connections
+ *
+ */
+void serverAccept(server_state &s)
+{
+    int fd;
+    while ((fd = accept4(s.listenfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // fails harmlessly on Unix sockets
+        connection *c = new connection;
+        c->fd = fd;
+        s.conns[fd] = c;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(s.epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/**
+ * @brief read from a connection and execute its commands
+ *
+ */
+void serverRead(server_state &s, connection *c)
+{
+    char buffer[SERVER_READ_SIZE];
+    while (c->in.size() - c->inPos < SERVER_MAX_INPUT)
+    {
+        ssize_t n = recv(c->fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            c->in.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n == 0 && !c->eof)
+        {
+            c->eof = true; // the commands already received are still served
+            break;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            serverClose(s, c);
+            return;
+        }
+        break;
+    }
+    serverProcess(s, c);
+}
+
+/**
+ * @brief deliver the AI moves computed by the workers
+ *
+ */
+void serverCompleted(server_state &s)
+{
+    uint64_t count;
+    ssize_t ignored = read(s.wakefd, &count, sizeof(count));
+    (void)ignored;
+    vector<ai_done> done;
+    {
+        lock_guard<mutex> lock(s.doneLock);
+        done.swap(s.done);
+    }
+    for (ai_done &d : done)
+    {
+        d.c->busy = false;
+        if (d.c->closed)
+        {
+            serverClose(s, d.c);
+        }
+        else
+        {
+            d.c->out += d.reply;
+            serverProcess(s, d.c);
+        }
+    }
+}
+
+/**
+ * @brief Run the server until SIGINT/SIGTERM
+ *
+ * @param address   a loopback TCP port or a Unix socket path (containing '/')
+ * @param workers   number of threads computing AI moves
+ * @return int the exit code
+ */
+int runServer(const configuration &c, const char address[], int workers)
+{
+    server_state s;
+    s.cfg = c;
+    s.cfg.interactive = false;
+    if (s.cfg.boardDim < MIN_DIM || s.cfg.boardDim > MAX_DIM)
+    {
+        cerr << "Invalid board dimension " << s.cfg.boardDim << endl;
+        return 1;
+    }
+    sockaddr_storage sa;
+    socklen_t len;
+    int family = serverAddress(address, sa, len);
+    if (family == AF_UNIX)
+    {
+        unlink(address);
+    }
+    s.listenfd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(s.listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (s.listenfd < 0 || bind(s.listenfd, (sockaddr *)&sa, len) < 0 || listen(s.listenfd, SERVER_BACKLOG) < 0)
+    {
+        perror("server");
+        return 1;
+    }
+    cout << "Solving " << s.cfg.boardDim << "x" << s.cfg.boardDim << " positions..." << endl;
+    if (s.cfg.boardDim == 4 && solverPlays(s.cfg))
+    {
+        initAI();
+    }
+    s.epfd = epoll_create1(EPOLL_CLOEXEC);
+    s.wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = s.listenfd;
+    epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.listenfd, &ev);
+    ev.data.fd = s.wakefd;
+    epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.wakefd, &ev);
+    signal(SIGINT, serverStopHandler);
+    signal(SIGTERM, serverStopHandler);
+    signal(SIGPIPE, SIG_IGN);
+    if (workers < 1)
+    {
+        workers = 1;
+    }
+    vector<thread> pool;
+    for (int i = 0; i < workers; i++)
+    {
+        pool.emplace_back(serverWorker, ref(s));
+    }
+    cout << "Listening on " << address << " with " << workers << " workers" << endl;
+    TimePoint start = theClock.now();
+    epoll_event events[SERVER_MAX_EVENTS];
+    while (!serverStopRequested)
+    {
+        int n = epoll_wait(s.epfd, events, SERVER_MAX_EVENTS, SERVER_WAIT_MILLIS);
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == s.listenfd)
+            {
+                serverAccept(s);
+            }
+            else if (fd == s.wakefd)
+            {
+                serverCompleted(s);
+            }
+            else
+            {
+                auto found = s.conns.find(fd);
+                if (found == s.conns.end())
+                {
+                    continue; // closed while handling a previous event
+                }
+                connection *conn = found->second;
+                if (events[i].events & EPOLLOUT)
+                {
+                    serverProcess(s, conn); // sends, then serves the commands waiting for room
+                    if (s.conns.count(fd) == 0)
+                    {
+                        continue;
+                    }
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    serverRead(s, conn);
+                }
+            }
+        }
+    }
+    Duration elapsed = theClock.now() - start;
+    {
+        lock_guard<mutex> lock(s.jobsLock);
+        s.stopping = true;
+    }
+    s.jobsReady.notify_all();
+    for (thread &t : pool)
+    {
+        t.join();
+    }
+    serverCompleted(s);
+    while (!s.conns.empty())
+    {
+        serverClose(s, s.conns.begin()->second);
+    }
+    close(s.wakefd);
+    close(s.epfd);
+    close(s.listenfd);
+    if (family == AF_UNIX)
+    {
+        unlink(address);
+    }
+    cout << "\nServed " << s.requests << " requests, " << s.sessionsStarted << " sessions in "
+         << elapsed.count() << " s (" << s.sessionsStarted / elapsed.count() << " sessions/s)\n\n";
+    printLatencyReport(cout);
+    printSolverReport(cout);
+    return 0;
+}
+
+// Load test ===================================================================
+
+#define BENCH_LOOPS 4 ///< client event loops (threads); each drives its share of the connections
+
+/**
+ * @brief the request a load test client waits the reply of
+ *
+ */
+enum bench_request
+{
+    BENCH_NEW,  ///< a new session
+    BENCH_MOVE, ///< a move (random or AI)
+    BENCH_END   ///< the end of the session
+};
+
+/**
+ * @brief a client connection, as a state machine: a request in flight at a time
+ *
+ */
+struct bench_client
+{
+    int fd{-1};                       ///< the socket (nonblocking)
+    string in, out;                   ///< received, not yet consumed; to be sent
+    bench_request waiting{BENCH_NEW}; ///< the request in flight
+    int id{0};                        ///< session id
+    string status, board;             ///< session state, from the last reply
+    char turn{'-'};                   ///< symbol to move
+    int dim{0};                       ///< board dimension
+    int moveNumber{0};                ///< moves done when the request was sent
+    TimePoint sent;                   ///< when the request was sent
+    bool watchOut{false};             ///< EPOLLOUT watched (the request not all sent)
+};
+
+/**
+ * @brief the counters of a load test (shared by the loops)
+ *
+ */
+struct bench_totals
+{
+    atomic<unsigned long long> games{0}, requests{0};
+    atomic<int> errors{0};
+};
+
+/**
+ * @brief send what is pending (watching EPOLLOUT while something is left)
+ *
+ * @return false on connection errors
+ */
+bool benchSend(int epfd, bench_client &c)
+{
+    while (!c.out.empty())
+    {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        c.out.erase(0, n);
+    }
+    if (c.watchOut != !c.out.empty())
+    {
+        c.watchOut = !c.out.empty();
+        epoll_event ev{};
+        ev.events = uint32_t(EPOLLIN) | (c.watchOut ? uint32_t(EPOLLOUT) : uint32_t(0));
+        ev.data.ptr = &c;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+    return true;
+}
+
+/**
+ * @brief send the next request: a random move for X, an AI move for O, END at game over
+ *
+ */
+bool benchNext(int epfd, bench_client &c, mt19937 &rng)
+{
+    c.waiting = BENCH_END;
+    c.out = "END " + to_string(c.id) + "\n";
+    if (c.status == "RUNNING")
+    {
+        c.waiting = BENCH_MOVE;
+        c.out = "AI " + to_string(c.id) + "\n";
+        if (c.turn == 'X')
+        {
+            vector<int> empty;
+            for (size_t i = 0; i < c.board.size(); i++)
+            {
+                if (c.board[i] == '.')
+                {
+                    empty.push_back(i);
+                }
+            }
+            c.out = "MOVE " + to_string(c.id) + " " + to_string(empty[rng() % empty.size()]) + "\n";
+        }
+        c.moveNumber = c.board.size() - count(c.board.begin(), c.board.end(), '.');
+    }
+    c.sent = theClock.now();
+    return benchSend(epfd, c);
+}
+
+/**
+ * @brief handle a reply line
+ *
+ * @return false if the client is done (error, or the test is over)
+ */
+bool benchReply(int epfd, bench_client &c, const string &reply, TimePoint deadline, mt19937 &rng, bench_totals &t)
+{
+    istringstream in(reply);
+    string ok;
+    char winner;
+    int cell;
+    switch (c.waiting)
+    {
+    case BENCH_NEW:
+        in >> ok >> c.id >> c.status >> c.turn >> winner >> c.board;
+        for (c.dim = 1; c.dim * c.dim < int(c.board.size()); c.dim++)
+        {
+        }
+        break;
+    case BENCH_MOVE:
+        if (reply.compare(0, 2, "OK") != 0)
+        {
+            t.errors++;
+            return false;
+        }
+        recordLatency(LAT_SERVER_REQUEST, c.dim, c.moveNumber, Duration(theClock.now() - c.sent).count());
+        t.requests++;
+        in >> ok;
+        if (c.turn != 'X')
+        {
+            in >> cell; // the AI move (not needed)
+        }
+        in >> c.status >> c.turn >> winner >> c.board;
+        break;
+    case BENCH_END:
+        t.games++;
+        if (theClock.now() >= deadline)
+        {
+            return false;
+        }
+        c.waiting = BENCH_NEW;
+        c.out = "NEW\n";
+        return benchSend(epfd, c);
+    }
+    return benchNext(epfd, c, rng);
+}
+
+/**
+ * @brief a client event loop: its connections play random vs AI games until the deadline
+ *
+ */
+void benchLoop(const char address[], int clients, TimePoint deadline, bench_totals &t)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    vector<bench_client> conns(clients);
+    mt19937 rng(random_device{}());
+    int active = 0;
+    for (bench_client &c : conns)
+    {
+        sockaddr_storage sa;
+        socklen_t len;
+        c.fd = socket(serverAddress(address, sa, len), SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (c.fd < 0 || connect(c.fd, (sockaddr *)&sa, len) < 0)
+        {
+            t.errors++;
+            continue;
+        }
+        int one = 1;
+        setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(c.fd, F_SETFL, fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &c;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+        c.out = "NEW\n";
+        if (!benchSend(epfd, c))
+        {
+            t.errors++;
+            continue;
+        }
+        active++;
+    }
+    epoll_event events[SERVER_MAX_EVENTS];
+    while (active > 0)
+    {
+        int n = epoll_wait(epfd, events, SERVER_MAX_EVENTS, -1);
+        if (n < 0 && errno != EINTR)
+        {
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            bench_client &c = *(bench_client *)events[i].data.ptr;
+            bool keep = benchSend(epfd, c);
+            char chunk[4096];
+            ssize_t got = -1;
+            while (keep && (got = recv(c.fd, chunk, sizeof(chunk), 0)) > 0)
+            {
+                c.in.append(chunk, got);
+            }
+            keep = keep && got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            if (!keep)
+            {
+                t.errors++; // the server closed or failed
+            }
+            size_t eol;
+            while (keep && (eol = c.in.find('\n')) != string::npos)
+            {
+                string reply = c.in.substr(0, eol);
+                c.in.erase(0, eol + 1);
+                keep = benchReply(epfd, c, reply, deadline, rng, t); // false when done too
+            }
+            if (!keep)
+            {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+                close(c.fd);
+                c.fd = -1;
+                active--;
+            }
+        }
+    }
+    for (bench_client &c : conns)
+    {
+        if (c.fd >= 0)
+        {
+            close(c.fd);
+        }
+    }
+    close(epfd);
+}
+
+/**
+ * @brief Load the server with concurrent clients playing random vs AI games
+ *
+ * The connections are driven by a few epoll loops (not a thread each), so
+ * thousands of clients measure the server rather than the client threads.
+ *
+ * @param address   the server address (as in runServer)
+ * @param clients   number of concurrent connections
+ * @param seconds   duration of the test
+ * @return int the exit code
+ */
+int runServerBench(const char address[], int clients, double seconds)
+{
+    bench_totals t;
+    TimePoint start = theClock.now();
+    TimePoint deadline = start + chrono::duration_cast<Clock::duration>(Duration(seconds));
+    int loops = min(clients, BENCH_LOOPS);
+    vector<thread> pool;
+    for (int i = 0; i < loops; i++)
+    {
+        // clients split as evenly as possible
+        pool.emplace_back(benchLoop, address, clients / loops + (i < clients % loops), deadline, ref(t));
+    }
+    for (thread &th : pool)
+    {
+        th.join();
+    }
+    Duration elapsed = theClock.now() - start;
+    cout << clients << " clients (" << loops << " loops), " << elapsed.count() << " s: " << t.games << " sessions ("
+         << t.games / elapsed.count() << " sessions/s), " << t.requests << " moves ("
+         << t.requests / elapsed.count() << " moves/s), " << t.errors << " errors\n\n";
+    printLatencyReport(cout);
+    return t.errors == 0 ? 0 : 1;
+}
+
+#endif
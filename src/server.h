@@ -0,0 +1,41 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+// The game server =============================================================
+/**
+ * Modalità server: molte partite (sessioni) gestite da un unico processo,
+ * con un event loop epoll che legge i comandi ed un pool di thread che
+ * calcola le mosse del computer; tutte le sessioni condividono la stessa
+ * tabella delle posizioni risolte.
+ *
+ * Protocollo a righe (una risposta per comando, nello stesso ordine):
+ *  NEW [dim]       -> OK <id> <state>
+ *  MOVE <id> <c>   -> OK <state>        (c = cell number, 0 based)
+ *  AI <id>         -> OK <c> <state>    (computer move, made in the game)
+ *  STATE <id>      -> OK <state>
+ *  END <id>        -> OK
+ *  QUIT            -> OK (connection closed)
+ * dove <state> = <status> <turn> <winner> <board>, ad es. "RUNNING X - X..O"
+ * Gli errori sono segnalati con "ERR <reason>".
+ */
+
+/**
+ * @brief Run the server until SIGINT/SIGTERM
+ *
+ * @param address   a loopback TCP port or a Unix socket path (containing '/')
+ * @param workers   number of threads computing AI moves
+ * @return int the exit code
+ */
+int runServer(const configuration &, const char address[], int workers);
+
+/**
+ * @brief Load the server with concurrent clients playing random vs AI games
+ *
+ * @param address   the server address (as in runServer)
+ * @param clients   number of concurrent connections
+ * @param seconds   duration of the test
+ * @return int the exit code
+ */
+int runServerBench(const char address[], int clients, double seconds);
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef SYMMETRY_CPP
+#define SYMMETRY_CPP
+
+#include "symmetry.h"
+#include <immintrin.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Get the cell a transform moves a cell to
+ *
+ * @param t     the transform (0 = identity)
+ * @return int the image cell
+ */
+int symmetricCell(const symmetry_tables &s, int t, int cell)
+{
+    int row = cell / s.dim, col = cell % s.dim;
+    if (t & 1)
+    {
+        std::swap(row, col);
+    }
+    if (t & 2)
+    {
+        row = s.dim - 1 - row;
+    }
+    if (t & 4)
+    {
+        col = s.dim - 1 - col;
+    }
+    return row * s.dim + col;
+}
+
+/**
+ * @brief Compute the transforms of a board dimension
+ *
+ * @param dim   the board dimension (dim * dim * 2 <= 32)
+ */
+void initSymmetries(symmetry_tables &s, int dim)
+{
+    memset((void *)&s, 0, sizeof(s));
+    s.dim = dim;
+    int numCells = dim * dim;
+    for (int t = 0; t < NUM_SYMMETRIES; t++)
+    {
+        // bit permutation: both halves move the same way
+        int target[32];
+        for (int bit = 0; bit < 2 * numCells; bit++)
+        {
+            target[bit] = symmetricCell(s, t, bit % numCells) + (bit / numCells) * numCells;
+        }
+        for (int cell = 0; cell < numCells; cell++)
+        {
+            if (target[cell] < cell)
+            {
+                s.lowering[t] |= uint32_t(1) << cell;
+            }
+        }
+        for (int byte = 0; byte < SYM_BYTES; byte++)
+        {
+            for (int value = 0; value < 256; value++)
+            {
+                uint32_t image = 0;
+                for (int i = 0; i < 8; i++)
+                {
+                    int bit = byte * 8 + i;
+                    if ((value >> i & 1) && bit < 2 * numCells)
+                    {
+                        image |= uint32_t(1) << target[bit];
+                    }
+                }
+                s.images[byte][value][t] = image;
+            }
+        }
+        // split in order preserving chains: the first chain whose last target is lower
+        int last[SYM_MAX_CHAINS];
+        for (int bit = 0; bit < 2 * numCells; bit++)
+        {
+            int k = 0;
+            while (k < s.numChains[t] && last[k] > target[bit])
+            {
+                k++;
+            }
+            if (k == s.numChains[t])
+            {
+                s.numChains[t]++;
+            }
+            s.chains[t][k].from |= uint32_t(1) << bit;
+            s.chains[t][k].to |= uint32_t(1) << target[bit];
+            last[k] = target[bit];
+        }
+    }
+    s.bmi2 = __builtin_cpu_supports("bmi2");
+}
+
+/**
+ * @brief a transform by pext/pdep (only if the processor has BMI2)
+ *
+ */
+__attribute__((target("bmi2"))) uint32_t pextImage(const symmetry_tables &s, int t, uint32_t c)
+{
+    uint32_t image = 0;
+    for (int k = 0; k < s.numChains[t]; k++)
+    {
+        image |= _pdep_u32(_pext_u32(c, s.chains[t][k].from), s.chains[t][k].to);
+    }
+    return image;
+}
+
+/**
+ * @brief all the transforms by pext/pdep (only if the processor has BMI2)
+ *
+ */
+__attribute__((target("bmi2"))) void pextImages(const symmetry_tables &s, uint32_t c, uint32_t images[NUM_SYMMETRIES])
+{
+    for (int t = 0; t < NUM_SYMMETRIES; t++)
+    {
+        images[t] = pextImage(s, t, c);
+    }
+}
+
+/**
+ * @brief all the transforms by byte tables
+ *
+ */
+inline void tableImages(const symmetry_tables &s, uint32_t c, uint32_t images[NUM_SYMMETRIES])
+{
+    const uint32_t *b0 = s.images[0][c & 0xFF], *b1 = s.images[1][(c >> 8) & 0xFF];
+    const uint32_t *b2 = s.images[2][(c >> 16) & 0xFF], *b3 = s.images[3][c >> 24];
+    for (int t = 0; t < NUM_SYMMETRIES; t++)
+    {
+        images[t] = b0[t] | b1[t] | b2[t] | b3[t];
+    }
+}
+
+/**
+ * @brief Get the image of a configuration under a transform
+ *
+ * @param t     the transform (0 = identity)
+ * @return uint32_t the image
+ */
+uint32_t symmetricImage(const symmetry_tables &s, int t, uint32_t c)
+{
+    // byte tables: pext/pdep needs a few dependent steps per transform (see runSymmetryBench)
+    return s.images[0][c & 0xFF][t] | s.images[1][(c >> 8) & 0xFF][t] | s.images[2][(c >> 16) & 0xFF][t] |
+           s.images[3][c >> 24][t];
+}
+
+/**
+ * @brief Get the images of a configuration under all the transforms
+ *
+ * @param images    the images (images[0] = c)
+ */
+void symmetricImages(const symmetry_tables &s, uint32_t c, uint32_t images[NUM_SYMMETRIES])
+{
+    tableImages(s, c, images); // 4 loads for the 8 images
+}
+
+/**
+ * @brief Get the canonical representative of a configuration (the least image)
+ *
+ * @return uint32_t the representative
+ */
+uint32_t canonicalConfig(const symmetry_tables &s, uint32_t c)
+{
+    uint32_t images[NUM_SYMMETRIES];
+    symmetricImages(s, c, images);
+    uint32_t result = images[0];
+    for (int t = 1; t < NUM_SYMMETRIES; t++)
+    {
+        result = std::min(result, images[t]);
+    }
+    return result;
+}
+
+/**
+ * @brief Get the cells representing the orbits of some cells under the
+ * transforms leaving a configuration unchanged (its stabilizer)
+ *
+ * A cell is the lowest of its orbit if no transform of the (group)
+ * stabilizer moves it to a lower cell.
+ *
+ * @param c     the configuration
+ * @param cells the cells (as bits 0 .. dim * dim - 1)
+ * @return uint32_t the lowest cell of each orbit
+ */
+uint32_t distinctCells(const symmetry_tables &s, uint32_t c, uint32_t cells)
+{
+    uint32_t images[NUM_SYMMETRIES];
+    tableImages(s, c, images);
+    for (int t = 1; t < NUM_SYMMETRIES; t++)
+    {
+        if (images[t] == c)
+        {
+            cells &= ~s.lowering[t];
+        }
+    }
+    return cells;
+}
+
+// Hand-written 4x4 transforms (reference for the benchmark) ===================
+
+// Reverse row tranform assuming DIM = 4
+// IN:  3333222211110000 3333222211110000
+// OUT: 0000111122223333 0000111122223333
+inline uint32_t RR4(uint32_t c)
+{
+#define RR4_LOW8_MASK ((uint32_t)0x00FF00FF)
+#define RR4_HIGH8_MASK ((uint32_t)0xFF00FF00)
+#define RR4_LOW4_MASK ((uint32_t)0x0F0F0F0F)
+#define RR4_HIGH4_MASK ((uint32_t)0xF0F0F0F0)
+    // h:  1111000033332222 1111000033332222
+    uint32_t h = ((c & RR4_LOW8_MASK) << 8) | ((c & RR4_HIGH8_MASK) >> 8);
+    // return:  0000111122223333 0000111122223333
+    return ((h & RR4_LOW4_MASK) << 4) | ((h & RR4_HIGH4_MASK) >> 4);
+}
+
+// Reverse column tranform assuming DIM = 4
+// IN:  3210321032103210 3210321032103210
+// OUT: 0123012301230123 0123012301230123
+inline uint32_t RC4(uint32_t c)
+{
+#define RC4_LOW8_MASK ((uint32_t)0x33333333)
+#define RC4_HIGH8_MASK ((uint32_t)0xCCCCCCCC)
+#define RC4_HIGH4_MASK ((uint32_t)0xAAAAAAAA)
+#define RC4_LOW4_MASK ((uint32_t)0x55555555)
+    // h:  1032103210321032 1032103210321032
+    uint32_t h = ((c & RC4_LOW8_MASK) << 2) | ((c & RC4_HIGH8_MASK) >> 2);
+    // return:  0123012301230123 0123012301230123
+    return ((h & RC4_LOW4_MASK) << 1) | ((h & RC4_HIGH4_MASK) >> 1);
+}
+
+// Exchange row/column tranform assuming DIM = 4
+// IN:  FEDCBA9876543210 FEDCBA9876543210
+// OUT: FB73EA62D951C840 FB73EA62D951C840
+inline uint32_t X4(uint32_t c)
+{
+#define X4_NO_SHIFT ((uint32_t)0x84218421)
+#define X4_SHIFT_P3 ((uint32_t)0x08420842)
+#define X4_SHIFT_P6 ((uint32_t)0x00840084)
+#define X4_SHIFT_P9 ((uint32_t)0x00080008)
+#define X4_SHIFT_M3 ((uint32_t)0x42104210)
+#define X4_SHIFT_M6 ((uint32_t)0x21002100)
+#define X4_SHIFT_M9 ((uint32_t)0x10001000)
+    uint32_t r = (c & X4_NO_SHIFT) |
+                 ((c & X4_SHIFT_P3) << 3) |
+                 ((c & X4_SHIFT_M3) >> 3) |
+                 ((c & X4_SHIFT_P6) << 6) |
+                 ((c & X4_SHIFT_M6) >> 6) |
+                 ((c & X4_SHIFT_P9) << 9) |
+                 ((c & X4_SHIFT_M9) >> 9);
+    return r;
+}
+
+/**
+ * @brief all the 4x4 transforms by the hand-written shifts
+ *
+ */
+inline void shiftImages4(uint32_t c0, uint32_t images[NUM_SYMMETRIES])
+{
+    images[0] = c0;
+    images[1] = X4(c0);
+    images[2] = RR4(c0);
+    images[3] = RR4(images[1]);
+    images[4] = RC4(c0);
+    images[5] = RC4(images[1]);
+    images[6] = RC4(images[2]);
+    images[7] = RC4(images[3]);
+}
+
+volatile uint32_t symmetryBenchSink; ///< keeps the benchmark results alive
+
+/**
+ * @brief time a way of computing the 8 images of many configurations
+ *
+ * @param images    computes the images of a configuration
+ * @return double millions of images per second
+ */
+template <typename F>
+double benchImages(const std::vector<uint32_t> &configs, double seconds, F images)
+{
+    unsigned long long done = 0;
+    uint32_t sum = 0, result[NUM_SYMMETRIES];
+    TimePoint start = theClock.now();
+    double elapsed;
+    do
+    {
+        for (uint32_t c : configs)
+        {
+            images(c, result);
+            uint32_t least = result[0];
+            for (int t = 1; t < NUM_SYMMETRIES; t++)
+            {
+                least = std::min(least, result[t]);
+            }
+            sum ^= least;
+        }
+        done += configs.size();
+        elapsed = Duration(theClock.now() - start).count();
+    } while (elapsed < seconds);
+    symmetryBenchSink = sum;
+    return done * NUM_SYMMETRIES / elapsed / 1e6;
+}
+
+/**
+ * @brief Benchmark the transforms: byte tables, pext/pdep and 4x4 shifts
+ *
+ * @param seconds   duration of each run
+ * @return int the exit code (not 0 if the methods disagree)
+ */
+int runSymmetryBench(double seconds)
+{
+    static symmetry_tables s;
+    std::mt19937 rng(1);
+    int errors = 0;
+    cout << "Symmetry transforms (million images/s), BMI2 "
+         << (__builtin_cpu_supports("bmi2") ? "available" : "not available") << '\n';
+    cout << "dim   byte tables   pext/pdep   4x4 shifts   pext steps\n";
+    for (int dim = 3; dim <= 4; dim++)
+    {
+        initSymmetries(s, dim);
+        int numCells = dim * dim;
+        // random positions: disjoint cells for the two players
+        std::vector<uint32_t> configs(1 << 16);
+        for (uint32_t &c : configs)
+        {
+            uint32_t mine = rng() & ((1u << numCells) - 1), other = rng() & ((1u << numCells) - 1) & ~mine;
+            c = mine | other << numCells;
+        }
+        // all the methods agree with the cell map
+        for (uint32_t c : configs)
+        {
+            uint32_t byTable[NUM_SYMMETRIES], byPext[NUM_SYMMETRIES], byShift[NUM_SYMMETRIES];
+            tableImages(s, c, byTable);
+            if (s.bmi2)
+            {
+                pextImages(s, c, byPext);
+            }
+            if (dim == 4)
+            {
+                shiftImages4(c, byShift);
+            }
+            for (int t = 0; t < NUM_SYMMETRIES; t++)
+            {
+                uint32_t expected = 0;
+                for (int bit = 0; bit < 2 * numCells; bit++)
+                {
+                    if (c >> bit & 1)
+                    {
+                        expected |= uint32_t(1) << (symmetricCell(s, t, bit % numCells) + bit / numCells * numCells);
+                    }
+                }
+                errors += byTable[t] != expected || (s.bmi2 && byPext[t] != expected) ||
+                          (dim == 4 && byShift[t] != expected);
+            }
+        }
+        double rates[3] = {};
+        rates[0] = benchImages(configs, seconds, [](uint32_t c, uint32_t *r) { tableImages(s, c, r); });
+        if (s.bmi2)
+        {
+            rates[1] = benchImages(configs, seconds, [](uint32_t c, uint32_t *r) { pextImages(s, c, r); });
+        }
+        if (dim == 4)
+        {
+            rates[2] = benchImages(configs, seconds, shiftImages4);
+        }
+        int steps = 0;
+        for (int t = 0; t < NUM_SYMMETRIES; t++)
+        {
+            steps += s.numChains[t];
+        }
+        cout << fixed << setprecision(1) << setw(3) << dim << setw(14) << rates[0] << setw(12) << rates[1]
+             << setw(13) << rates[2] << setw(13) << steps << defaultfloat << '\n'; // 0 = not available
+    }
+    cout << (errors == 0 ? "All methods agree" : "Methods DISAGREE") << endl;
+    return errors == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+// The board symmetries ========================================================
+/**
+ * Le 8 simmetrie del quadrato (rotazioni e riflessioni) applicate alle
+ * configurazioni della scacchiera di qualsiasi dimensione: ogni simmetria è
+ * una permutazione dei bit, calcolata una volta per dimensione in due forme,
+ * tabelle per byte (le 8 immagini con una lettura per byte, usate dal
+ * risolutore) e sequenze pext/pdep (istruzioni BMI2, se il processore le ha),
+ * confrontate dal benchmark con le trasformazioni 4x4 scritte a mano.
+ * Le celle sono numerate per righe (cella = riga * dim + colonna), ripetute
+ * nelle due metà della configurazione.
+ */
+
+#include <cstdint>
+
+#define NUM_SYMMETRIES 8 ///< transforms of the square (identity included)
+#define SYM_BYTES 4      ///< bytes of a configuration
+#define SYM_MAX_CHAINS 32 ///< max pext/pdep steps of a transform
+
+/**
+ * @brief the transforms of a board dimension
+ *
+ * Transform t applies, in order: transpose (t & 1), reverse the rows
+ * (t & 2), reverse the columns (t & 4).
+ */
+struct symmetry_tables
+{
+    int dim;                                                ///< board dimension
+    uint32_t images[SYM_BYTES][256][NUM_SYMMETRIES];        ///< images of each byte value, by byte position
+    struct
+    {
+        uint32_t from, to;                                  ///< pext source and pdep target masks
+    } chains[NUM_SYMMETRIES][SYM_MAX_CHAINS];               ///< order preserving parts of each transform
+    int numChains[NUM_SYMMETRIES];                          ///< pext/pdep steps of each transform
+    uint32_t lowering[NUM_SYMMETRIES];                      ///< cells moved to a lower cell by each transform
+    bool bmi2;                                              ///< whether pext/pdep are available (benchmark)
+};
+
+/**
+ * @brief Compute the transforms of a board dimension
+ *
+ * @param dim   the board dimension (dim * dim * 2 <= 32)
+ */
+void initSymmetries(symmetry_tables &, int dim);
+
+/**
+ * @brief Get the cell a transform moves a cell to
+ *
+ * @param t     the transform (0 = identity)
+ * @return int the image cell
+ */
+int symmetricCell(const symmetry_tables &, int t, int cell);
+
+/**
+ * @brief Get the image of a configuration under a transform
+ *
+ * @param t     the transform (0 = identity)
+ * @return uint32_t the image
+ */
+uint32_t symmetricImage(const symmetry_tables &, int t, uint32_t c);
+
+/**
+ * @brief Get the images of a configuration under all the transforms
+ *
+ * @param images    the images (images[0] = c)
+ */
+void symmetricImages(const symmetry_tables &, uint32_t c, uint32_t images[NUM_SYMMETRIES]);
+
+/**
+ * @brief Get the canonical representative of a configuration (the least image)
+ *
+ * @return uint32_t the representative
+ */
+uint32_t canonicalConfig(const symmetry_tables &, uint32_t c);
+
+/**
+ * @brief Get the cells representing the orbits of some cells under the
+ * transforms leaving a configuration unchanged (its stabilizer)
+ *
+ * Moves to cells of the same orbit lead to symmetric positions, so only the
+ * lowest cell of each orbit needs to be tried.
+ *
+ * @param c     the configuration
+ * @param cells the cells (as bits 0 .. dim * dim - 1)
+ * @return uint32_t the lowest cell of each orbit
+ */
+uint32_t distinctCells(const symmetry_tables &, uint32_t c, uint32_t cells);
+
+/**
+ * @brief Benchmark the transforms: byte tables, pext/pdep and 4x4 shifts
+ *
+ * @param seconds   duration of each run
+ * @return int the exit code (not 0 if the methods disagree)
+ */
+int runSymmetryBench(double seconds);
+
+#endif
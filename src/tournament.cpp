@@ -0,0 +1,323 @@
+#ifndef TOURNAMENT_CPP
+#define TOURNAMENT_CPP
+
+#include "tournament.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define TOURNAMENT_ALL 0           ///< results index of all the board dimensions
+#define TOURNAMENT_PROGRESS 100ms  ///< between progress lines
+#define ELO_SCALE (400 / M_LN10)   ///< Elo points per unit of log strength
+#define ELO_Z95 1.96               ///< 95% confidence interval, in standard errors
+#define ELO_ITERATIONS 10000       ///< max rating updates
+#define ELO_PRECISION 1e-9         ///< rating updates stop below this change (log strength)
+
+/**
+ * @brief a scheduled game
+ *
+ */
+struct tournament_game
+{
+    engine_kind engines[NUM_PLAYERS]; ///< of X and O
+    int dim;                          ///< board dimension
+    player first;                     ///< player making the first move
+};
+
+/**
+ * @brief the results of some games
+ *
+ */
+struct tournament_results
+{
+    unsigned games[NUM_ENGINE_KINDS][NUM_ENGINE_KINDS]{}; ///< games between two engines
+    double points[NUM_ENGINE_KINDS][NUM_ENGINE_KINDS]{};  ///< of the first engine (win 1, draw 1/2)
+    vector<double> think[NUM_ENGINE_KINDS];               ///< seconds per move
+};
+
+/**
+ * @brief the tournament data, shared by the players
+ *
+ */
+struct tournament_state
+{
+    configuration cfg;                       ///< game settings
+    vector<tournament_game> games;           ///< the schedule
+    atomic<size_t> next{0};                  ///< next game to be played
+    atomic<size_t> played{0};                ///< ended games
+    mutex lock;                              ///< guards results
+    tournament_results results[MAX_DIM + 1]; ///< by board dimension (and all of them)
+};
+
+/**
+ * @brief add some results to others
+ *
+ */
+void addResults(tournament_results &to, const tournament_results &from)
+{
+    for (int a = 0; a < NUM_ENGINE_KINDS; a++)
+    {
+        for (int b = 0; b < NUM_ENGINE_KINDS; b++)
+        {
+            to.games[a][b] += from.games[a][b];
+            to.points[a][b] += from.points[a][b];
+        }
+        to.think[a].insert(to.think[a].end(), from.think[a].begin(), from.think[a].end());
+    }
+}
+
+/**
+ * @brief play the scheduled games until none is left
+ *
+ */
+void tournamentPlayer(tournament_state &s)
+{
+    tournament_results mine[MAX_DIM + 1];
+    for (size_t i = s.next++; i < s.games.size(); i = s.next++)
+    {
+        const tournament_game &t = s.games[i];
+        configuration c = s.cfg;
+        c.boardDim = t.dim;
+        game g = newGame(c);
+        setFirstPlayer(g, t.first);
+        for (player p = 0; p < NUM_PLAYERS; p++)
+        {
+            setPlayerEngine(g, p, t.engines[p]);
+        }
+        tournament_results &r = mine[t.dim];
+        while (getStatus(g) == RUNNING)
+        {
+            engine_kind e = t.engines[getTurn(g)];
+            TimePoint start = theClock.now();
+            square move = getEngineMove(g);
+            r.think[e].push_back(Duration(theClock.now() - start).count());
+            makeMove(g, move);
+        }
+        double pointsX = getWinner(g) == 0 ? 1 : getWinner(g) == 1 ? 0 : 0.5;
+        engine_kind x = t.engines[0], o = t.engines[1];
+        r.games[x][o]++;
+        r.games[o][x]++;
+        r.points[x][o] += pointsX;
+        r.points[o][x] += 1 - pointsX;
+        s.played++;
+    }
+    lock_guard<mutex> guard(s.lock);
+    for (int dim = MIN_DIM; dim <= MAX_DIM; dim++)
+    {
+        addResults(s.results[dim], mine[dim]);
+        addResults(s.results[TOURNAMENT_ALL], mine[dim]);
+    }
+}
+
+/**
+ * @brief rate the engines (Bradley-Terry model, by minorization-maximization)
+ *
+ * A draw is half a win for both engines; every pair also gets a virtual
+ * draw, so that an engine winning or losing every game keeps a finite rating.
+ *
+ * @param engines   the engines (at least two)
+ * @param elo       by engine: the rating, average 0 (set)
+ * @param error     by engine: half width of the 95% confidence interval (set)
+ */
+void tournamentElo(const tournament_results &r, const vector<engine_kind> &engines, double elo[], double error[])
+{
+    size_t n = engines.size();
+    vector<double> strength(n, 1);
+    for (int iteration = 0; iteration < ELO_ITERATIONS; iteration++)
+    {
+        double change = 0, logSum = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            double wins = 0, sum = 0;
+            for (size_t j = 0; j < n; j++)
+            {
+                if (j != i)
+                {
+                    wins += r.points[engines[i]][engines[j]] + 0.5;
+                    sum += (r.games[engines[i]][engines[j]] + 1) / (strength[i] + strength[j]);
+                }
+            }
+            change = max(change, fabs(log(wins / sum / strength[i])));
+            strength[i] = wins / sum;
+            logSum += log(strength[i]);
+        }
+        for (double &s : strength)
+        {
+            s /= exp(logSum / n); // ratings are relative: keep them centered
+        }
+        if (change < ELO_PRECISION)
+        {
+            break;
+        }
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        // the standard error comes from the Fisher information of the log strength
+        double information = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            if (j != i)
+            {
+                double p = strength[i] / (strength[i] + strength[j]);
+                information += (r.games[engines[i]][engines[j]] + 1) * p * (1 - p);
+            }
+        }
+        elo[i] = ELO_SCALE * log(strength[i]);
+        error[i] = ELO_Z95 * ELO_SCALE / sqrt(information);
+    }
+}
+
+/**
+ * @brief print the results of some games: scores, ratings, think time
+ *
+ * @param title the first column header
+ * @param cost  whether to print CPU time and memory
+ */
+void printTournament(ostream &out, const char title[], tournament_results &r, const vector<engine_kind> &engines, bool cost)
+{
+    vector<double> elo(engines.size()), error(engines.size());
+    tournamentElo(r, engines, elo.data(), error.data());
+    out << left << setw(10) << title << right;
+    for (engine_kind e : engines)
+    {
+        out << setw(8) << engineName(e);
+    }
+    out << setw(8) << "games" << setw(8) << "score" << setw(7) << "Elo" << setw(6) << "+/-" << setw(8) << "moves"
+        << setw(9) << "mean ms" << setw(9) << "p99 ms";
+    if (cost)
+    {
+        out << setw(9) << "cpu s" << setw(8) << "MB";
+    }
+    out << '\n' << fixed;
+    for (size_t i = 0; i < engines.size(); i++)
+    {
+        engine_kind e = engines[i];
+        unsigned games = 0;
+        double points = 0;
+        out << left << setw(10) << engineName(e) << right << setprecision(1);
+        for (engine_kind o : engines)
+        {
+            if (o == e || r.games[e][o] == 0)
+            {
+                out << setw(8) << "-";
+            }
+            else
+            {
+                out << setw(7) << 100 * r.points[e][o] / r.games[e][o] << '%';
+            }
+            games += r.games[e][o];
+            points += r.points[e][o];
+        }
+        vector<double> &think = r.think[e];
+        sort(think.begin(), think.end());
+        double total = 0;
+        for (double t : think)
+        {
+            total += t;
+        }
+        double mean = think.empty() ? 0 : total / think.size();
+        double p99 = think.empty() ? 0 : think[size_t(ceil(0.99 * think.size())) - 1];
+        out << setw(8) << games << setw(7) << (games > 0 ? 100 * points / games : 0) << '%' << setprecision(0) << showpos
+            << setw(7) << elo[i] << noshowpos << setw(6) << error[i] << setw(8) << think.size() << setprecision(3)
+            << setw(9) << 1e3 * mean << setw(9) << 1e3 * p99;
+        if (cost)
+        {
+            // search threads run for the whole think time
+            out << setprecision(2) << setw(9) << total * getEngineSettings(e).threads << setprecision(1) << setw(8)
+                << engineMemory(e) / double(1 << 20);
+        }
+        out << '\n';
+    }
+    out << defaultfloat << '\n';
+}
+
+/**
+ * @brief Play a round robin between all the computer engines and print the results
+ *
+ * @param games     games of each pair of engines on each board dimension
+ * @param minDim    smallest board dimension
+ * @param maxDim    largest board dimension
+ * @param threads   games played at the same time
+ * @return int the exit code
+ */
+int runTournament(ostream &out, const configuration &c, int games, int minDim, int maxDim, int threads)
+{
+    vector<engine_kind> engines;
+    int searchThreads = 1;
+    for (int e = 0; e < NUM_ENGINE_KINDS; e++)
+    {
+        if (isComputerEngine(engine_kind(e)))
+        {
+            engines.push_back(engine_kind(e));
+            searchThreads = max(searchThreads, getEngineSettings(engine_kind(e)).threads);
+        }
+    }
+    if (games <= 0 || minDim < MIN_DIM || maxDim > MAX_DIM || minDim > maxDim || engines.size() < 2)
+    {
+        out << "Invalid tournament: " << games << " games per pair on " << minDim << "x" << minDim << " to " << maxDim << "x"
+            << maxDim << " boards, " << engines.size() << " engines\n";
+        return 1;
+    }
+    if (threads <= 0)
+    {
+        threads = max(1, int(thread::hardware_concurrency()) / searchThreads); // a core per search thread
+    }
+    tournament_state s;
+    s.cfg = c;
+    s.cfg.interactive = false;
+    // the largest boards first, so that their long games do not end the tournament alone
+    for (int dim = maxDim; dim >= minDim; dim--)
+    {
+        for (size_t a = 0; a < engines.size(); a++)
+        {
+            for (size_t b = a + 1; b < engines.size(); b++)
+            {
+                // each engine moves first in half the games, with either symbol
+                for (int k = 0; k < games; k++)
+                {
+                    tournament_game t{{engines[a], engines[b]}, dim, player(k / 2 % NUM_PLAYERS)};
+                    if (k % 2 != 0)
+                    {
+                        swap(t.engines[0], t.engines[1]);
+                    }
+                    s.games.push_back(t);
+                }
+            }
+        }
+    }
+    threads = min(threads, int(s.games.size()));
+    TimePoint start = theClock.now();
+    vector<thread> players;
+    for (int t = 0; t < threads; t++)
+    {
+        players.emplace_back(tournamentPlayer, ref(s));
+    }
+    while (s.played < s.games.size())
+    {
+        this_thread::sleep_for(TOURNAMENT_PROGRESS);
+        cerr << "\rPlayed " << s.played << "/" << s.games.size() << " games" << flush;
+    }
+    cerr << '\n';
+    for (thread &p : players)
+    {
+        p.join();
+    }
+    double seconds = Duration(theClock.now() - start).count();
+    out << "Tournament: " << engines.size() << " engines, " << games << " games per pair on " << minDim << "x" << minDim
+        << " to " << maxDim << "x" << maxDim << " boards, parallel games: " << threads << "\n";
+    out << s.games.size() << " games in " << fixed << setprecision(1) << seconds << defaultfloat << " s\n\n";
+    for (int dim = minDim; dim <= maxDim; dim++)
+    {
+        string title = to_string(dim) + "x" + to_string(dim);
+        printTournament(out, title.c_str(), s.results[dim], engines, false);
+    }
+    printTournament(out, "all", s.results[TOURNAMENT_ALL], engines, true);
+    out.flush();
+    return 0;
+}
+
+#endif
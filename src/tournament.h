@@ -0,0 +1,27 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+// The tournament ==============================================================
+/**
+ * Torneo all'italiana tra tutti i motori del computer: ogni coppia gioca lo
+ * stesso numero di partite su ogni dimensione della scacchiera, scambiando i
+ * simboli ed alternando chi muove per primo. Le partite sono giocate in
+ * parallelo su più thread.
+ * Alla fine sono riportati, per ogni dimensione e nel complesso, i punteggi
+ * di ogni coppia, la forza stimata (Elo, con intervallo di confidenza al
+ * 95%) ed il costo di ogni motore: tempo per mossa (medio e 99° percentile),
+ * tempo di CPU (tempo per mossa per thread di ricerca) e memoria.
+ */
+
+/**
+ * @brief Play a round robin between all the computer engines and print the results
+ *
+ * @param games     games of each pair of engines on each board dimension
+ * @param minDim    smallest board dimension
+ * @param maxDim    largest board dimension
+ * @param threads   games played at the same time
+ * @return int the exit code
+ */
+int runTournament(std::ostream &, const configuration &, int games, int minDim, int maxDim, int threads);
+
+#endif
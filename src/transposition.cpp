@@ -0,0 +1,796 @@
+#ifndef TRANSPOSITION_CPP
+#define TRANSPOSITION_CPP
+
+#include "transposition.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define TT_VALID ((uint64_t)1)                   ///< data bit: slot in use
+#define TT_VALUE_SHIFT 1                         ///< value bits position
+#define TT_VALUE_MASK ((1u << TT_VALUE_BITS) - 1) ///< value bits (after shift)
+#define TT_AGE_SHIFT 17                          ///< age bits position
+#define TT_AGE_MASK 63u                          ///< age bits (after shift)
+#define TT_DEPTH_SHIFT 23                        ///< depth bits position
+#define TT_CHECK_MASK (~(uint64_t)0 << 32)       ///< key check bits kept in data
+#define TT_CLUSTER_SLOTS 4                       ///< slots per cluster (one cache line)
+#define TT_COUNTER_SHARDS 64                     ///< statistics counters (per thread groups)
+#define TT_HUGE_PAGE (2 << 20)                   ///< transparent huge page size
+#define TT_CHUNK_CLUSTERS 1024                   ///< clusters per snapshot chunk (64 KB)
+#define TT_SNAPSHOT_MAGIC "TTTSNAP"              ///< snapshot file signature
+#define TT_SNAPSHOT_VERSION 1                    ///< snapshot file format version
+#define TT_SHARED_MAGIC "TTTSHRD"                ///< shared segment signature
+#define TT_SHARED_VERSION 1                      ///< shared segment layout version
+#define TT_SHARED_WAIT 5                         ///< seconds to wait for a segment being created
+
+/**
+ * @brief a table slot: data = key check bits | depth | age | value | valid,
+ * check = key ^ data
+ *
+ */
+struct tt_slot
+{
+    std::atomic<uint64_t> check; ///< key ^ data
+    std::atomic<uint64_t> data;  ///< key check bits, depth, age, value and valid flag
+};
+
+/**
+ * @brief the slots sharing a cache line (a key may be in any of them)
+ *
+ */
+struct alignas(64) tt_cluster
+{
+    tt_slot slots[TT_CLUSTER_SLOTS]; ///< the slots
+};
+
+/**
+ * @brief statistics counters, one cache line each to avoid contention
+ *
+ */
+struct alignas(64) tt_counters
+{
+    std::atomic<uint64_t> probes, hits, stores, replacements; ///< see table_stats
+};
+
+/**
+ * @brief the transposition table
+ *
+ */
+struct transposition_table
+{
+    tt_cluster *clusters;                            ///< the clusters
+    uint64_t mask;                                   ///< number of clusters - 1 (cluster index bits)
+    size_t bytes;                                    ///< allocated memory
+    std::atomic<unsigned> age;                       ///< current search (modulo TT_AGE_MASK + 1)
+    mutable tt_counters counters[TT_COUNTER_SHARDS]; ///< statistics
+    std::atomic<uint8_t> *dirty{nullptr};            ///< chunks changed since last flush (with snapshot)
+    void *segment{nullptr};                          ///< shared memory mapping (nullptr if private)
+    size_t segmentBytes{0};                          ///< size of the mapping
+    int snapshot{-1};                                ///< snapshot file (-1 if none)
+    std::mutex snapshotLock;                         ///< serializes flushes
+};
+
+/**
+ * @brief snapshot file header (followed by the clusters, as in memory)
+ *
+ */
+struct tt_snapshot_header
+{
+    char magic[8];            ///< TT_SNAPSHOT_MAGIC
+    uint32_t version;         ///< TT_SNAPSHOT_VERSION
+    uint32_t slotsPerCluster; ///< TT_CLUSTER_SLOTS
+    uint64_t rulesId;         ///< meaning of keys and values
+    uint64_t clusters;        ///< number of clusters
+    char reserved[32];        ///< up to a cache line
+};
+
+/**
+ * @brief shared segment header, followed by the chunk dirty flags (so that
+ * stores of every process reach the snapshot) and by the clusters
+ *
+ */
+struct tt_shared_header
+{
+    char magic[8];                ///< TT_SHARED_MAGIC
+    uint32_t version;             ///< TT_SHARED_VERSION
+    uint32_t slotsPerCluster;     ///< TT_CLUSTER_SLOTS
+    uint64_t rulesId;             ///< meaning of keys and values
+    uint64_t clusters;            ///< number of clusters
+    std::atomic<uint32_t> ready;  ///< set (last) by the creating process
+    char reserved[28];            ///< up to a cache line
+};
+
+// counters used by the current thread
+std::atomic<unsigned> ttNextShard{0};
+thread_local unsigned ttShard = ttNextShard++ % TT_COUNTER_SHARDS;
+
+/**
+ * @brief the number of clusters fitting in some memory (a power of two)
+ *
+ */
+size_t tableClusters(size_t bytes)
+{
+    size_t clusters = 1;
+    while (clusters * 2 * sizeof(tt_cluster) <= bytes)
+    {
+        clusters *= 2;
+    }
+    return clusters;
+}
+
+/**
+ * @brief the number of snapshot chunks of a table
+ *
+ */
+inline size_t tableChunks(size_t clusters)
+{
+    return (clusters + TT_CHUNK_CLUSTERS - 1) / TT_CHUNK_CLUSTERS;
+}
+
+/**
+ * @brief the size of a shared segment: header, dirty flags and clusters
+ *
+ */
+inline size_t segmentBytes(size_t clusters)
+{
+    return sizeof(tt_shared_header) + (tableChunks(clusters) + 63) / 64 * 64 + clusters * sizeof(tt_cluster);
+}
+
+/**
+ * @brief Create a table
+ *
+ * @param bytes     memory to be used (rounded down to a power of two)
+ * @param hugePages whether to ask for transparent huge pages
+ * @return transposition_table* the new (empty) table
+ */
+transposition_table *newTable(size_t bytes, bool hugePages)
+{
+    transposition_table *t = new transposition_table();
+    size_t clusters = tableClusters(bytes);
+    t->mask = clusters - 1;
+    t->bytes = clusters * sizeof(tt_cluster);
+    size_t alignment = hugePages && t->bytes >= TT_HUGE_PAGE ? TT_HUGE_PAGE : sizeof(tt_cluster);
+    t->clusters = (tt_cluster *)aligned_alloc(alignment, t->bytes);
+    if (t->clusters == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (alignment == TT_HUGE_PAGE)
+    {
+        madvise(t->clusters, t->bytes, MADV_HUGEPAGE);
+    }
+#endif
+    memset((void *)t->clusters, 0, t->bytes); // all slots empty (and memory committed now)
+    return t;
+}
+
+/**
+ * @brief Create or attach a table in a named shared memory segment
+ *
+ * The process creating the segment sizes it and publishes the header last;
+ * the others wait for it, then check the header before using the slots.
+ * The segment outlives the processes (until removed from /dev/shm).
+ *
+ * @param name      the segment name (such as "/name")
+ * @param bytes     memory to be used if the segment is created
+ * @param hugePages whether to ask for transparent huge pages
+ * @param rulesId   identifies rules and value meaning
+ * @param created   set to whether the segment has been created
+ * @return transposition_table* the table (nullptr if not available)
+ */
+transposition_table *newSharedTable(const char name[], size_t bytes, bool hugePages, uint64_t rulesId, bool &created)
+{
+    size_t clusters = tableClusters(bytes);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    created = fd >= 0;
+    if (!created && (errno != EEXIST || (fd = shm_open(name, O_RDWR | O_CLOEXEC, 0)) < 0))
+    {
+        return nullptr;
+    }
+    if (created)
+    {
+        if (ftruncate(fd, segmentBytes(clusters)) != 0) // zero filled: all slots empty
+        {
+            close(fd);
+            shm_unlink(name);
+            return nullptr;
+        }
+    }
+    else
+    {
+        // wait until the creator has published the header, then take its size
+        bool ready = false;
+        for (int i = 0; i < TT_SHARED_WAIT * 100 && !ready; i++)
+        {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(tt_shared_header))
+            {
+                void *p = mmap(nullptr, sizeof(tt_shared_header), PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    const tt_shared_header &h = *(const tt_shared_header *)p;
+                    ready = h.ready.load(std::memory_order_acquire) != 0;
+                    bool compatible = memcmp(h.magic, TT_SHARED_MAGIC, sizeof(h.magic)) == 0 &&
+                                      h.version == TT_SHARED_VERSION && h.slotsPerCluster == TT_CLUSTER_SLOTS &&
+                                      h.rulesId == rulesId && size_t(st.st_size) == segmentBytes(h.clusters);
+                    clusters = h.clusters;
+                    munmap(p, sizeof(tt_shared_header));
+                    if (ready && !compatible)
+                    {
+                        close(fd);
+                        return nullptr;
+                    }
+                }
+            }
+            if (!ready)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        if (!ready)
+        {
+            close(fd);
+            return nullptr;
+        }
+    }
+    size_t total = segmentBytes(clusters);
+    void *p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        if (created)
+        {
+            shm_unlink(name);
+        }
+        return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    if (hugePages && total >= TT_HUGE_PAGE)
+    {
+        madvise(p, total, MADV_HUGEPAGE);
+    }
+#endif
+    tt_shared_header *h = (tt_shared_header *)p;
+    if (created)
+    {
+        memcpy(h->magic, TT_SHARED_MAGIC, sizeof(h->magic));
+        h->version = TT_SHARED_VERSION;
+        h->slotsPerCluster = TT_CLUSTER_SLOTS;
+        h->rulesId = rulesId;
+        h->clusters = clusters;
+        h->ready.store(1, std::memory_order_release);
+    }
+    transposition_table *t = new transposition_table();
+    t->segment = p;
+    t->segmentBytes = total;
+    t->dirty = (std::atomic<uint8_t> *)(h + 1);
+    t->clusters = (tt_cluster *)((char *)p + total - clusters * sizeof(tt_cluster));
+    t->mask = clusters - 1;
+    t->bytes = clusters * sizeof(tt_cluster);
+    return t;
+}
+
+/**
+ * @brief Destroy a table (a shared segment is only unmapped)
+ *
+ */
+void deleteTable(transposition_table *t)
+{
+    if (t != nullptr)
+    {
+        detachSnapshot(*t);
+        if (t->segment != nullptr)
+        {
+            munmap(t->segment, t->segmentBytes);
+        }
+        else
+        {
+            free(t->clusters);
+        }
+        delete t;
+    }
+}
+
+/**
+ * @brief Get the key of a position (a bijection, spreading the bits)
+ *
+ * @param position the position representation
+ * @return uint64_t the key
+ */
+uint64_t positionKey(uint64_t position)
+{
+    // splitmix64 finalizer
+    position = (position ^ (position >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    position = (position ^ (position >> 27)) * 0x94D049BB133111EBULL;
+    return position ^ (position >> 31);
+}
+
+/**
+ * @brief read a slot, checking it holds the given key
+ *
+ * @param data  the data word (if valid)
+ * @return true if the slot holds the key
+ */
+inline bool readSlot(const tt_slot &s, uint64_t key, uint64_t &data)
+{
+    data = s.data.load(std::memory_order_relaxed);
+    uint64_t check = s.check.load(std::memory_order_relaxed);
+    // words from different writes do not match (a torn slot is a miss)
+    return (data & TT_VALID) != 0 && (check ^ data) == key && ((data ^ key) & TT_CHECK_MASK) == 0;
+}
+
+/**
+ * @brief Look up a position (lock-free)
+ *
+ * @param key   the position key
+ * @param value the stored value (if found)
+ * @return true if found
+ * @return false otherwise
+ */
+bool probeTable(const transposition_table &t, uint64_t key, unsigned &value)
+{
+    const tt_cluster &c = t.clusters[key & t.mask];
+    tt_counters &counters = t.counters[ttShard];
+    counters.probes.fetch_add(1, std::memory_order_relaxed);
+    uint64_t data;
+    for (const tt_slot &s : c.slots)
+    {
+        if (readSlot(s, key, data))
+        {
+            counters.hits.fetch_add(1, std::memory_order_relaxed);
+            value = (data >> TT_VALUE_SHIFT) & TT_VALUE_MASK;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Store the value of a position (lock-free)
+ *
+ * The key replaces itself, or an empty slot, or else the slot of its cluster
+ * with the lowest depth, older searches counting as less deep.
+ *
+ * @param key   the position key
+ * @param value the value (less than 2^TT_VALUE_BITS)
+ * @param depth the search depth of the value (deeper values are kept longer)
+ */
+void storeTable(transposition_table &t, uint64_t key, unsigned value, unsigned depth)
+{
+    tt_cluster &c = t.clusters[key & t.mask];
+    unsigned age = t.age.load(std::memory_order_relaxed) & TT_AGE_MASK;
+    tt_slot *victim = nullptr;
+    int victimWorth = 0;
+    bool replacing = false;
+    for (tt_slot &s : c.slots)
+    {
+        uint64_t data;
+        if (readSlot(s, key, data))
+        {
+            victim = &s; // same position
+            replacing = false;
+            break;
+        }
+        data = s.data.load(std::memory_order_relaxed);
+        if ((data & TT_VALID) == 0)
+        {
+            if (!victim || replacing)
+            {
+                victim = &s; // first empty slot
+                replacing = false;
+            }
+            continue;
+        }
+        unsigned relativeAge = (age - (data >> TT_AGE_SHIFT)) & TT_AGE_MASK;
+        int worth = int((data >> TT_DEPTH_SHIFT) & TT_MAX_DEPTH) - 8 * int(relativeAge);
+        if (victim == nullptr || (replacing && worth < victimWorth))
+        {
+            victim = &s;
+            victimWorth = worth;
+            replacing = true;
+        }
+    }
+    if (depth > TT_MAX_DEPTH)
+    {
+        depth = TT_MAX_DEPTH;
+    }
+    uint64_t data = (key & TT_CHECK_MASK) | (uint64_t(depth) << TT_DEPTH_SHIFT) | (uint64_t(age) << TT_AGE_SHIFT) |
+                    (uint64_t(value & TT_VALUE_MASK) << TT_VALUE_SHIFT) | TT_VALID;
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+    victim->data.store(data, std::memory_order_relaxed);
+    if (t.dirty != nullptr)
+    {
+        // after the slot: a flush seeing the flag sees the slot too
+        t.dirty[(key & t.mask) / TT_CHUNK_CLUSTERS].store(1, std::memory_order_release);
+    }
+    tt_counters &counters = t.counters[ttShard];
+    counters.stores.fetch_add(1, std::memory_order_relaxed);
+    if (replacing)
+    {
+        counters.replacements.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Start a new search: values of previous searches age
+ *
+ */
+void ageTable(transposition_table &t)
+{
+    t.age.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the usage statistics of a table
+ *
+ * @return table_stats the statistics
+ */
+table_stats getTableStats(const transposition_table &t)
+{
+    table_stats result{t.bytes, (t.mask + 1) * TT_CLUSTER_SLOTS, 0, 0, 0, 0, t.segment != nullptr};
+    for (const tt_counters &c : t.counters)
+    {
+        result.probes += c.probes.load(std::memory_order_relaxed);
+        result.hits += c.hits.load(std::memory_order_relaxed);
+        result.stores += c.stores.load(std::memory_order_relaxed);
+        result.replacements += c.replacements.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+/**
+ * @brief Print the usage statistics of a table
+ *
+ */
+void printTableStats(std::ostream &out, const table_stats &s)
+{
+    out << (s.bytes >> 20) << " MB" << (s.shared ? " shared" : "") << ", " << s.slots << " slots: " << s.probes << " probes, " << s.hits << " hits ("
+        << fixed << setprecision(1) << (s.probes ? 100.0 * s.hits / s.probes : 0.0) << "%), " << s.stores
+        << " stores, " << s.replacements << " replacements" << defaultfloat << '\n';
+}
+
+/**
+ * @brief read a file completely (short files give zeros, i.e. empty slots)
+ *
+ * @return true unless a read error occurred
+ */
+bool readFully(int fd, void *buffer, size_t bytes, off_t offset)
+{
+    char *p = (char *)buffer;
+    while (bytes > 0)
+    {
+        ssize_t n = pread(fd, p, bytes, offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            memset(p, 0, bytes);
+            return n == 0;
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/**
+ * @brief write a buffer completely
+ *
+ * @return true if written
+ */
+bool writeFully(int fd, const void *buffer, size_t bytes, off_t offset)
+{
+    const char *p = (const char *)buffer;
+    while (bytes > 0)
+    {
+        ssize_t n = pwrite(fd, p, bytes, offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Attach a snapshot file: load it (if compatible) and keep it updated
+ *
+ * Must be called before the table is shared with other threads (with a
+ * shared segment, only by the process creating it: the segment dirty flags
+ * let it save the positions stored by every process).
+ * A snapshot of a different size is rehashed; slots torn by a crash during
+ * a write fail the key check and are ignored like any torn slot.
+ *
+ * @param path      the file
+ * @param rulesId   identifies rules and value meaning (other files are ignored)
+ * @return true if some positions have been loaded
+ * @return false otherwise
+ */
+bool attachSnapshot(transposition_table &t, const char path[], uint64_t rulesId)
+{
+    detachSnapshot(t);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    size_t clusters = t.mask + 1, chunks = tableChunks(clusters);
+    tt_snapshot_header h{};
+    bool compatible = readFully(fd, &h, sizeof(h), 0) && memcmp(h.magic, TT_SNAPSHOT_MAGIC, sizeof(h.magic)) == 0 &&
+                      h.version == TT_SNAPSHOT_VERSION && h.slotsPerCluster == TT_CLUSTER_SLOTS && h.rulesId == rulesId;
+    bool sameSize = compatible && h.clusters == clusters;
+    unsigned long long loaded = 0;
+    if (sameSize)
+    {
+        // same layout: read straight into the table
+        readFully(fd, (void *)t.clusters, t.bytes, sizeof(h));
+        loaded = 1;
+    }
+    else if (compatible)
+    {
+        // different size: store every valid position again
+        std::vector<tt_cluster> buffer(TT_CHUNK_CLUSTERS);
+        for (uint64_t first = 0; first < h.clusters; first += TT_CHUNK_CLUSTERS)
+        {
+            size_t count = std::min<uint64_t>(TT_CHUNK_CLUSTERS, h.clusters - first);
+            readFully(fd, (void *)buffer.data(), count * sizeof(tt_cluster), sizeof(h) + first * sizeof(tt_cluster));
+            for (size_t c = 0; c < count; c++)
+            {
+                for (const tt_slot &s : buffer[c].slots)
+                {
+                    uint64_t data = s.data.load(std::memory_order_relaxed);
+                    uint64_t key = s.check.load(std::memory_order_relaxed) ^ data;
+                    if ((data & TT_VALID) != 0 && ((data ^ key) & TT_CHECK_MASK) == 0)
+                    {
+                        storeTable(t, key, (data >> TT_VALUE_SHIFT) & TT_VALUE_MASK, (data >> TT_DEPTH_SHIFT) & TT_MAX_DEPTH);
+                        loaded++;
+                    }
+                }
+            }
+        }
+    }
+    if (t.segment == nullptr)
+    {
+        t.dirty = new std::atomic<uint8_t>[chunks]();
+    }
+    if (!sameSize)
+    {
+        // rewrite everything in the current layout
+        memcpy(h.magic, TT_SNAPSHOT_MAGIC, sizeof(h.magic));
+        h.version = TT_SNAPSHOT_VERSION;
+        h.slotsPerCluster = TT_CLUSTER_SLOTS;
+        h.rulesId = rulesId;
+        h.clusters = clusters;
+        if (ftruncate(fd, sizeof(h) + t.bytes) != 0 || !writeFully(fd, &h, sizeof(h), 0))
+        {
+            close(fd);
+            if (t.segment == nullptr)
+            {
+                delete[] t.dirty;
+                t.dirty = nullptr;
+            }
+            return loaded > 0;
+        }
+        for (size_t i = 0; i < chunks; i++)
+        {
+            t.dirty[i].store(1, std::memory_order_relaxed);
+        }
+    }
+    t.snapshot = fd;
+    return loaded > 0;
+}
+
+/**
+ * @brief Write the changes since the last flush to the snapshot file
+ *
+ * May run concurrently with probes and stores (positions stored meanwhile
+ * are written by the next flush).
+ *
+ * @param sync  whether to wait for the data to reach the disk
+ */
+void flushSnapshot(transposition_table &t, bool sync)
+{
+    std::lock_guard<std::mutex> guard(t.snapshotLock);
+    if (t.snapshot < 0)
+    {
+        return;
+    }
+    size_t clusters = t.mask + 1;
+    std::vector<uint64_t> buffer(TT_CHUNK_CLUSTERS * TT_CLUSTER_SLOTS * 2);
+    for (size_t first = 0, chunk = 0; first < clusters; first += TT_CHUNK_CLUSTERS, chunk++)
+    {
+        if (t.dirty[chunk].exchange(0, std::memory_order_acquire) == 0)
+        {
+            continue;
+        }
+        size_t count = std::min<size_t>(TT_CHUNK_CLUSTERS, clusters - first), w = 0;
+        for (size_t c = first; c < first + count; c++)
+        {
+            for (const tt_slot &s : t.clusters[c].slots)
+            {
+                buffer[w++] = s.check.load(std::memory_order_relaxed);
+                buffer[w++] = s.data.load(std::memory_order_relaxed);
+            }
+        }
+        if (!writeFully(t.snapshot, buffer.data(), count * sizeof(tt_cluster), sizeof(tt_snapshot_header) + first * sizeof(tt_cluster)))
+        {
+            t.dirty[chunk].store(1, std::memory_order_relaxed); // retry next time
+        }
+    }
+    if (sync)
+    {
+        fdatasync(t.snapshot);
+    }
+}
+
+/**
+ * @brief Flush and close the snapshot file
+ *
+ */
+void detachSnapshot(transposition_table &t)
+{
+    flushSnapshot(t, true);
+    std::lock_guard<std::mutex> guard(t.snapshotLock);
+    if (t.snapshot >= 0)
+    {
+        close(t.snapshot);
+        t.snapshot = -1;
+        if (t.segment == nullptr)
+        {
+            delete[] t.dirty;
+            t.dirty = nullptr;
+        }
+    }
+}
+
+// Stress test and benchmark ===================================================
+
+#define TT_BENCH_BYTES (16 << 20) ///< benchmark table size (2^20 slots)
+#define TT_BENCH_KEYS_LOG2 22     ///< benchmark key range (4 keys per slot)
+#define TT_BENCH_PROBES 3      ///< probes per store
+
+/**
+ * @brief the value every thread stores for a key (to check probes)
+ *
+ */
+inline unsigned benchValue(uint64_t key)
+{
+    return (key >> 40) & TT_VALUE_MASK;
+}
+
+/**
+ * @brief one benchmark thread on the lock-free table
+ *
+ * @param ops   operations done
+ * @param bad   probes returning a value not stored for the key
+ */
+void tableBenchThread(transposition_table &t, int id, const std::atomic<bool> &stop,
+                      std::atomic<unsigned long long> &ops, std::atomic<unsigned long long> &bad)
+{
+    uint64_t state = id + 1, done = 0, wrong = 0;
+    unsigned value;
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        for (int i = 0; i < 1024; i++, done++)
+        {
+            uint64_t key = positionKey((state = positionKey(state)) >> (64 - TT_BENCH_KEYS_LOG2));
+            if (i % (TT_BENCH_PROBES + 1) == 0)
+            {
+                storeTable(t, key, benchValue(key), key & 15);
+            }
+            else if (probeTable(t, key, value) && value != benchValue(key))
+            {
+                wrong++;
+            }
+        }
+    }
+    ops += done;
+    bad += wrong;
+}
+
+/**
+ * @brief one benchmark thread on a map protected by a mutex (for comparison)
+ *
+ * @param ops   operations done
+ */
+void mapBenchThread(std::unordered_map<uint64_t, unsigned> &m, std::mutex &lock, int id,
+                    const std::atomic<bool> &stop, std::atomic<unsigned long long> &ops)
+{
+    uint64_t state = id + 1, done = 0;
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        for (int i = 0; i < 1024; i++, done++)
+        {
+            uint64_t key = positionKey((state = positionKey(state)) >> (64 - TT_BENCH_KEYS_LOG2));
+            std::lock_guard<std::mutex> guard(lock);
+            if (i % (TT_BENCH_PROBES + 1) == 0)
+            {
+                m[key] = benchValue(key);
+            }
+            else
+            {
+                m.find(key);
+            }
+        }
+    }
+    ops += done;
+}
+
+/**
+ * @brief Run the stress test and the contention benchmark
+ *
+ * @param maxThreads    benchmark with 1 .. maxThreads threads
+ * @param seconds       duration of each run
+ * @return int the exit code (not 0 if corrupted values were seen)
+ */
+int runTableBench(int maxThreads, double seconds)
+{
+    transposition_table *t = newTable(TT_BENCH_BYTES, true);
+    std::unordered_map<uint64_t, unsigned> m;
+    std::mutex lock;
+    unsigned long long totalBad = 0;
+    cout << "Transposition table: " << getTableStats(*t).slots << " slots, 2^" << TT_BENCH_KEYS_LOG2
+         << " keys, " << TT_BENCH_PROBES << " probes per store\n";
+    cout << "threads   lock-free Mops/s   mutex map Mops/s   corrupted\n";
+    for (int threads = 1; threads <= maxThreads; threads++)
+    {
+        double mops[2];
+        std::atomic<unsigned long long> bad{0};
+        for (int kind = 0; kind < 2; kind++)
+        {
+            std::atomic<bool> stop{false};
+            std::atomic<unsigned long long> ops{0};
+            std::vector<std::thread> pool;
+            TimePoint start = theClock.now();
+            for (int i = 0; i < threads; i++)
+            {
+                if (kind == 0)
+                {
+                    pool.emplace_back(tableBenchThread, std::ref(*t), i, std::cref(stop), std::ref(ops), std::ref(bad));
+                }
+                else
+                {
+                    pool.emplace_back(mapBenchThread, std::ref(m), std::ref(lock), i, std::cref(stop), std::ref(ops));
+                }
+            }
+            std::this_thread::sleep_for(Duration(seconds));
+            stop = true;
+            for (std::thread &th : pool)
+            {
+                th.join();
+            }
+            mops[kind] = ops / Duration(theClock.now() - start).count() / 1e6;
+        }
+        totalBad += bad;
+        cout << setw(7) << threads << fixed << setprecision(2) << setw(19) << mops[0] << setw(19) << mops[1]
+             << setw(12) << bad << defaultfloat << '\n';
+    }
+    printTableStats(cout, getTableStats(*t));
+    deleteTable(t);
+    cout << (totalBad == 0 ? "Stress test passed" : "Stress test FAILED: corrupted values") << endl;
+    return totalBad == 0 ? 0 : 1;
+}
+
+#endif
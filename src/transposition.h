@@ -0,0 +1,160 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+// The transposition table =====================================================
+/**
+ * Tabella delle posizioni già valutate, condivisa fra più thread senza lock:
+ * ogni posizione occupa due parole atomiche a 64 bit, il dato (valore più
+ * bit di controllo) e la chiave in XOR con il dato. Una lettura è valida solo
+ * se le due parole sono coerenti con la chiave cercata, quindi scritture
+ * concorrenti "mescolate" vengono semplicemente scartate.
+ * La tabella ha dimensione fissa, allocata una sola volta (eventualmente su
+ * huge page): le posizioni sono raggruppate in cluster grandi quanto una
+ * linea di cache e, quando un cluster è pieno, viene sostituita la posizione
+ * meno profonda o più vecchia (i valori persi vengono ricalcolati).
+ * Una tabella può essere associata ad un file (snapshot versionato): il
+ * contenuto viene caricato all'associazione e poi salvato in modo
+ * incrementale, riscrivendo solo le parti modificate.
+ * Una tabella può anche risiedere in un segmento di memoria condivisa POSIX,
+ * usato da tutti i processi dello stesso host: l'intestazione del segmento
+ * (versione e regole) impedisce di mescolare dati incompatibili.
+ */
+
+#include <cstdint>
+#include <ostream>
+
+#define TT_VALUE_BITS 16 ///< bits available for the stored value
+#define TT_MAX_DEPTH 255 ///< max depth (remaining plies) of a stored value
+
+/**
+ * @brief the transposition table (to be defined in transposition.cpp)
+ *
+ */
+struct transposition_table;
+
+/**
+ * @brief usage statistics of a table
+ *
+ */
+struct table_stats
+{
+    size_t bytes;                    ///< allocated memory
+    size_t slots;                    ///< number of positions
+    unsigned long long probes, hits; ///< look ups and successful ones
+    unsigned long long stores;       ///< stored values
+    unsigned long long replacements; ///< other positions overwritten by a store
+    bool shared;                     ///< in shared memory (counters are per process)
+};
+
+/**
+ * @brief Create a table
+ *
+ * @param bytes     memory to be used (rounded down to a power of two)
+ * @param hugePages whether to ask for transparent huge pages
+ * @return transposition_table* the new (empty) table
+ */
+transposition_table *newTable(size_t bytes, bool hugePages);
+
+/**
+ * @brief Create or attach a table in a named shared memory segment
+ *
+ * The segment keeps its size if it already exists; a segment created for
+ * other rules or by another format version is not used.
+ *
+ * @param name      the segment name (such as "/name")
+ * @param bytes     memory to be used if the segment is created
+ * @param hugePages whether to ask for transparent huge pages
+ * @param rulesId   identifies rules and value meaning
+ * @param created   set to whether the segment has been created
+ * @return transposition_table* the table (nullptr if not available)
+ */
+transposition_table *newSharedTable(const char name[], size_t bytes, bool hugePages, uint64_t rulesId, bool &created);
+
+/**
+ * @brief Destroy a table
+ *
+ */
+void deleteTable(transposition_table *);
+
+/**
+ * @brief Get the key of a position (a bijection, spreading the bits)
+ *
+ * @param position the position representation
+ * @return uint64_t the key
+ */
+uint64_t positionKey(uint64_t position);
+
+/**
+ * @brief Look up a position (lock-free)
+ *
+ * @param key   the position key
+ * @param value the stored value (if found)
+ * @return true if found
+ * @return false otherwise
+ */
+bool probeTable(const transposition_table &, uint64_t key, unsigned &value);
+
+/**
+ * @brief Store the value of a position (lock-free)
+ *
+ * @param key   the position key
+ * @param value the value (less than 2^TT_VALUE_BITS)
+ * @param depth the search depth of the value (deeper values are kept longer)
+ */
+void storeTable(transposition_table &, uint64_t key, unsigned value, unsigned depth);
+
+/**
+ * @brief Start a new search: values of previous searches age
+ *
+ */
+void ageTable(transposition_table &);
+
+/**
+ * @brief Get the usage statistics of a table
+ *
+ * @return table_stats the statistics
+ */
+table_stats getTableStats(const transposition_table &);
+
+/**
+ * @brief Print the usage statistics of a table
+ *
+ */
+void printTableStats(std::ostream &, const table_stats &);
+
+/**
+ * @brief Attach a snapshot file: load it (if compatible) and keep it updated
+ *
+ * @param path      the file
+ * @param rulesId   identifies rules and value meaning (other files are ignored)
+ * @return true if some positions have been loaded
+ * @return false otherwise
+ */
+bool attachSnapshot(transposition_table &, const char path[], uint64_t rulesId);
+
+/**
+ * @brief Write the changes since the last flush to the snapshot file
+ *
+ * May run concurrently with probes and stores (positions stored meanwhile
+ * are written by the next flush).
+ *
+ * @param sync  whether to wait for the data to reach the disk
+ */
+void flushSnapshot(transposition_table &, bool sync);
+
+/**
+ * @brief Flush and close the snapshot file (no concurrent stores allowed)
+ *
+ */
+void detachSnapshot(transposition_table &);
+
+/**
+ * @brief Run the stress test and the contention benchmark
+ *
+ * @param maxThreads    benchmark with 1 .. maxThreads threads
+ * @param seconds       duration of each run
+ * @return int the exit code (not 0 if corrupted values were seen)
+ */
+int runTableBench(int maxThreads, double seconds);
+
+#endif
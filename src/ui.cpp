@@ -3,7 +3,11 @@
 
 #include "rlutil.h"
 using namespace rlutil;
+#include <condition_variable>
 #include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <thread>
 
 // user input data type (in this case, an int such as from getkey())
 using input = int;
@@ -28,7 +32,9 @@ const UIcommand UIcommands[NUM_ACTIONS] = {
     {NEW, "New game"},
     {TRY, "Make a move"},
     {MOVE, "Select/confirm cell"},
-    {SIZE, "Change board dimension"}};
+    {SIZE, "Board, gravity, players"},
+    {STATS, "Show/hide latency stats"},
+    {HINTS, "Show/hide move hints"}};
 
 /**
  * @brief translation between user input and actions data type
@@ -50,9 +56,19 @@ const char INPUT_PROMPT[] = "Enter your choice: ";
 
 // currently selected cell
 square selected = 0;
+// whether latency statistics are shown in place of the board
+bool statsShown = false;
+// pending human input (to measure input to redraw latency)
+bool inputPending = false;
+TimePoint inputTime;
+int inputMoveNumber = 0;
+// whether the value of the moves is shown on the board
+bool hintsShown = false;
 // player names
 #define MAX_NAME_LENGTH 25
-char names[NUM_PLAYERS][MAX_NAME_LENGTH];
+char names[MAX_PLAYERS][MAX_NAME_LENGTH];
+// player symbols
+const char PLAYER_SYMBOLS[] = "XO+";
 
 // the windows
 /**
@@ -120,9 +136,16 @@ const window menuBar{{2, 2},
                      {GREEN, BLACK},
                      {BLACK, GREEN},
                      "Available commands"};
+// the latency statistics (in place of the board)
+const window statsWindow{{2, 52},
+                         {20, 38},
+                         {1, 1},
+                         {WHITE, BLACK},
+                         {BLACK, GREY},
+                         "Latency (ms)"};
 // the game info window
-const window gameInfo{{10, 2},
-                      {3, 50},
+const window gameInfo{{11, 2},
+                      {2, 50},
                       {0, 0},
                       {YELLOW, BLACK},
                       {YELLOW, BLACK},
@@ -177,7 +200,8 @@ const window playerProgressBar(player p)
     window w = progressBar;
     w.corner.horizontal = PROGRESS_LEFT + p * PROGRESS_DELTA_COL;
     w.corner.vertical = PROGRESS_TOP + p * PROGRESS_DELTA_ROW;
-    sprintf(w.title, "Time remaining for %c: %s", "XO"[p], names[p]);
+    int room = sizeof w.title - sizeof "Time remaining for X: "; // long names are cut
+    snprintf(w.title, sizeof w.title, "Time remaining for %c: %.*s", PLAYER_SYMBOLS[p], room, names[p]);
     return w;
 }
 // a specific "window" to show a square
@@ -194,36 +218,149 @@ window cell{{0, 0}, // corner to be specified
             {BLACK, GREY},  // to be changed
             ""};
 
-// assumes NUM_PLAYERS = 2 !!!
-const char PLAYERS[NUM_PLAYERS][CELL_ROWS][CELL_COLUMNS + 1] = {{"\\\\ //",
+const char PLAYERS[MAX_PLAYERS][CELL_ROWS][CELL_COLUMNS + 1] = {{"\\\\ //",
                                                                  " XXX ",
                                                                  "// \\\\"},
                                                                 {" OOO ",
                                                                  "O   O",
-                                                                 " OOO "}};
+                                                                 " OOO "},
+                                                                {"  |  ",
+                                                                 "--+--",
+                                                                 "  |  "}};
 
 const colour cellSelected{BLACK, BROWN};
 const colour cellNormal{BLACK, BLUE};
+const colour cellEmpty{WHITE, BLACK};
+// hint shading of the empty cells, by outcome of the move
+const colour cellHints[] = {{BLACK, GREEN}, {WHITE, RED}, {BLACK, CYAN}};
+const char HINT_OUTCOMES[] = "WLD";
+
+/**
+ * @brief the value of the moves, computed in the background
+ *
+ */
+struct move_hints
+{
+    thread worker;                       ///< analyzes the requested position
+    mutex lock;                          ///< protects the following
+    condition_variable wake;             ///< signals a request
+    bool stop{false};                    ///< the worker must exit
+    game position;                       ///< the position requested
+    uint64_t requested{0}, computed{0};  ///< board signatures (0 = none)
+    move_value values[MAX_DIM * MAX_DIM]; ///< the values of the computed position
+};
+move_hints hints;
+// the hints shown (main thread only)
+uint64_t shownSignature = 0;
+move_value shownValues[MAX_DIM * MAX_DIM];
+
+/**
+ * @brief identify a position: board dimension, gravity, players, cells and turn
+ *
+ */
+uint64_t boardSignature(const game &g)
+{
+    uint64_t result = (uint64_t(g.DIM) << 1 | g.gravity) << 2 | getNumPlayers(g);
+    for (square c = getMinCell(g); c <= getMaxCell(g); c++)
+    {
+        result = result << 2 | getCellPlayer(g, c); // 2 bits: up to MAX_PLAYERS players, or PLAYER_NONE
+    }
+    return result << 2 | getTurn(g); // 2 bits as well
+}
+
+/**
+ * @brief hints worker: analyzes the last requested position
+ *
+ */
+void hintsWorker()
+{
+    unique_lock<mutex> lock(hints.lock);
+    for (;;)
+    {
+        hints.wake.wait(lock, [] { return hints.stop || hints.requested != hints.computed; });
+        if (hints.stop)
+        {
+            return;
+        }
+        uint64_t signature = hints.requested;
+        game g = hints.position;
+        lock.unlock();
+        move_value values[MAX_DIM * MAX_DIM];
+        analyzeMoves(g, values);
+        lock.lock();
+        copy(values, values + MAX_DIM * MAX_DIM, hints.values);
+        hints.computed = signature;
+    }
+}
+
+/**
+ * @brief ask for the hints of a position, take them when ready
+ *
+ * @return true if new hints are ready to be shown
+ */
+bool updateHints(const game &g)
+{
+    uint64_t signature = boardSignature(g);
+    if (signature == shownSignature)
+    {
+        return false;
+    }
+    lock_guard<mutex> lock(hints.lock);
+    if (hints.computed == signature)
+    {
+        copy(hints.values, hints.values + MAX_DIM * MAX_DIM, shownValues);
+        shownSignature = signature;
+        return true;
+    }
+    if (hints.requested != signature)
+    {
+        hints.position = g;
+        hints.requested = signature;
+        if (!hints.worker.joinable())
+        {
+            hints.worker = thread(hintsWorker);
+        }
+        hints.wake.notify_one();
+    }
+    return false;
+}
+
+/**
+ * @brief stop the hints worker (waits for the analysis in progress)
+ *
+ */
+void stopHints()
+{
+    if (hints.worker.joinable())
+    {
+        {
+            lock_guard<mutex> lock(hints.lock);
+            hints.stop = true;
+        }
+        hints.wake.notify_all();
+        hints.worker.join();
+    }
+}
 
 const char CELL_SYMBOLS[] = "123456789ABCDEFG";
 char symbolForCell(square c)
 {
     return CELL_SYMBOLS[c];
 }
-square cellWithSymbol(char c)
+square cellWithSymbol(const game &g, char c)
 {
     if ('a' <= c && c <= 'z')
     {
         c += 'A' - 'a';
     }
-    for (square i = 0; i < NUM_CELLS; i++)
+    for (square i = 0; i < getNumCells(g); i++)
     {
         if (CELL_SYMBOLS[i] == c)
         {
             return i;
         }
     }
-    return NUM_CELLS;
+    return getNumCells(g);
 }
 
 // UI functions
@@ -318,16 +455,25 @@ void showWelcomeScreen()
 void printCell(const game &g, colour what, square which)
 {
     player p = getCellPlayer(g, which);
-    which -= MIN_CELL;
+    bool reached = getDropCell(g, which) == which; // with gravity, only the lowest empty cells
+    which -= getMinCell(g);
     cell.corner.horizontal = CELL_LEFT + cell.size.horizontal * (which % g.DIM);
     cell.corner.vertical = CELL_TOP + cell.size.vertical * (which / g.DIM);
     cell.frame = what;
+    bool hinted = p == PLAYER_NONE && reached && hintsShown && shownSignature == boardSignature(g);
+    cell.content = hinted ? cellHints[shownValues[int(which)].result] : cellEmpty;
     paint(cell);
     if (p == PLAYER_NONE)
     {
         string space(CELL_COLUMNS / 2, ' ');
         printText(cell, space.c_str(), 1, false);
-        cout << symbolForCell(which + MIN_CELL);
+        cout << symbolForCell(which + getMinCell(g));
+        if (hinted)
+        {
+            // outcome and length of the game (moves)
+            printText(cell, space.c_str(), 2, false);
+            cout << HINT_OUTCOMES[shownValues[int(which)].result] << shownValues[int(which)].length;
+        }
     }
     else
     {
@@ -374,10 +520,10 @@ void hideWelcomeScreen()
     paint(menuBar);
     paint(gameInfo);
     paint(userInput);
-    for (player p = 0; p < NUM_PLAYERS; p++)
+    for (player p = 0; p < MAX_PLAYERS; p++)
     {
         printText(userInput, "Name of player ");
-        cout << (p == 0 ? "X [" : "O [") << (1 + p) << "] (blank = AI):";
+        cout << PLAYER_SYMBOLS[p] << " [" << (1 + p) << "] (blank = AI):";
         cin.getline(names[p], MAX_NAME_LENGTH);
         // cin.ignore();
     }
@@ -391,6 +537,7 @@ void hideWelcomeScreen()
  */
 void showFarewellScreen()
 {
+    stopHints();
     msleep(500);
     printText(statusBar, "Bye Bye!!!");
     msleep(500);
@@ -405,7 +552,7 @@ void showFarewellScreen()
  */
 void updateTime(const game &g)
 {
-    for (player p = 0; p < NUM_PLAYERS; p++)
+    for (int p = 0; p < getNumPlayers(g); p++)
     {
         double time = getElapsed(g, (player)p);
         int minutes = time / 60;
@@ -475,10 +622,10 @@ action translateInputToAction(const input what)
 action getUserAction(const game &g)
 {
     input what = 0;
-    if (getStatus(g) == RUNNING && strlen(names[getTurn(g)]) == 0)
+    if (getStatus(g) == RUNNING && isComputerPlayer(getTurn(g)))
     {
         // computer moves
-        what = symbolForCell(getMove(g));
+        what = symbolForCell(getEngineMove(g));
     }
     else
     {
@@ -492,17 +639,31 @@ action getUserAction(const game &g)
         {
             what += 'A' - 'a';
         }
+        if (what != 0)
+        {
+            inputPending = true;
+            inputTime = theClock.now();
+            inputMoveNumber = getMoveNumber(g);
+        }
     }
     // translation
     return translateInputToAction(what);
 }
 
+void showBoard(const game &g);
+
 /**
  * @brief aggiorna schermata (completa)
  * 
  */
 void updateView(const game &g)
 {
+    if (inputPending)
+    {
+        // the previous input has been processed and shown
+        recordLatency(LAT_INPUT_TO_REDRAW, g.DIM, inputMoveNumber, Duration(theClock.now() - inputTime).count());
+        inputPending = false;
+    }
     static const Duration execInterval = 50ms; // 1/20 s
     static TimePoint nextExec = theClock.now();
     Duration interval = theClock.now() - nextExec;
@@ -512,17 +673,92 @@ void updateView(const game &g)
         {
             updateTime(g);
         }
+        if (hintsShown && getStatus(g) == RUNNING && !isComputerPlayer(getTurn(g)) && updateHints(g) && !statsShown)
+        {
+            showBoard(g);
+        }
         nextExec = theClock.now();
     }
 }
 
 // 2. just when something new happens: in the following functions
 
+/**
+ * @brief show the whole board (in place of statistics, if any)
+ *
+ * @param g
+ */
+void showBoard(const game &g)
+{
+    statsShown = false;
+    paint(board);
+    for (square c = getMinCell(g); c <= getMaxCell(g); ++c)
+    {
+        printCell(g, c == selected ? cellSelected : cellNormal, c);
+    }
+}
+
+/**
+ * @brief show latency statistics for the current board dimension
+ *
+ * @param g
+ */
+void showStatistics(const game &g)
+{
+    statsShown = true;
+    paint(statsWindow);
+    printText(statsWindow, "Board ", 0, false);
+    cout << g.DIM << "x" << g.DIM << ", all moves";
+    for (int m = 0, row = 2; m < NUM_LATENCY_METRICS; m++, row += 3)
+    {
+        latency_summary s = getLatencySummary((latency_metric)m, g.DIM);
+        printText(statsWindow, latencyMetricName((latency_metric)m), row, false);
+        cout << " (" << s.count << " samples)" << fixed << setprecision(3);
+        printText(statsWindow, " p50 ", row + 1, false);
+        cout << s.p50 * 1e3 << " p90 " << s.p90 * 1e3 << " p99 " << s.p99 * 1e3;
+        printText(statsWindow, " p999 ", row + 2, false);
+        cout << s.p999 * 1e3 << " max " << s.max * 1e3 << defaultfloat;
+    }
+    cout.flush();
+}
+
+/**
+ * @brief show/hide latency statistics in place of the board
+ *
+ * @param g
+ */
+void toggleStatistics(const game &g)
+{
+    if (statsShown)
+    {
+        showBoard(g);
+    }
+    else
+    {
+        showStatistics(g);
+    }
+}
+
+/**
+ * @brief show/hide the value of the moves on the board (computed in the background)
+ *
+ * @param g
+ */
+void toggleHints(const game &g)
+{
+    hintsShown = !hintsShown;
+    statusMsg(hintsShown ? "Hints: W(in)/D(raw)/L(ose) in N moves" : "Hints hidden");
+    if (!statsShown)
+    {
+        showBoard(g);
+    }
+}
+
 void setUpTranslations(const game &g)
 {
-    static const size_t FIXED_ACTIONS = 9;
+    static const size_t FIXED_ACTIONS = 11;
     delete[] input_action;
-    input_action = new translation[FIXED_ACTIONS + NUM_CELLS];
+    input_action = new translation[FIXED_ACTIONS + getNumCells(g)];
     if (input_action)
     {
         input_action[0] = translation{'N', "N", {NEW, PARAM_NONE}};
@@ -534,8 +770,10 @@ void setUpTranslations(const game &g)
         input_action[6] = translation{KEY_DOWN, "Down", {MOVE, +g.DIM}};
         input_action[7] = translation{'+', "+", {SIZE, +1}};
         input_action[8] = translation{'-', "-", {SIZE, -1}};
+        input_action[9] = translation{'S', "S", {STATS, PARAM_NONE}};
+        input_action[10] = translation{'H', "H", {HINTS, PARAM_NONE}};
         NUM_TRANSLATIONS = FIXED_ACTIONS;
-        for (square c = MIN_CELL; c <= MAX_CELL; c++)
+        for (square c = getMinCell(g); c <= getMaxCell(g); c++)
         {
             input_action[NUM_TRANSLATIONS] = translation{symbolForCell(c), {symbolForCell(c), '\0'}, {TRY, c}};
             NUM_TRANSLATIONS++;
@@ -552,23 +790,40 @@ void setUpTranslations(const game &g)
  */
 void gameStarted(const game &g)
 {
-    statusMsg("New game ...");
-    setUpTranslations(g);
-    showAvailableCommands(g);
-    for (player p = 0; p < NUM_PLAYERS; p++)
+    for (int p = getNumPlayers(g); p < MAX_PLAYERS; p++)
     {
-        paint(playerTimeElapsed(p));
-        paint(playerProgressBar(p));
+        // no such player in this game: blank
+        window elapsed = playerTimeElapsed(p), progress = playerProgressBar(p);
+        elapsed.frame = progress.frame = elapsed.content = progress.content = mainWindow.content;
+        elapsed.title[0] = progress.title[0] = '\0';
+        paint(elapsed);
+        paint(progress);
     }
-    paint(board);
-    for (square c = MIN_CELL; c <= MAX_CELL; ++c)
+    for (int p = 0; p < getNumPlayers(g); p++)
     {
-        printCell(g, cellNormal, c);
+        paint(playerTimeElapsed(p));
+        paint(playerProgressBar(p));
     }
-    selected = MIN_CELL;
-    printCell(g, cellSelected, selected);
+    paint(statusBar); // the last time windows may share its border
+    char msg[MAX_TITLE_LENGTH];
+    sprintf(msg, "New game (%d players%s) ...", getNumPlayers(g), g.gravity ? ", gravity: the pieces drop" : "");
+    statusMsg(msg);
+    setUpTranslations(g);
+    showAvailableCommands(g);
+    selected = getMinCell(g);
+    showBoard(g);
     printText(gameInfo, "Turn of ");
-    cout << (getTurn(g) == 0 ? "X: " : "O: ") << names[getTurn(g)];
+    cout << PLAYER_SYMBOLS[getTurn(g)] << ": " << names[getTurn(g)];
+}
+
+/**
+ * @brief Check whether the computer plays for a player (blank name)
+ *
+ * @return true if the moves are chosen by the AI
+ */
+bool isComputerPlayer(player p)
+{
+    return strlen(names[p]) == 0;
 }
 
 /**
@@ -594,7 +849,7 @@ void gameEnded(const game &g)
     }
     else
     {
-        printText(gameInfo, names[1 - getWinner(g)]);
+        printText(gameInfo, names[getTimedOut(g)]);
         cout << " runned out of time!";
     }
 }
@@ -617,6 +872,12 @@ void statusMsg(const char msg[])
  */
 void cellaChanged(const game &g, square prev, square current)
 {
+    if (statsShown)
+    {
+        selected = current;
+        showBoard(g);
+        return;
+    }
     printCell(g, cellNormal, prev);
     printCell(g, cellSelected, current);
 }
@@ -637,13 +898,13 @@ void changeSelection(game &g, int amount)
     {
         square prevSelected = selected;
         selected += amount;
-        if (selected < MIN_CELL)
+        if (selected < getMinCell(g))
         {
-            selected += NUM_CELLS;
+            selected += getNumCells(g);
         }
-        else if (selected > MAX_CELL)
+        else if (selected > getMaxCell(g))
         {
-            selected -= NUM_CELLS;
+            selected -= getNumCells(g);
         }
         if (prevSelected != selected)
         {
@@ -657,12 +918,578 @@ void changeSelection(game &g, int amount)
  */
 void moveMade(const game &g, square c)
 {
-    cellaChanged(g, selected, c);
-    selected = c;
+    if (hintsShown && !statsShown)
+    {
+        selected = c;
+        showBoard(g); // the hints of the previous position are gone
+    }
+    else
+    {
+        cellaChanged(g, selected, c);
+        selected = c;
+    }
     // showAvailableCommands(g);
     printText(gameInfo, "Turn of ");
-    cout << (getTurn(g) == 0 ? "X: " : "O: ") << names[getTurn(g)];
+    cout << PLAYER_SYMBOLS[getTurn(g)] << ": " << names[getTurn(g)];
+    cout.flush();
+}
+
+// The 4x4x4 board =============================================================
+// the layers in a 2x2 grid, in place of the board
+#define QUBIC_TOP 3
+#define QUBIC_LEFT 54
+#define QUBIC_LAYER_ROWS 10
+#define QUBIC_LAYER_COLUMNS 18
+window qubicCell{{0, 0}, // corner to be specified
+                 {2, 4},
+                 {0, 0},
+                 {WHITE, BLACK}, // to be changed
+                 {WHITE, BLACK},
+                 ""};
+const colour qubicPieces[NUM_PLAYERS] = {{WHITE, BLUE}, {WHITE, MAGENTA}};
+const colour qubicEmpty[2] = {{GREY, BLACK}, {GREY, DARKGREY}}; // checkered
+const char QUBIC_COMMANDS[][MAX_TITLE_LENGTH] = {" Arrows: select cell", " < > PgUp PgDn: select layer",
+                                                 " 1..G: move in the selected layer", " Enter: move",
+                                                 " N: new game", " X: exit"};
+
+/**
+ * @brief print a cell of the 4x4x4 board
+ *
+ */
+void printQubicCell(const qubic &q, int c, bool isSelected)
+{
+    int layer = c / (QUBIC_DIM * QUBIC_DIM), row = c / QUBIC_DIM % QUBIC_DIM, col = c % QUBIC_DIM;
+    player p = getQubicCell(q, c);
+    qubicCell.corner.horizontal = QUBIC_LEFT + layer % 2 * QUBIC_LAYER_COLUMNS + col * qubicCell.size.horizontal;
+    qubicCell.corner.vertical = QUBIC_TOP + layer / 2 * QUBIC_LAYER_ROWS + row * qubicCell.size.vertical;
+    qubicCell.content = isSelected                   ? cellSelected
+                        : isQubicWinningCell(q, c)   ? cellHints[WINNING]
+                        : p != PLAYER_NONE           ? qubicPieces[p]
+                                                     : qubicEmpty[(row + col) % 2];
+    clear(qubicCell);
+    printText(qubicCell, " ", 0, false);
+    cout << (p == PLAYER_NONE ? CELL_SYMBOLS[c % (QUBIC_DIM * QUBIC_DIM)] : "XO"[p]);
+    cout.flush();
+}
+
+/**
+ * @brief show the 4x4x4 board, the layers labelled
+ *
+ */
+void showQubic(const qubic &q, int selected)
+{
+    paint(board);
+    for (int layer = 0; layer < QUBIC_DIM; layer++)
+    {
+        locate(QUBIC_LEFT + layer % 2 * QUBIC_LAYER_COLUMNS, QUBIC_TOP - 1 + layer / 2 * QUBIC_LAYER_ROWS);
+        setColour(board.content);
+        cout << "Layer " << layer + 1;
+    }
+    for (int c = 0; c < QUBIC_CELLS; c++)
+    {
+        printQubicCell(q, c, c == selected);
+    }
+}
+
+/**
+ * @brief show whose turn it is, or who won
+ *
+ */
+void showQubicInfo(const qubic &q)
+{
+    if (getQubicStatus(q) == RUNNING)
+    {
+        printText(gameInfo, "Turn of ");
+        cout << (getQubicTurn(q) == 0 ? "X: " : "O: ") << names[getQubicTurn(q)];
+    }
+    else
+    {
+        printText(gameInfo, getQubicWinner(q) != PLAYER_NONE ? names[getQubicWinner(q)] : "Nobody");
+        cout << " wins!";
+    }
+    cout.flush();
+}
+
+/**
+ * @brief play 4x4x4 games (the computer plays for blank names)
+ *
+ * @param seconds   the time of a computer move
+ * @return int the exit code
+ */
+int playQubic(double seconds)
+{
+    showWelcomeScreen();
+    hideWelcomeScreen();
+    for (size_t row = 0; row < sizeof(QUBIC_COMMANDS) / sizeof(QUBIC_COMMANDS[0]); row++)
+    {
+        printText(menuBar, QUBIC_COMMANDS[row], row, row == 0);
+    }
+    qubic q = newQubic();
+    int selected = 0;
+    showQubic(q, selected);
+    showQubicInfo(q);
+    statusMsg("New game ...");
+    for (;;)
+    {
+        if (getQubicStatus(q) == RUNNING && isComputerPlayer(getQubicTurn(q)))
+        {
+            statusMsg("Thinking...");
+            qubic_search_info info;
+            selected = getQubicMove(q, seconds, info);
+            makeQubicMove(q, selected);
+            showQubic(q, selected);
+            showQubicInfo(q);
+            char msg[MAX_TITLE_LENGTH];
+            if (info.score == QUBIC_WIN || info.score == -QUBIC_WIN)
+            {
+                sprintf(msg, "Solved: %s, %.1fM positions", info.score > 0 ? "win" : "loss", info.nodes / 1e6);
+            }
+            else
+            {
+                sprintf(msg, "Depth %d, score %+d, %.1fM positions", info.depth, info.score, info.nodes / 1e6);
+            }
+            statusMsg(msg);
+            continue;
+        }
+        int key = kbhit() ? getkey() : 0;
+        if ('a' <= key && key <= 'z')
+        {
+            key += 'A' - 'a';
+        }
+        const char *symbol = key > ' ' ? strchr(CELL_SYMBOLS, key) : nullptr;
+        int layerStart = selected - selected % (QUBIC_DIM * QUBIC_DIM), rowStart = selected - selected % QUBIC_DIM;
+        int next = selected, move = -1;
+        switch (key)
+        {
+        case 0:
+            msleep(10);
+            break;
+        case 'X':
+            showFarewellScreen();
+            return 0;
+        case 'N':
+            q = newQubic();
+            showQubic(q, selected);
+            showQubicInfo(q);
+            statusMsg("New game ...");
+            break;
+        case KEY_LEFT:
+        case KEY_RIGHT:
+            next = rowStart + (selected + (key == KEY_LEFT ? QUBIC_DIM - 1 : 1)) % QUBIC_DIM;
+            break;
+        case KEY_UP:
+        case KEY_DOWN:
+            next = layerStart + (selected + (key == KEY_UP ? QUBIC_DIM - 1 : 1) * QUBIC_DIM) % (QUBIC_DIM * QUBIC_DIM);
+            break;
+        case '<':
+        case '>':
+        case KEY_PGUP:
+        case KEY_PGDOWN:
+            next = (selected + (key == '<' || key == KEY_PGUP ? QUBIC_DIM - 1 : 1) * QUBIC_DIM * QUBIC_DIM) % QUBIC_CELLS;
+            break;
+        case KEY_ENTER:
+            move = selected;
+            break;
+        default:
+            if (symbol != nullptr && symbol - CELL_SYMBOLS < QUBIC_DIM * QUBIC_DIM)
+            {
+                move = layerStart + (symbol - CELL_SYMBOLS);
+            }
+        }
+        if (move >= 0)
+        {
+            if (makeQubicMove(q, move))
+            {
+                selected = move;
+                showQubic(q, selected);
+                showQubicInfo(q);
+            }
+            else
+            {
+                statusMsg("command not available");
+            }
+        }
+        else if (next != selected)
+        {
+            printQubicCell(q, selected, false);
+            printQubicCell(q, next, true);
+            selected = next;
+        }
+    }
+}
+
+// Ultimate tic-tac-toe ========================================================
+// the 9x9 cells in place of the board, a blank row between the sub-boards
+#define ULTIMATE_TOP 2
+#define ULTIMATE_LEFT 53
+window ultimateCell{{0, 0}, // corner to be specified
+                    {2, 4},
+                    {0, 0},
+                    {WHITE, BLACK}, // to be changed
+                    {WHITE, BLACK},
+                    ""};
+const colour ultimateWon[NUM_PLAYERS] = {{WHITE, BLUE}, {WHITE, MAGENTA}}; // the whole sub-board
+const colour ultimatePlayable{BLACK, CYAN};
+const char ULTIMATE_COMMANDS[][MAX_TITLE_LENGTH] = {" Arrows: select cell", " 1..9: move in the sub-board to play",
+                                                    " Enter: move", " N: new game", " X: exit"};
+
+/**
+ * @brief print a cell of ultimate tic-tac-toe
+ *
+ */
+void printUltimateCell(const ultimate &u, int c, bool isSelected)
+{
+    int board = c / ULTIMATE_BOARDS, cell = c % ULTIMATE_BOARDS;
+    int row = board / 3 * 3 + cell / 3, col = board % 3 * 3 + cell % 3;
+    player p = getUltimateCell(u, c), boardWinner = getUltimateBoardWinner(u, board);
+    bool playable = isAllowedUltimateMove(u, c);
+    ultimateCell.corner.horizontal = ULTIMATE_LEFT + col * ultimateCell.size.horizontal;
+    ultimateCell.corner.vertical = ULTIMATE_TOP + row * ultimateCell.size.vertical + row / 3;
+    ultimateCell.content = isSelected                    ? cellSelected
+                           : boardWinner != PLAYER_NONE ? ultimateWon[boardWinner]
+                           : p != PLAYER_NONE           ? qubicPieces[p] // as the 4x4x4 pieces
+                           : playable                   ? ultimatePlayable
+                                                        : qubicEmpty[board % 2];
+    clear(ultimateCell);
+    printText(ultimateCell, " ", 0, false);
+    cout << (p != PLAYER_NONE ? "XO"[p] : playable ? CELL_SYMBOLS[cell] : ' ');
+    cout.flush();
+}
+
+/**
+ * @brief show ultimate tic-tac-toe
+ *
+ */
+void showUltimate(const ultimate &u, int selected)
+{
+    paint(board);
+    for (int c = 0; c < ULTIMATE_CELLS; c++)
+    {
+        printUltimateCell(u, c, c == selected);
+    }
+}
+
+/**
+ * @brief show whose turn it is and where, or who won
+ *
+ */
+void showUltimateInfo(const ultimate &u)
+{
+    if (getUltimateStatus(u) == RUNNING)
+    {
+        printText(gameInfo, "Turn of ");
+        cout << (getUltimateTurn(u) == 0 ? "X: " : "O: ") << names[getUltimateTurn(u)];
+        printText(gameInfo, "", 1, false);
+        if (getUltimateBoard(u) == ULTIMATE_ANY)
+        {
+            cout << "in any sub-board";
+        }
+        else
+        {
+            cout << "in sub-board " << getUltimateBoard(u) + 1;
+        }
+    }
+    else
+    {
+        printText(gameInfo, getUltimateWinner(u) != PLAYER_NONE ? names[getUltimateWinner(u)] : "Nobody");
+        cout << " wins!";
+    }
+    cout.flush();
+}
+
+/**
+ * @brief play ultimate tic-tac-toe games (the computer plays for blank names)
+ *
+ * @param seconds   the time of a computer move
+ * @param threads   the search threads of the computer
+ * @return int the exit code
+ */
+int playUltimate(double seconds, int threads)
+{
+    showWelcomeScreen();
+    hideWelcomeScreen();
+    for (size_t row = 0; row < sizeof(ULTIMATE_COMMANDS) / sizeof(ULTIMATE_COMMANDS[0]); row++)
+    {
+        printText(menuBar, ULTIMATE_COMMANDS[row], row, row == 0);
+    }
+    ultimate u = newUltimate();
+    int selected = ULTIMATE_CELLS / 2;
+    showUltimate(u, selected);
+    showUltimateInfo(u);
+    statusMsg("New game ...");
+    for (;;)
+    {
+        if (getUltimateStatus(u) == RUNNING && isComputerPlayer(getUltimateTurn(u)))
+        {
+            statusMsg("Thinking...");
+            ultimate_search_info info;
+            selected = getUltimateMove(u, seconds, threads, info);
+            makeUltimateMove(u, selected);
+            showUltimate(u, selected);
+            showUltimateInfo(u);
+            char msg[MAX_TITLE_LENGTH];
+            sprintf(msg, "%.1fM playouts (%.1fM/s), win rate %.0f%%", info.playouts / 1e6,
+                    info.seconds > 0 ? info.playouts / info.seconds / 1e6 : 0, 100 * info.score);
+            statusMsg(msg);
+            continue;
+        }
+        int key = kbhit() ? getkey() : 0;
+        if ('a' <= key && key <= 'z')
+        {
+            key += 'A' - 'a';
+        }
+        int board = selected / ULTIMATE_BOARDS, cell = selected % ULTIMATE_BOARDS;
+        int row = board / 3 * 3 + cell / 3, col = board % 3 * 3 + cell % 3;
+        int next = selected, move = -1;
+        switch (key)
+        {
+        case 0:
+            msleep(10);
+            break;
+        case 'X':
+            showFarewellScreen();
+            return 0;
+        case 'N':
+            u = newUltimate();
+            showUltimate(u, selected);
+            showUltimateInfo(u);
+            statusMsg("New game ...");
+            break;
+        case KEY_LEFT:
+        case KEY_RIGHT:
+            col = (col + (key == KEY_LEFT ? 8 : 1)) % 9;
+            next = (row / 3 * 3 + col / 3) * ULTIMATE_BOARDS + row % 3 * 3 + col % 3;
+            break;
+        case KEY_UP:
+        case KEY_DOWN:
+            row = (row + (key == KEY_UP ? 8 : 1)) % 9;
+            next = (row / 3 * 3 + col / 3) * ULTIMATE_BOARDS + row % 3 * 3 + col % 3;
+            break;
+        case KEY_ENTER:
+            move = selected;
+            break;
+        default:
+            if ('1' <= key && key <= '9')
+            {
+                // in the sub-board to play, else in the selected one
+                board = getUltimateBoard(u) != ULTIMATE_ANY ? getUltimateBoard(u) : board;
+                move = board * ULTIMATE_BOARDS + key - '1';
+            }
+        }
+        if (move >= 0)
+        {
+            if (makeUltimateMove(u, move))
+            {
+                selected = move;
+                showUltimate(u, selected);
+                showUltimateInfo(u);
+            }
+            else
+            {
+                statusMsg("command not available");
+            }
+        }
+        else if (next != selected)
+        {
+            printUltimateCell(u, selected, false);
+            printUltimateCell(u, next, true);
+            selected = next;
+        }
+    }
+}
+
+// The 15x15 board =============================================================
+// a cell per character pair, the columns lettered and the rows numbered
+#define GOMOKU_TOP 4
+#define GOMOKU_LEFT 56
+window gomokuSquare{{0, 0}, // corner to be specified
+                  {1, 2},
+                  {0, 0},
+                  {WHITE, BLACK}, // to be changed
+                  {WHITE, BLACK},
+                  ""};
+const char GOMOKU_COMMANDS[][MAX_TITLE_LENGTH] = {" Arrows: select cell", " Enter: move", " N: new game", " X: exit"};
+
+/**
+ * @brief print a cell of the 15x15 board
+ *
+ */
+void printGomokuCell(const gomoku &g, int c, bool isSelected, bool isLast)
+{
+    int row = c / GOMOKU_SIZE, col = c % GOMOKU_SIZE;
+    player p = getGomokuCell(g, c);
+    gomokuSquare.corner.horizontal = GOMOKU_LEFT + col * gomokuSquare.size.horizontal;
+    gomokuSquare.corner.vertical = GOMOKU_TOP + row;
+    gomokuSquare.content = isSelected                  ? cellSelected
+                         : isGomokuWinningCell(g, c) ? cellHints[WINNING]
+                         : isLast                    ? cellHints[DRAW]
+                         : p != PLAYER_NONE          ? qubicPieces[p] // as the 4x4x4 pieces
+                                                     : qubicEmpty[(row + col) % 2];
+    clear(gomokuSquare);
+    printText(gomokuSquare, " ", 0, false);
+    cout << (p == PLAYER_NONE ? '.' : "XO"[p]);
     cout.flush();
 }
 
-#endif
\ No newline at end of file
+/**
+ * @brief show the 15x15 board
+ *
+ */
+void showGomoku(const gomoku &g, int selected, int last)
+{
+    paint(board);
+    setColour(board.content);
+    for (int i = 0; i < GOMOKU_SIZE; i++)
+    {
+        locate(GOMOKU_LEFT + 2 * i + 1, GOMOKU_TOP - 1);
+        cout << char('A' + i);
+        locate(GOMOKU_LEFT - 3, GOMOKU_TOP + i);
+        cout << setw(2) << i + 1;
+    }
+    for (int c = 0; c < GOMOKU_CELLS; c++)
+    {
+        printGomokuCell(g, c, c == selected, c == last);
+    }
+}
+
+/**
+ * @brief show whose turn it is, or who won, and the time left
+ *
+ */
+void showGomokuInfo(const gomoku &g)
+{
+    if (getGomokuStatus(g) == RUNNING)
+    {
+        printText(gameInfo, "Turn of ");
+        cout << (getGomokuTurn(g) == 0 ? "X: " : "O: ") << names[getGomokuTurn(g)];
+    }
+    else
+    {
+        printText(gameInfo, getGomokuWinner(g) != PLAYER_NONE ? names[getGomokuWinner(g)] : "Nobody");
+        cout << (getGomokuStatus(g) == TIMEOUT ? " wins on time!" : " wins!");
+    }
+    char clock[MAX_TITLE_LENGTH];
+    sprintf(clock, "Time left: X %.1f s, O %.1f s", getGomokuTimeLeft(g, 0), getGomokuTimeLeft(g, 1));
+    printText(gameInfo, clock, 1, false);
+    cout.flush();
+}
+
+/**
+ * @brief play 15x15 games, five in a row (the computer plays for blank names)
+ *
+ * @param timeAllowed   the time of each player for a game (seconds)
+ * @return int the exit code
+ */
+int playGomoku(double timeAllowed)
+{
+    showWelcomeScreen();
+    hideWelcomeScreen();
+    for (size_t row = 0; row < sizeof(GOMOKU_COMMANDS) / sizeof(GOMOKU_COMMANDS[0]); row++)
+    {
+        printText(menuBar, GOMOKU_COMMANDS[row], row, row == 0);
+    }
+    gomoku g = newGomoku(timeAllowed);
+    int selected = GOMOKU_CELLS / 2, last = -1;
+    showGomoku(g, selected, last);
+    showGomokuInfo(g);
+    statusMsg("New game ...");
+    TimePoint shown = theClock.now();
+    for (;;)
+    {
+        if (getGomokuStatus(g) == RUNNING && isComputerPlayer(getGomokuTurn(g)))
+        {
+            statusMsg("Thinking...");
+            gomoku_search_info info;
+            int move = getGomokuMove(g, getGomokuThinkTime(g), info);
+            if (makeGomokuMove(g, move))
+            {
+                last = move;
+            }
+            showGomoku(g, selected, last);
+            showGomokuInfo(g);
+            char msg[MAX_TITLE_LENGTH];
+            if (info.vcf)
+            {
+                sprintf(msg, "Win by continuous fours, %.1fM positions", info.nodes / 1e6);
+            }
+            else
+            {
+                sprintf(msg, "Depth %d, score %+d, %.1fM positions", info.depth, info.score, info.nodes / 1e6);
+            }
+            statusMsg(msg);
+            continue;
+        }
+        if (getGomokuStatus(g) == RUNNING && Duration(theClock.now() - shown).count() >= 0.5)
+        {
+            // the clock of the human player
+            updateGomokuClock(g);
+            showGomokuInfo(g);
+            shown = theClock.now();
+        }
+        int key = kbhit() ? getkey() : 0;
+        if ('a' <= key && key <= 'z')
+        {
+            key += 'A' - 'a';
+        }
+        int row = selected / GOMOKU_SIZE, col = selected % GOMOKU_SIZE;
+        int next = selected, move = -1;
+        switch (key)
+        {
+        case 0:
+            msleep(10);
+            break;
+        case 'X':
+            showFarewellScreen();
+            return 0;
+        case 'N':
+            g = newGomoku(timeAllowed);
+            last = -1;
+            showGomoku(g, selected, last);
+            showGomokuInfo(g);
+            statusMsg("New game ...");
+            break;
+        case KEY_LEFT:
+        case KEY_RIGHT:
+            next = row * GOMOKU_SIZE + (col + (key == KEY_LEFT ? GOMOKU_SIZE - 1 : 1)) % GOMOKU_SIZE;
+            break;
+        case KEY_UP:
+        case KEY_DOWN:
+            next = (row + (key == KEY_UP ? GOMOKU_SIZE - 1 : 1)) % GOMOKU_SIZE * GOMOKU_SIZE + col;
+            break;
+        case KEY_ENTER:
+            move = selected;
+            break;
+        }
+        if (move >= 0)
+        {
+            if (makeGomokuMove(g, move))
+            {
+                int previous = last;
+                last = move;
+                if (getGomokuStatus(g) != RUNNING)
+                {
+                    showGomoku(g, selected, last);
+                }
+                else
+                {
+                    printGomokuCell(g, previous, false, false);
+                    printGomokuCell(g, move, true, true);
+                }
+                showGomokuInfo(g);
+            }
+            else
+            {
+                showGomokuInfo(g); // maybe out of time
+                statusMsg("command not available");
+            }
+        }
+        else if (next != selected)
+        {
+            printGomokuCell(g, selected, false, selected == last);
+            printGomokuCell(g, next, true, next == last);
+            selected = next;
+        }
+    }
+}
+
+#endif
\ No newline at end of file
@@ -54,6 +54,13 @@ void moveMade(const game &, square);
  */
 void gameStarted(const game &);
 
+/**
+ * @brief Check whether the computer plays for a player (blank name)
+ *
+ * @return true if the moves are chosen by the AI
+ */
+bool isComputerPlayer(player);
+
 /**
  * @brief called when a game is over
  * 
@@ -76,6 +83,45 @@ void secretShown(const game &);
  */
 void changeSelection(game &g, int amount);
 
+/**
+ * @brief show/hide latency statistics in place of the board
+ *
+ * @param g
+ */
+void toggleStatistics(const game &g);
+
+/**
+ * @brief show/hide the value of the moves on the board (computed in the background)
+ *
+ * @param g
+ */
+void toggleHints(const game &g);
+
+/**
+ * @brief play 4x4x4 games (the computer plays for blank names)
+ *
+ * @param seconds   the time of a computer move
+ * @return int the exit code
+ */
+int playQubic(double seconds);
+
+/**
+ * @brief play ultimate tic-tac-toe games (the computer plays for blank names)
+ *
+ * @param seconds   the time of a computer move
+ * @param threads   the search threads of the computer
+ * @return int the exit code
+ */
+int playUltimate(double seconds, int threads);
+
+/**
+ * @brief play 15x15 games, five in a row (the computer plays for blank names)
+ *
+ * @param timeAllowed   the time of each player for a game (seconds)
+ * @return int the exit code
+ */
+int playGomoku(double timeAllowed);
+
 /**
  * @brief utility function to show a message from application
  * 
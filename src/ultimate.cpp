@@ -0,0 +1,535 @@
+#ifndef ULTIMATE_CPP
+#define ULTIMATE_CPP
+
+#include "ultimate.h"
+
+#define ULTIMATE_BOARD_CELLS 512   ///< the maps of a 3x3 board
+#define ULTIMATE_FULL 0x1FF        ///< all the cells (or sub-boards)
+#define ULTIMATE_BENCH_SEED 1      ///< random games of the bench positions
+#define ULTIMATE_BENCH_MAX_MOVES 30 ///< max moves of the bench positions
+
+using ultimate_cells = uint16_t; ///< 9-bit map of a 3x3 board
+
+/**
+ * @brief the 3x3 board tables (computed once)
+ *
+ */
+struct ultimate_tables
+{
+    bool win[ULTIMATE_BOARD_CELLS];                      ///< a line is complete
+    uint8_t count[ULTIMATE_BOARD_CELLS];                 ///< cells of a map
+    uint8_t nth[ULTIMATE_BOARD_CELLS][ULTIMATE_BOARDS];  ///< the cells of a map, in order
+};
+
+/**
+ * @brief compute the tables (the lines of the 3x3 rules)
+ *
+ */
+void initUltimateTables(ultimate_tables &t)
+{
+    const rules &r = getRules(3);
+    for (unsigned m = 0; m < ULTIMATE_BOARD_CELLS; m++)
+    {
+        t.win[m] = isWinning(r, m);
+        t.count[m] = 0;
+        for (int c = 0; c < ULTIMATE_BOARDS; c++)
+        {
+            if (m >> c & 1)
+            {
+                t.nth[m][t.count[m]++] = c;
+            }
+        }
+    }
+}
+
+ultimate_tables ultimateTables;
+once_flag ultimateTablesInitialized;
+
+/**
+ * @brief Get the tables (initialized on first use)
+ *
+ */
+const ultimate_tables &getUltimateTables()
+{
+    call_once(ultimateTablesInitialized, initUltimateTables, ref(ultimateTables));
+    return ultimateTables;
+}
+
+/**
+ * @brief game representation
+ *
+ */
+struct ultimate
+{
+    ultimate_cells cells[NUM_PLAYERS][ULTIMATE_BOARDS]{}; ///< the pieces of each player, by sub-board
+    ultimate_cells won[NUM_PLAYERS]{0, 0};                 ///< the meta-board: sub-boards won by each player
+    ultimate_cells closed{0};                              ///< sub-boards won or full
+    int board{ULTIMATE_ANY};                               ///< the sub-board to play in
+    player turn{0};                                        ///< player to move
+    player winner{PLAYER_NONE};                            ///< winner
+    status state{RUNNING};                                 ///< game status
+};
+
+/**
+ * @brief the empty cells of a sub-board (none if closed)
+ *
+ */
+inline ultimate_cells ultimateEmpty(const ultimate &g, int board)
+{
+    return g.closed >> board & 1 ? 0 : ~(g.cells[0][board] | g.cells[1][board]) & ULTIMATE_FULL;
+}
+
+/**
+ * @brief the empty cells of each sub-board the player to move may play in
+ *
+ * @param moves by sub-board (set)
+ * @return int the number of moves
+ */
+int ultimateMoves(const ultimate_tables &t, const ultimate &g, ultimate_cells moves[])
+{
+    int count = 0;
+    for (int b = 0; b < ULTIMATE_BOARDS; b++)
+    {
+        moves[b] = g.board == ULTIMATE_ANY || g.board == b ? ultimateEmpty(g, b) : 0;
+        count += t.count[moves[b]];
+    }
+    return count;
+}
+
+/**
+ * @brief the n-th move of a set (by sub-board)
+ *
+ * @return int the cell
+ */
+int ultimateNthMove(const ultimate_tables &t, const ultimate_cells moves[], int n)
+{
+    int b = 0;
+    for (; n >= t.count[moves[b]]; b++)
+    {
+        n -= t.count[moves[b]];
+    }
+    return b * ULTIMATE_BOARDS + t.nth[moves[b]][n];
+}
+
+/**
+ * @brief play a move (allowed)
+ *
+ */
+void playUltimate(const ultimate_tables &t, ultimate &g, int cell)
+{
+    int board = cell / ULTIMATE_BOARDS;
+    cell %= ULTIMATE_BOARDS;
+    ultimate_cells mine = g.cells[g.turn][board] |= 1 << cell;
+    if (t.win[mine])
+    {
+        g.won[g.turn] |= 1 << board;
+        g.closed |= 1 << board;
+        if (t.win[g.won[g.turn]])
+        {
+            g.winner = g.turn;
+            g.state = ENDED;
+        }
+    }
+    else if ((mine | g.cells[1 - g.turn][board]) == ULTIMATE_FULL)
+    {
+        g.closed |= 1 << board;
+    }
+    if (g.closed == ULTIMATE_FULL)
+    {
+        g.state = ENDED;
+    }
+    g.board = g.closed >> cell & 1 ? ULTIMATE_ANY : cell;
+    g.turn = 1 - g.turn;
+}
+
+/**
+ * @brief play at random until the end
+ *
+ * @return double the result for the player to move (win 1, draw 0.5, loss 0)
+ */
+double ultimatePlayout(const ultimate_tables &t, ultimate g, mt19937 &rng)
+{
+    player p = g.turn;
+    ultimate_cells moves[ULTIMATE_BOARDS];
+    while (g.state == RUNNING)
+    {
+        int cell;
+        if (g.board != ULTIMATE_ANY)
+        {
+            ultimate_cells empty = ultimateEmpty(g, g.board); // the usual case: no scan
+            cell = g.board * ULTIMATE_BOARDS + t.nth[empty][rng() % t.count[empty]];
+        }
+        else
+        {
+            cell = ultimateNthMove(t, moves, rng() % ultimateMoves(t, g, moves));
+        }
+        playUltimate(t, g, cell);
+    }
+    return g.winner == PLAYER_NONE ? 0.5 : g.winner == p ? 1 : 0;
+}
+
+/**
+ * @brief Get a new game (the first player at random)
+ *
+ */
+ultimate newUltimate()
+{
+    ultimate g;
+    g.turn = rand() % NUM_PLAYERS;
+    return g;
+}
+
+/**
+ * @brief Get the status of the game
+ *
+ */
+status getUltimateStatus(const ultimate &g)
+{
+    return g.state;
+}
+
+/**
+ * @brief Get the player to move (PLAYER_NONE if the game is over)
+ *
+ */
+player getUltimateTurn(const ultimate &g)
+{
+    return g.state == RUNNING ? g.turn : PLAYER_NONE;
+}
+
+/**
+ * @brief Get the winner (PLAYER_NONE if none)
+ *
+ */
+player getUltimateWinner(const ultimate &g)
+{
+    return g.winner;
+}
+
+/**
+ * @brief Get the player of a cell (PLAYER_NONE if empty)
+ *
+ */
+player getUltimateCell(const ultimate &g, int cell)
+{
+    for (player p = 0; p < NUM_PLAYERS; p++)
+    {
+        if (0 <= cell && cell < ULTIMATE_CELLS && (g.cells[p][cell / ULTIMATE_BOARDS] >> cell % ULTIMATE_BOARDS & 1))
+        {
+            return p;
+        }
+    }
+    return PLAYER_NONE;
+}
+
+/**
+ * @brief Get the player who won a sub-board (PLAYER_NONE if none)
+ *
+ */
+player getUltimateBoardWinner(const ultimate &g, int board)
+{
+    for (player p = 0; p < NUM_PLAYERS; p++)
+    {
+        if (0 <= board && board < ULTIMATE_BOARDS && (g.won[p] >> board & 1))
+        {
+            return p;
+        }
+    }
+    return PLAYER_NONE;
+}
+
+/**
+ * @brief Get the sub-board to play in (ULTIMATE_ANY if free)
+ *
+ */
+int getUltimateBoard(const ultimate &g)
+{
+    return g.board;
+}
+
+/**
+ * @brief Check if a move is allowed
+ *
+ */
+bool isAllowedUltimateMove(const ultimate &g, int cell)
+{
+    if (g.state != RUNNING || cell < 0 || cell >= ULTIMATE_CELLS)
+    {
+        return false;
+    }
+    int board = cell / ULTIMATE_BOARDS;
+    return (g.board == ULTIMATE_ANY || g.board == board) && (ultimateEmpty(g, board) >> cell % ULTIMATE_BOARDS & 1);
+}
+
+/**
+ * @brief Make a move of the player to move
+ *
+ * @return true if the move was allowed
+ */
+bool makeUltimateMove(ultimate &g, int cell)
+{
+    if (!isAllowedUltimateMove(g, cell))
+    {
+        return false;
+    }
+    playUltimate(getUltimateTables(), g, cell);
+    return true;
+}
+
+// Monte Carlo tree search =====================================================
+
+/**
+ * @brief a node of the search tree
+ *
+ */
+struct ultimate_node
+{
+    ultimate position;                        ///< after the move
+    ultimate_cells untried[ULTIMATE_BOARDS];  ///< moves not expanded yet, by sub-board
+    int numUntried;                           ///< their number
+    int parent;                               ///< parent node (-1 for the root)
+    int firstChild;                           ///< first expanded move (-1 if none)
+    int nextSibling;                          ///< next move of the parent (-1 if none)
+    int cell;                                 ///< the move leading here
+    unsigned visits;                          ///< playouts through the node
+    double score;                             ///< for the player who moved here (win 1, draw 0.5)
+};
+
+/**
+ * @brief a new node (its moves all untried)
+ *
+ */
+ultimate_node newUltimateNode(const ultimate_tables &t, const ultimate &g, int parent, int sibling, int cell)
+{
+    ultimate_node n{g, {}, 0, parent, -1, sibling, cell, 0, 0};
+    if (g.state == RUNNING)
+    {
+        n.numUntried = ultimateMoves(t, g, n.untried);
+    }
+    return n;
+}
+
+/**
+ * @brief the child to explore (UCT, as the MCTS engine)
+ *
+ */
+int ultimateSelect(const vector<ultimate_node> &nodes, int n)
+{
+    double logVisits = log(nodes[n].visits);
+    int best = nodes[n].firstChild;
+    double bestValue = -1;
+    for (int c = nodes[n].firstChild; c >= 0; c = nodes[c].nextSibling)
+    {
+        double value = nodes[c].score / nodes[c].visits + MCTS_EXPLORATION * sqrt(logVisits / nodes[c].visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = c;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief grow a search tree until the deadline
+ *
+ * @param capacity  max nodes
+ * @param visits    by cell: playouts of the root moves (added)
+ * @param scores    by cell: their scores (added)
+ * @param playouts  the random games played (set)
+ * @param used      the bytes of the tree (set)
+ */
+void ultimateSearch(const ultimate &g, TimePoint deadline, size_t capacity, unsigned visits[], double scores[],
+                    unsigned long long &playouts, size_t &used)
+{
+    const ultimate_tables &t = getUltimateTables();
+    mt19937 &rng = engineRandom();
+    vector<ultimate_node> nodes;
+    nodes.reserve(min(capacity, size_t(MCTS_RESERVE)));
+    nodes.push_back(newUltimateNode(t, g, -1, -1, -1));
+    unsigned long long i = 0;
+    for (; i % MCTS_CLOCK_CHECK != 0 || theClock.now() < deadline; i++)
+    {
+        // selection
+        int n = 0;
+        while (nodes[n].numUntried == 0 && nodes[n].firstChild >= 0)
+        {
+            n = ultimateSelect(nodes, n);
+        }
+        // expansion
+        if (nodes[n].numUntried != 0 && nodes.size() < capacity)
+        {
+            int cell = ultimateNthMove(t, nodes[n].untried, rng() % nodes[n].numUntried);
+            nodes[n].untried[cell / ULTIMATE_BOARDS] &= ~(1 << cell % ULTIMATE_BOARDS);
+            nodes[n].numUntried--;
+            ultimate next = nodes[n].position;
+            playUltimate(t, next, cell);
+            nodes.push_back(newUltimateNode(t, next, n, nodes[n].firstChild, cell));
+            nodes[n].firstChild = nodes.size() - 1;
+            n = nodes.size() - 1;
+        }
+        // simulation, then the result goes up (alternating players)
+        const ultimate &p = nodes[n].position;
+        double result = p.state == RUNNING ? ultimatePlayout(t, p, rng) : p.winner == PLAYER_NONE ? 0.5 : 0;
+        for (double score = 1 - result; n >= 0; n = nodes[n].parent, score = 1 - score)
+        {
+            nodes[n].visits++;
+            nodes[n].score += score;
+        }
+    }
+    for (int c = nodes[0].firstChild; c >= 0; c = nodes[c].nextSibling)
+    {
+        visits[nodes[c].cell] += nodes[c].visits;
+        scores[nodes[c].cell] += nodes[c].score;
+    }
+    playouts = i;
+    used = nodes.capacity() * sizeof(ultimate_node);
+}
+
+/**
+ * @brief Choose a move for the player to move (the game not over)
+ *
+ * One tree per thread (root parallel, as the MCTS engine), each as large
+ * as its share of the solver memory; the most visited move is played.
+ *
+ * @param seconds   the time available
+ * @param threads   search threads (a tree each, sharing the solver memory)
+ * @param info      what the search did (set)
+ * @return int the cell
+ */
+int getUltimateMove(const ultimate &g, double seconds, int threads, ultimate_search_info &info)
+{
+    TimePoint start = theClock.now();
+    TimePoint deadline = start + chrono::duration_cast<Clock::duration>(Duration(seconds));
+    threads = max(1, threads);
+    size_t capacity = max(size_t(1), (solverMegabytes << 20) / sizeof(ultimate_node) / threads);
+    vector<array<unsigned, ULTIMATE_CELLS>> visits(threads);
+    vector<array<double, ULTIMATE_CELLS>> scores(threads);
+    vector<unsigned long long> playouts(threads);
+    vector<size_t> used(threads);
+    vector<thread> workers;
+    for (int i = 0; i < threads; i++)
+    {
+        visits[i].fill(0);
+        scores[i].fill(0);
+        if (i > 0)
+        {
+            workers.emplace_back(ultimateSearch, cref(g), deadline, capacity, visits[i].data(), scores[i].data(),
+                                 ref(playouts[i]), ref(used[i]));
+        }
+    }
+    ultimateSearch(g, deadline, capacity, visits[0].data(), scores[0].data(), playouts[0], used[0]);
+    for (thread &w : workers)
+    {
+        w.join();
+    }
+    // the most visited move
+    int best = -1;
+    unsigned bestVisits = 0;
+    double bestScore = 0;
+    for (int cell = 0; cell < ULTIMATE_CELLS; cell++)
+    {
+        unsigned total = 0;
+        double score = 0;
+        for (int i = 0; i < threads; i++)
+        {
+            total += visits[i][cell];
+            score += scores[i][cell];
+        }
+        if (isAllowedUltimateMove(g, cell) && (best < 0 || total > bestVisits))
+        {
+            best = cell;
+            bestVisits = total;
+            bestScore = total > 0 ? score / total : 0.5;
+        }
+    }
+    info = {0, bestScore, 0, Duration(theClock.now() - start).count()};
+    for (int i = 0; i < threads; i++)
+    {
+        info.playouts += playouts[i];
+        info.bytes += used[i];
+    }
+    return best;
+}
+
+/**
+ * @brief Measure the random games and the searches per second (1 .. max threads)
+ *
+ * The positions come from random games of a fixed seed, so that every
+ * thread count searches the same ones.
+ *
+ * @param positions     positions searched per thread count (from random games)
+ * @param seconds       per search
+ * @param maxThreads    max search threads
+ * @return int the exit code
+ */
+int runUltimateBench(ostream &out, int positions, double seconds, int maxThreads)
+{
+    const ultimate_tables &t = getUltimateTables();
+    mt19937 rng(ULTIMATE_BENCH_SEED);
+    // random games from the start, for as long as a thread count runs
+    unsigned long long games = 0, moves = 0, wins[PLAYER_NONE + 1]{};
+    TimePoint start = theClock.now(), end = start + chrono::duration_cast<Clock::duration>(Duration(positions * seconds));
+    for (; games % MCTS_CLOCK_CHECK != 0 || theClock.now() < end; games++)
+    {
+        ultimate g;
+        ultimate_cells legal[ULTIMATE_BOARDS];
+        while (g.state == RUNNING)
+        {
+            playUltimate(t, g, ultimateNthMove(t, legal, rng() % ultimateMoves(t, g, legal)));
+            moves++;
+        }
+        wins[g.winner]++;
+    }
+    double time = Duration(theClock.now() - start).count();
+    out << "Ultimate tic-tac-toe: " << games << " random games in " << fixed << setprecision(2) << time << " s ("
+        << setprecision(0) << games / time << " games/s, " << setprecision(1) << double(moves) / games
+        << " moves each), first player wins " << 100.0 * wins[0] / games << "%, second " << 100.0 * wins[1] / games
+        << "%, draws " << 100.0 * wins[PLAYER_NONE] / games << "%" << defaultfloat << "\n";
+    // the same positions searched by every thread count
+    vector<ultimate> bench;
+    while (int(bench.size()) < positions)
+    {
+        ultimate g;
+        ultimate_cells legal[ULTIMATE_BOARDS];
+        for (int m = rng() % ULTIMATE_BENCH_MAX_MOVES; m > 0 && g.state == RUNNING; m--)
+        {
+            playUltimate(t, g, ultimateNthMove(t, legal, rng() % ultimateMoves(t, g, legal)));
+        }
+        if (g.state == RUNNING)
+        {
+            bench.push_back(g);
+        }
+    }
+    out << positions << " positions, " << seconds << " s per search\n";
+    out << setw(8) << "threads" << setw(14) << "playouts/s" << setw(10) << "speedup" << setw(16) << "per search" << setw(10)
+        << "max MB" << "\n";
+    double single = 0;
+    for (int threads = 1;; threads = min(2 * threads, maxThreads))
+    {
+        unsigned long long playouts = 0;
+        size_t bytes = 0;
+        double time = 0;
+        for (const ultimate &g : bench)
+        {
+            ultimate_search_info info;
+            getUltimateMove(g, seconds, threads, info);
+            playouts += info.playouts;
+            bytes = max(bytes, info.bytes);
+            time += info.seconds;
+        }
+        double rate = time > 0 ? playouts / time : 0;
+        single = threads == 1 ? rate : single;
+        out << setw(8) << threads << fixed << setprecision(0) << setw(14) << rate << setprecision(2) << setw(10)
+            << (single > 0 ? rate / single : 0) << setprecision(0) << setw(16) << double(playouts) / positions << setprecision(1)
+            << setw(10) << bytes / 1048576.0 << defaultfloat << "\n";
+        out.flush();
+        if (threads == maxThreads)
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef ULTIMATE_H
+#define ULTIMATE_H
+
+// Ultimate tic-tac-toe ========================================================
+/**
+ * Nove tris 3x3 disposti a loro volta in un tris 3x3: la cella in cui si
+ * gioca indica il tris in cui deve giocare l'avversario (libero se quel
+ * tris è già chiuso, vinto o pieno). Chi vince un tris lo conquista, vince
+ * la partita chi allinea tre tris conquistati.
+ * Ogni tris sta in 9 bit per giocatore, come le mosse della scacchiera 3x3,
+ * e i tris conquistati in altri 9 bit: vittorie e celle libere si leggono
+ * in tabelle di 512 elementi. L'albero è troppo grande per risolverlo: il
+ * computer usa una ricerca Monte Carlo con un albero per thread, misurata
+ * in partite simulate al secondo.
+ */
+
+#define ULTIMATE_BOARDS 9 ///< sub-boards, by rows
+#define ULTIMATE_CELLS 81 ///< cell = sub-board * ULTIMATE_BOARDS + cell of the sub-board (by rows)
+#define ULTIMATE_ANY -1   ///< any sub-board may be played
+
+/**
+ * @brief the game (to be defined in ultimate.cpp)
+ *
+ */
+struct ultimate;
+
+/**
+ * @brief what a search did
+ *
+ */
+struct ultimate_search_info
+{
+    unsigned long long playouts; ///< random games played (all threads)
+    double score;                ///< of the chosen move (win 1, draw 0.5)
+    size_t bytes;                ///< memory of the trees
+    double seconds;              ///< time spent
+};
+
+/**
+ * @brief Get a new game (the first player at random)
+ *
+ */
+ultimate newUltimate();
+
+/**
+ * @brief Get the status of the game
+ *
+ */
+status getUltimateStatus(const ultimate &);
+
+/**
+ * @brief Get the player to move (PLAYER_NONE if the game is over)
+ *
+ */
+player getUltimateTurn(const ultimate &);
+
+/**
+ * @brief Get the winner (PLAYER_NONE if none)
+ *
+ */
+player getUltimateWinner(const ultimate &);
+
+/**
+ * @brief Get the player of a cell (PLAYER_NONE if empty)
+ *
+ */
+player getUltimateCell(const ultimate &, int cell);
+
+/**
+ * @brief Get the player who won a sub-board (PLAYER_NONE if none)
+ *
+ */
+player getUltimateBoardWinner(const ultimate &, int board);
+
+/**
+ * @brief Get the sub-board to play in (ULTIMATE_ANY if free)
+ *
+ */
+int getUltimateBoard(const ultimate &);
+
+/**
+ * @brief Check if a move is allowed
+ *
+ */
+bool isAllowedUltimateMove(const ultimate &, int cell);
+
+/**
+ * @brief Make a move of the player to move
+ *
+ * @return true if the move was allowed
+ */
+bool makeUltimateMove(ultimate &, int cell);
+
+/**
+ * @brief Choose a move for the player to move (the game not over)
+ *
+ * @param seconds   the time available
+ * @param threads   search threads (a tree each, sharing the solver memory)
+ * @param info      what the search did (set)
+ * @return int the cell
+ */
+int getUltimateMove(const ultimate &, double seconds, int threads, ultimate_search_info &info);
+
+/**
+ * @brief Measure the random games and the searches per second (1 .. max threads)
+ *
+ * @param positions     positions searched per thread count (from random games)
+ * @param seconds       per search
+ * @param maxThreads    max search threads
+ * @return int the exit code
+ */
+int runUltimateBench(std::ostream &, int positions, double seconds, int maxThreads);
+
+#endif